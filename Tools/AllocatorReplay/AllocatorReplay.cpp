@@ -0,0 +1,144 @@
+// Replays an allocation trace recorded by D3D12Device::GetAllocationTrace() against every allocator strategy
+// and reports the CPU cost, the peak footprint and the fragmentation of each one.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o AllocatorReplay Tools/AllocatorReplay/AllocatorReplay.cpp
+//
+// Usage: AllocatorReplay <TraceFile> [PoolSizeInMB] [FrameLatency]
+//        AllocatorReplay --synthetic <FrameCount> [PoolSizeInMB] [FrameLatency]
+
+#include "../../XD3DRenderer/Common/AllocationTraceReplay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+
+// Same values as D3D12MemoryAllocator.h
+static const uint32_t MinBlockSize = 256;
+static const uint32_t SlabMinClassSize = 256;
+static const uint32_t SlabMaxClassSize = 64 * 1024;
+
+// Mostly small buffers living a few frames, with some large long lived ones
+static void GenerateSyntheticTrace(uint32_t FrameCount, XAllocationTrace& Trace)
+{
+	std::mt19937 Random(1234);
+	std::vector<std::pair<uint32_t, uint32_t>> LiveAllocations;  // Id, last frame
+
+	Trace.Start();
+
+	for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+	{
+		const uint32_t AllocationCount = 50 + Random() % 100;
+		for (uint32_t i = 0; i < AllocationCount; i++)
+		{
+			const bool bLarge = Random() % 200 == 0;
+			const uint32_t Size = bLarge ? 64 * 1024 + Random() % (4 * 1024 * 1024) : 16 + Random() % 4096;
+			const uint32_t Lifetime = bLarge ? 100 + Random() % 200 : 1 + Random() % 8;
+
+			const uint32_t Id = Trace.RecordAllocate(0, Size, 256);
+			LiveAllocations.push_back({ Id, Frame + Lifetime });
+		}
+
+		for (size_t i = 0; i < LiveAllocations.size();)
+		{
+			if (LiveAllocations[i].second <= Frame)
+			{
+				Trace.RecordDeallocate(LiveAllocations[i].first);
+				LiveAllocations[i] = LiveAllocations.back();
+				LiveAllocations.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		Trace.RecordCleanUp(0);
+	}
+
+	Trace.Stop();
+}
+
+static void PrintResult(const char* StrategyName, uint32_t Channel, const XAllocationReplayResult& Result)
+{
+	printf("%-6s %7u %10llu %9.1f %10.2f %8u %9.3f %9.3f\n",
+		StrategyName,
+		Channel,
+		(unsigned long long)Result.OperationCount,
+		Result.GetNanosecondsPerOperation(),
+		(double)Result.PeakAllocatedSize / (1024.0 * 1024.0),
+		Result.FailedAllocationCount,
+		Result.FinalStats.GetInternalFragmentation(),
+		Result.PeakExternalFragmentation);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <TraceFile> [PoolSizeInMB] [FrameLatency]\n", argv[0]);
+		printf("       %s --synthetic <FrameCount> [PoolSizeInMB] [FrameLatency]\n", argv[0]);
+		return 1;
+	}
+
+	XAllocationTrace Trace;
+	int ArgIndex = 1;
+	if (strcmp(argv[ArgIndex], "--synthetic") == 0)
+	{
+		const uint32_t FrameCount = argc > ArgIndex + 1 ? (uint32_t)atoi(argv[ArgIndex + 1]) : 1000;
+		GenerateSyntheticTrace(FrameCount, Trace);
+		ArgIndex += 2;
+	}
+	else
+	{
+		if (!Trace.LoadFromFile(argv[ArgIndex]))
+		{
+			printf("Failed to load trace %s\n", argv[ArgIndex]);
+			return 1;
+		}
+		ArgIndex += 1;
+	}
+
+	// The buddy allocator needs PoolSize / MinBlockSize to be a power of two
+	const uint32_t PoolSizeInMB = argc > ArgIndex ? (uint32_t)atoi(argv[ArgIndex]) : 1024;
+	const uint64_t PoolSize = (1ull << BitHelper::CeilLog2(PoolSizeInMB)) * 1024 * 1024;
+	const uint32_t FrameLatency = argc > ArgIndex + 1 ? (uint32_t)atoi(argv[ArgIndex + 1]) : 3;
+
+	const std::vector<XAllocationTrace::Event>& Events = Trace.GetEvents();
+
+	bool bChannelUsed[256] = {};
+	for (const XAllocationTrace::Event& Event : Events)
+	{
+		if (Event.Type != XAllocationTrace::EEventType::Deallocate)
+		{
+			bChannelUsed[Event.Channel] = true;
+		}
+	}
+
+	printf("%zu events, pool %llu MB, frame latency %u\n", Events.size(), (unsigned long long)(PoolSize / (1024 * 1024)), FrameLatency);
+	printf("%-6s %7s %10s %9s %10s %8s %9s %9s\n", "Alloc", "Channel", "Ops", "ns/op", "Peak MB", "Failed", "IntFrag", "PeakExt");
+
+	for (uint32_t Channel = 0; Channel < 256; Channel++)
+	{
+		if (!bChannelUsed[Channel])
+		{
+			continue;
+		}
+
+		{
+			XBuddyReplayAdapter Adapter(PoolSize, MinBlockSize);
+			PrintResult("Buddy", Channel, XAllocationTraceReplayer<XBuddyReplayAdapter>::Replay(Events, (uint8_t)Channel, FrameLatency, Adapter));
+		}
+
+		{
+			XTLSFReplayAdapter Adapter(PoolSize, MinBlockSize);
+			PrintResult("TLSF", Channel, XAllocationTraceReplayer<XTLSFReplayAdapter>::Replay(Events, (uint8_t)Channel, FrameLatency, Adapter));
+		}
+
+		{
+			XSlabReplayAdapter Adapter(PoolSize, MinBlockSize, SlabMinClassSize, SlabMaxClassSize);
+			PrintResult("Slab", Channel, XAllocationTraceReplayer<XSlabReplayAdapter>::Replay(Events, (uint8_t)Channel, FrameLatency, Adapter));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+// Checks the barrier lists XBarrierBatcher emits against the expected sequences, without a device.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o BarrierBatcher Tools/BarrierBatcher/BarrierBatcher.cpp
+//
+// Usage: BarrierBatcher
+//        Prints each case and returns the number of failed ones
+
+#include "../../XD3DRenderer/Common/BarrierBatcher.h"
+#include <stdio.h>
+#include <functional>
+
+// A few D3D12_RESOURCE_STATES values
+enum : uint32_t
+{
+	COMMON = 0,
+	VERTEX_AND_CONSTANT_BUFFER = 0x1,
+	RENDER_TARGET = 0x4,
+	UNORDERED_ACCESS = 0x8,
+	PIXEL_SHADER_RESOURCE = 0x80,
+	COPY_DEST = 0x400,
+	COPY_SOURCE = 0x800,
+};
+
+static const uint32_t ALL = XResourceState::AllSubresources;
+static const uint32_t NONE = XBarrierBatcher::BarrierFlagNone;
+static const uint32_t BEGIN = XBarrierBatcher::BarrierFlagBeginOnly;
+static const uint32_t END = XBarrierBatcher::BarrierFlagEndOnly;
+
+using XBarrier = XBarrierBatcher::XBarrier;
+
+// Fake resources, only their addresses are used
+static int ResourceA = 0;
+static int ResourceB = 0;
+
+static XBarrier MakeBarrier(void* Resource, uint32_t Subresource, uint32_t StateBefore, uint32_t StateAfter, uint32_t Flags = NONE)
+{
+	XBarrier Barrier;
+	Barrier.Resource = Resource;
+	Barrier.Subresource = Subresource;
+	Barrier.StateBefore = StateBefore;
+	Barrier.StateAfter = StateAfter;
+	Barrier.Flags = Flags;
+
+	return Barrier;
+}
+
+static void PrintBarriers(const char* Title, const std::vector<XBarrier>& Barriers)
+{
+	printf("    %s:\n", Title);
+	for (const XBarrier& Barrier : Barriers)
+	{
+		printf("        %c sub %d 0x%x -> 0x%x flags %u\n", Barrier.Resource == &ResourceA ? 'A' : 'B',
+			Barrier.Subresource == ALL ? -1 : (int)Barrier.Subresource, Barrier.StateBefore, Barrier.StateAfter, Barrier.Flags);
+	}
+}
+
+// Runs Record, flushing with every call to the given Flush function, and compares every emitted list
+static bool RunCase(const char* Name, const std::function<void(XBarrierBatcher&, const std::function<void()>&)>& Record,
+	const std::vector<std::vector<XBarrier>>& Expected)
+{
+	XBarrierBatcher Batcher;
+	std::vector<std::vector<XBarrier>> Emitted;
+
+	Record(Batcher, [&]()
+	{
+		Batcher.Flush([&](const std::vector<XBarrier>& Barriers) { Emitted.push_back(Barriers); });
+	});
+
+	const bool bPassed = Emitted == Expected;
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	if (!bPassed)
+	{
+		for (size_t i = 0; i < Expected.size() || i < Emitted.size(); i++)
+		{
+			printf("  flush %zu\n", i);
+			PrintBarriers("expected", i < Expected.size() ? Expected[i] : std::vector<XBarrier>());
+			PrintBarriers("emitted", i < Emitted.size() ? Emitted[i] : std::vector<XBarrier>());
+		}
+	}
+
+	return bPassed;
+}
+
+int main()
+{
+	uint32_t FailedCount = 0;
+
+	FailedCount += !RunCase("Transitions are batched into one flush", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, COMMON);
+		XResourceState StateB(1, COPY_DEST);
+		Batcher.Transition(&ResourceA, StateA, ALL, RENDER_TARGET);
+		Batcher.Transition(&ResourceB, StateB, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, COMMON, RENDER_TARGET), MakeBarrier(&ResourceB, ALL, COPY_DEST, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("Redundant transitions emit nothing", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, PIXEL_SHADER_RESOURCE);
+		Batcher.Transition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, {});
+
+	FailedCount += !RunCase("Successive transitions collapse", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, COMMON);
+		Batcher.Transition(&ResourceA, StateA, ALL, COPY_DEST);
+		Batcher.Transition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, COMMON, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("A round trip within a batch disappears", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, COMMON);
+		Batcher.Transition(&ResourceA, StateA, ALL, COPY_SOURCE);
+		Batcher.Transition(&ResourceA, StateA, ALL, COMMON);
+		Flush();
+	}, {});
+
+	FailedCount += !RunCase("Flushes keep the transitions apart", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, COMMON);
+		Batcher.Transition(&ResourceA, StateA, ALL, COPY_DEST);
+		Flush();
+		Batcher.Transition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, COMMON, COPY_DEST) }, { MakeBarrier(&ResourceA, ALL, COPY_DEST, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("One mip is transitioned alone", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(4, PIXEL_SHADER_RESOURCE);
+		Batcher.Transition(&ResourceA, StateA, 2, RENDER_TARGET);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, 2, PIXEL_SHADER_RESOURCE, RENDER_TARGET) } });
+
+	FailedCount += !RunCase("A whole transition only touches the subresources that differ", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(4, PIXEL_SHADER_RESOURCE);
+		Batcher.Transition(&ResourceA, StateA, 1, RENDER_TARGET);
+		Batcher.Transition(&ResourceA, StateA, 3, UNORDERED_ACCESS);
+		Flush();
+		Batcher.Transition(&ResourceA, StateA, ALL, RENDER_TARGET);
+		Flush();
+		// Back to a single state, one barrier for the whole resource
+		Batcher.Transition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, {
+		{ MakeBarrier(&ResourceA, 1, PIXEL_SHADER_RESOURCE, RENDER_TARGET), MakeBarrier(&ResourceA, 3, PIXEL_SHADER_RESOURCE, UNORDERED_ACCESS) },
+		{ MakeBarrier(&ResourceA, 0, PIXEL_SHADER_RESOURCE, RENDER_TARGET), MakeBarrier(&ResourceA, 2, PIXEL_SHADER_RESOURCE, RENDER_TARGET),
+			MakeBarrier(&ResourceA, 3, UNORDERED_ACCESS, RENDER_TARGET) },
+		{ MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("Subresource transitions do not collapse across another subresource", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(2, COMMON);
+		Batcher.Transition(&ResourceA, StateA, 0, COPY_DEST);
+		Batcher.Transition(&ResourceA, StateA, 1, COPY_DEST);
+		Batcher.Transition(&ResourceA, StateA, 0, PIXEL_SHADER_RESOURCE);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, 0, COMMON, COPY_DEST), MakeBarrier(&ResourceA, 1, COMMON, COPY_DEST),
+		MakeBarrier(&ResourceA, 0, COPY_DEST, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("Split barrier begins early and ends before use", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, RENDER_TARGET);
+		Batcher.BeginTransition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+		// Unrelated work in between
+		Flush();
+		Batcher.EndTransition(&ResourceA, ALL);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE, BEGIN) },
+		{ MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE, END) } });
+
+	FailedCount += !RunCase("A transition ends the pending split first", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, RENDER_TARGET);
+		Batcher.BeginTransition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Flush();
+		Batcher.Transition(&ResourceA, StateA, ALL, COPY_SOURCE);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE, BEGIN) },
+		{ MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE, END), MakeBarrier(&ResourceA, ALL, PIXEL_SHADER_RESOURCE, COPY_SOURCE) } });
+
+	FailedCount += !RunCase("A split ended in the batch it began becomes a full barrier", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(1, RENDER_TARGET);
+		Batcher.BeginTransition(&ResourceA, StateA, ALL, PIXEL_SHADER_RESOURCE);
+		Batcher.EndTransition(&ResourceA, ALL);
+		Flush();
+	}, { { MakeBarrier(&ResourceA, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE) } });
+
+	FailedCount += !RunCase("Pending splits end with the command list", [](XBarrierBatcher& Batcher, const std::function<void()>& Flush)
+	{
+		XResourceState StateA(2, RENDER_TARGET);
+		XResourceState StateB(1, UNORDERED_ACCESS);
+		Batcher.BeginTransition(&ResourceA, StateA, 1, PIXEL_SHADER_RESOURCE);
+		Batcher.BeginTransition(&ResourceB, StateB, ALL, VERTEX_AND_CONSTANT_BUFFER);
+		Flush();
+		Batcher.EndPendingTransitions();
+		Flush();
+	}, { { MakeBarrier(&ResourceA, 1, RENDER_TARGET, PIXEL_SHADER_RESOURCE, BEGIN), MakeBarrier(&ResourceB, ALL, UNORDERED_ACCESS, VERTEX_AND_CONSTANT_BUFFER, BEGIN) },
+		{ MakeBarrier(&ResourceA, 1, RENDER_TARGET, PIXEL_SHADER_RESOURCE, END), MakeBarrier(&ResourceB, ALL, UNORDERED_ACCESS, VERTEX_AND_CONSTANT_BUFFER, END) } });
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
@@ -0,0 +1,170 @@
+// Records a synthetic frame into XCommandStream and replays it into XNullCommandTarget, without a device:
+// reports the CPU cost of recording and replaying and the encoded size, then checks that the null target
+// accepts the frame and rejects a few broken streams.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o CommandStream Tools/CommandStream/CommandStream.cpp
+//
+// Usage: CommandStream [DrawCount] [FrameCount]
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/CommandStream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Fake objects, only their addresses are used
+static int PipelineState = 0;
+static int ComputePipelineState = 0;
+static int RootSignature = 0;
+static int SceneColor = 0;
+static int InstanceBuffer = 0;
+static int StagingBuffer = 0;
+
+// A few D3D12_RESOURCE_STATES values
+static const uint32_t RENDER_TARGET = 0x4;
+static const uint32_t UNORDERED_ACCESS = 0x8;
+static const uint32_t PIXEL_SHADER_RESOURCE = 0x80;
+static const uint32_t COPY_DEST = 0x400;
+
+static XBarrierBatcher::XBarrier MakeBarrier(void* Resource, uint32_t StateBefore, uint32_t StateAfter)
+{
+	XBarrierBatcher::XBarrier Barrier;
+	Barrier.Resource = Resource;
+	Barrier.StateBefore = StateBefore;
+	Barrier.StateAfter = StateAfter;
+
+	return Barrier;
+}
+
+// Upload, scene pass with DrawCount draws, then a compute post process
+static void RecordFrame(XCommandTarget& Target, uint32_t DrawCount)
+{
+	Target.CopyBufferRegion(&InstanceBuffer, 0, &StagingBuffer, 0, 64 * 1024);
+
+	const XBarrierBatcher::XBarrier SceneBarriers[] = { MakeBarrier(&SceneColor, PIXEL_SHADER_RESOURCE, RENDER_TARGET), MakeBarrier(&InstanceBuffer, COPY_DEST, PIXEL_SHADER_RESOURCE) };
+	Target.ResourceBarriers(2, SceneBarriers);
+
+	Target.SetPipelineState(&PipelineState);
+	Target.SetRootSignature(&RootSignature, false);
+	Target.SetRootDescriptorTable(2, 0x10000, false);
+
+	for (uint32_t i = 0; i < DrawCount; i++)
+	{
+		const uint32_t Constants[4] = { i, i * 3, 7, 0 };
+
+		Target.SetRootConstantBufferView(0, 0x200000 + i * 256, false);
+		Target.SetRootConstants(1, 4, Constants, false);
+		Target.SetVertexBuffer(0, 0x400000 + i * 4096, 4096, 32);
+		Target.SetIndexBuffer(0x800000 + i * 1024, 1024, 42);
+		Target.DrawIndexed(512, 1, 0, 0, 0);
+	}
+
+	const XBarrierBatcher::XBarrier PostBarriers[] = { MakeBarrier(&SceneColor, RENDER_TARGET, UNORDERED_ACCESS) };
+	Target.ResourceBarriers(1, PostBarriers);
+
+	Target.SetPipelineState(&ComputePipelineState);
+	Target.SetRootSignature(&RootSignature, true);
+	Target.SetRootDescriptorTable(0, 0x20000, true);
+	Target.Dispatch(120, 68, 1);
+}
+
+static double ElapsedNs(std::chrono::high_resolution_clock::time_point Start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+static uint32_t CheckErrors(const char* Name, const XCommandStream& Stream, uint64_t ExpectedErrorCount)
+{
+	XNullCommandTarget Target;
+	Stream.Replay(Target);
+
+	const bool bPassed = Target.GetStats().ErrorCount == ExpectedErrorCount;
+	printf("%s %s: %llu errors\n", bPassed ? "PASS" : "FAIL", Name, (unsigned long long)Target.GetStats().ErrorCount);
+	for (const std::string& Error : Target.GetErrors())
+	{
+		printf("    %s\n", Error.c_str());
+	}
+
+	return bPassed ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t DrawCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 5000;
+	const uint32_t FrameCount = argc > 2 ? (uint32_t)atoi(argv[2]) : 100;
+
+	if (FrameCount == 0)
+	{
+		printf("Usage: %s [DrawCount] [FrameCount]\n", argv[0]);
+		return 1;
+	}
+
+	// Cost of the CPU side submission, the stream keeps its memory between frames
+	XCommandStream Stream;
+	XNullCommandTarget NullTarget;
+	double RecordTime = 0.0;
+	double ReplayTime = 0.0;
+	double DirectTime = 0.0;
+
+	for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+	{
+		auto Start = std::chrono::high_resolution_clock::now();
+		Stream.Reset();
+		RecordFrame(Stream, DrawCount);
+		RecordTime += ElapsedNs(Start);
+
+		Start = std::chrono::high_resolution_clock::now();
+		NullTarget.ResetState();
+		Stream.Replay(NullTarget);
+		ReplayTime += ElapsedNs(Start);
+
+		// Same frame issued to the target without the stream
+		Start = std::chrono::high_resolution_clock::now();
+		NullTarget.ResetState();
+		RecordFrame(NullTarget, DrawCount);
+		DirectTime += ElapsedNs(Start);
+	}
+
+	const double CommandCount = (double)Stream.GetCommandCount();
+	printf("%u draws, %u commands, %zu bytes (%.1f bytes/command)\n", DrawCount, Stream.GetCommandCount(), Stream.GetSize(), Stream.GetSize() / CommandCount);
+	printf("record %.1f ns/command, replay %.1f ns/command, direct %.1f ns/command\n",
+		RecordTime / FrameCount / CommandCount, ReplayTime / FrameCount / CommandCount, DirectTime / FrameCount / CommandCount);
+
+	uint32_t FailedCount = 0;
+
+	FailedCount += CheckErrors("Recorded frame", Stream, 0);
+
+	{
+		const XNullCommandTarget::Stats& Stats = NullTarget.GetStats();
+		const bool bPassed = Stats.CommandCounts[(uint32_t)ECommandType::DrawIndexed] == 2ull * DrawCount * FrameCount
+			&& Stats.BarrierCount == 6ull * FrameCount && Stats.ErrorCount == 0;
+		printf("%s Replay and direct calls count the same commands\n", bPassed ? "PASS" : "FAIL");
+		FailedCount += bPassed ? 0 : 1;
+	}
+
+	{
+		XCommandStream Broken;
+		Broken.DrawIndexed(3, 1, 0, 0, 0);
+		FailedCount += CheckErrors("Draw without pipeline state", Broken, 2);
+	}
+
+	{
+		const XBarrierBatcher::XBarrier Barriers[] = { MakeBarrier(&SceneColor, RENDER_TARGET, RENDER_TARGET) };
+		XCommandStream Broken;
+		Broken.ResourceBarriers(1, Barriers);
+		Broken.CopyBufferRegion(&InstanceBuffer, 0, &InstanceBuffer, 128, 256);
+		FailedCount += CheckErrors("No-op barrier and overlapping copy", Broken, 2);
+	}
+
+	{
+		XCommandStream Broken;
+		Broken.SetPipelineState(&ComputePipelineState);
+		Broken.SetRootSignature(&RootSignature, false);
+		Broken.Dispatch(1, 1, 1);
+		FailedCount += CheckErrors("Dispatch with the graphics root signature", Broken, 1);
+	}
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
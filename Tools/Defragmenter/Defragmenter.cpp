@@ -0,0 +1,202 @@
+// Checks the planning of XDefragmenter against a mock copy queue and fake pools, without a device:
+// the byte budget of a step, the direction of the moves, the pools left alone and the order of the callbacks.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o Defragmenter Tools/Defragmenter/Defragmenter.cpp
+//
+// Usage: Defragmenter
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/Defragmenter.h"
+#include <stdio.h>
+
+static constexpr uint64_t PoolSize = 1024 * 1024;
+
+static constexpr uint64_t BlockSize = 64 * 1024;
+
+// Bump allocated pool, enough to see where the defragmenter places the blocks
+struct XFakePool
+{
+	uint64_t UsedSize = 0;
+
+	// Stand-in for the backing resource handed to the copy queue
+	int Resource = 0;
+};
+
+struct XFakeAllocation
+{
+	uint32_t PoolIndex = 0;
+
+	uint64_t Offset = 0;
+
+	uint32_t RelocationCount = 0;
+};
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+// Fills Pools with the usage of the fake pools and Candidates with every allocation
+static void Snapshot(std::vector<XFakePool>& FakePools, std::vector<XFakeAllocation>& Allocations,
+	std::vector<XDefragmenter::Pool>& OutPools, std::vector<XDefragmenter::Candidate>& OutCandidates)
+{
+	OutPools.resize(FakePools.size());
+	for (size_t i = 0; i < FakePools.size(); i++)
+	{
+		OutPools[i].Stats.PoolSize = PoolSize;
+		OutPools[i].Stats.AllocatedSize = FakePools[i].UsedSize;
+		OutPools[i].Stats.FreeSize = PoolSize - FakePools[i].UsedSize;
+		OutPools[i].Stats.LargestFreeBlock = PoolSize - FakePools[i].UsedSize;
+		OutPools[i].Resource = &FakePools[i].Resource;
+	}
+
+	OutCandidates.clear();
+	for (XFakeAllocation& Allocation : Allocations)
+	{
+		XDefragmenter::Candidate Candidate;
+		Candidate.Handle = &Allocation;
+		Candidate.PoolIndex = Allocation.PoolIndex;
+		Candidate.Offset = Allocation.Offset;
+		Candidate.Size = BlockSize;
+		OutCandidates.push_back(Candidate);
+	}
+}
+
+static void AddAllocations(std::vector<XFakePool>& FakePools, std::vector<XFakeAllocation>& Allocations, uint32_t PoolIndex, uint32_t Count)
+{
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		XFakeAllocation Allocation;
+		Allocation.PoolIndex = PoolIndex;
+		Allocation.Offset = FakePools[PoolIndex].UsedSize;
+		FakePools[PoolIndex].UsedSize += BlockSize;
+		Allocations.push_back(Allocation);
+	}
+}
+
+int main()
+{
+	uint32_t FailedCount = 0;
+
+	// 16 blocks per pool: pool 0 is 25% used, pool 1 75%, pool 2 12.5% and pool 3 62.5%
+	std::vector<XFakePool> FakePools(4);
+	std::vector<XFakeAllocation> Allocations;
+	Allocations.reserve(64);
+	AddAllocations(FakePools, Allocations, 0, 4);
+	AddAllocations(FakePools, Allocations, 1, 12);
+	AddAllocations(FakePools, Allocations, 2, 2);
+	AddAllocations(FakePools, Allocations, 3, 10);
+
+	XDefragmenter Defragmenter;
+	XMockCopyQueue CopyQueue;
+
+	std::vector<XDefragmenter::Pool> Pools;
+	std::vector<XDefragmenter::Candidate> Candidates;
+
+	bool bCopyBeforeRelocation = true;
+	std::vector<uint64_t> OldOffsets;
+
+	auto AllocateFunc = [&FakePools](uint32_t DstPoolIndex, const XDefragmenter::Candidate& Candidate, uint64_t& OutOffset)
+	{
+		if (FakePools[DstPoolIndex].UsedSize + Candidate.Size > PoolSize)
+		{
+			return false;
+		}
+
+		OutOffset = FakePools[DstPoolIndex].UsedSize;
+		FakePools[DstPoolIndex].UsedSize += Candidate.Size;
+
+		return true;
+	};
+
+	auto RelocateFunc = [&](const XDefragmenter::Candidate& Candidate)
+	{
+		XFakeAllocation* Allocation = (XFakeAllocation*)Candidate.Handle;
+
+		// The copy that moved this allocation is the last one recorded
+		const XMockCopyQueue::Copy& Copy = CopyQueue.Copies.back();
+		bCopyBeforeRelocation = bCopyBeforeRelocation && Copy.SrcResource == &FakePools[Allocation->PoolIndex].Resource
+			&& Copy.SrcOffset == Allocation->Offset && Copy.Size == Candidate.Size;
+
+		OldOffsets.push_back(Allocation->Offset);
+
+		FakePools[Allocation->PoolIndex].UsedSize -= Candidate.Size;
+		for (uint32_t i = 0; i < (uint32_t)FakePools.size(); i++)
+		{
+			if (Copy.DstResource == &FakePools[i].Resource)
+			{
+				Allocation->PoolIndex = i;
+			}
+		}
+		Allocation->Offset = Copy.DstOffset;
+		Allocation->RelocationCount++;
+	};
+
+	{
+		Snapshot(FakePools, Allocations, Pools, Candidates);
+
+		// Two and a half blocks of budget
+		const uint64_t MovedSize = Defragmenter.Step(Pools, Candidates, CopyQueue, BlockSize * 5 / 2, AllocateFunc, RelocateFunc);
+
+		FailedCount += Check("A step stays within its byte budget", MovedSize == 2 * BlockSize && CopyQueue.CopiedSize == MovedSize && CopyQueue.Copies.size() == 2);
+
+		bool bLeastToMost = true;
+		for (const XMockCopyQueue::Copy& Copy : CopyQueue.Copies)
+		{
+			bLeastToMost = bLeastToMost && Copy.SrcResource == &FakePools[2].Resource && Copy.DstResource == &FakePools[1].Resource;
+		}
+		FailedCount += Check("The least used pool moves into the most used one", bLeastToMost);
+
+		FailedCount += Check("Each move is copied then relocated once", bCopyBeforeRelocation && OldOffsets.size() == 2
+			&& Allocations[16].RelocationCount == 1 && Allocations[17].RelocationCount == 1 && Allocations[16].PoolIndex == 1
+			&& Allocations[16].Offset == 12 * BlockSize && Allocations[17].Offset == 13 * BlockSize);
+	}
+
+	{
+		CopyQueue.Reset();
+		OldOffsets.clear();
+		Snapshot(FakePools, Allocations, Pools, Candidates);
+
+		const uint64_t MovedSize = Defragmenter.Step(Pools, Candidates, CopyQueue, PoolSize, AllocateFunc, RelocateFunc);
+
+		// Pool 1 has room for 2 more blocks, the others of pool 0 go to pool 3
+		uint32_t IntoFullest = 0;
+		uint32_t IntoNext = 0;
+		bool bOnlyFromPool0 = true;
+		for (const XMockCopyQueue::Copy& Copy : CopyQueue.Copies)
+		{
+			bOnlyFromPool0 = bOnlyFromPool0 && Copy.SrcResource == &FakePools[0].Resource;
+			IntoFullest += Copy.DstResource == &FakePools[1].Resource ? 1 : 0;
+			IntoNext += Copy.DstResource == &FakePools[3].Resource ? 1 : 0;
+		}
+
+		FailedCount += Check("A full destination falls back to the next most used pool", MovedSize == 4 * BlockSize && IntoFullest == 2 && IntoNext == 2);
+		FailedCount += Check("Pools used above the source limit are not evacuated", bOnlyFromPool0 && FakePools[0].UsedSize == 0 && FakePools[2].UsedSize == 0);
+	}
+
+	{
+		CopyQueue.Reset();
+		Snapshot(FakePools, Allocations, Pools, Candidates);
+
+		const uint64_t MovedSize = Defragmenter.Step(Pools, Candidates, CopyQueue, PoolSize, AllocateFunc, RelocateFunc);
+
+		// Pools 1 and 3 are both above the limit, moving between them would only bounce the blocks around
+		FailedCount += Check("Nothing moves once the sparse pools are empty", MovedSize == 0 && CopyQueue.Copies.empty());
+	}
+
+	{
+		uint32_t RelocationCount = 0;
+		for (const XFakeAllocation& Allocation : Allocations)
+		{
+			RelocationCount += Allocation.RelocationCount;
+		}
+
+		FailedCount += Check("Every move was relocated exactly once", RelocationCount == 6);
+	}
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
@@ -0,0 +1,140 @@
+// Checks XFenceWaiter against software fences completed by a thread standing in for the GPU, without a device:
+// waits for all and any of several fences, timeouts, merged waits and the reuse of the pooled events.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -pthread -o FenceWaiter Tools/FenceWaiter/FenceWaiter.cpp
+//
+// Usage: FenceWaiter [WaitCount]
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/FenceWaiter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+// Complete Fence up to FenceValue on another thread after DelayMs
+static std::thread CompleteLater(XSoftwareFence& Fence, uint64_t FenceValue, uint32_t DelayMs)
+{
+	return std::thread([&Fence, FenceValue, DelayMs]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(DelayMs));
+		Fence.Complete(FenceValue);
+	});
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t WaitCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000;
+
+	XSoftwareWaitEventBackend Backend;
+	uint32_t FailedCount = 0;
+
+	{
+		XFenceWaiter Waiter(&Backend);
+		XSoftwareFence Fence(&Backend);
+		Fence.Complete(Fence.Signal());
+
+		const bool bCompleted = Waiter.Wait(&Fence, 1, 0);
+		FailedCount += Check("A completed value is answered without an event", bCompleted && Waiter.GetStats().CompletedCount == 1 && Waiter.GetStats().EventCount == 0);
+	}
+
+	{
+		XFenceWaiter Waiter(&Backend);
+		XSoftwareFence FenceA(&Backend);
+		XSoftwareFence FenceB(&Backend);
+		const XFenceWait Waits[] = { { &FenceA, FenceA.Signal() }, { &FenceB, FenceB.Signal() } };
+
+		std::thread GpuA = CompleteLater(FenceA, 1, 5);
+		std::thread GpuB = CompleteLater(FenceB, 1, 20);
+		const bool bCompleted = Waiter.WaitForAll(Waits, 2);
+		const bool bBothComplete = FenceA.GetCompletedValue() == 1 && FenceB.GetCompletedValue() == 1;
+		GpuA.join();
+		GpuB.join();
+
+		FailedCount += Check("Wait for all returns once every fence is complete", bCompleted && bBothComplete);
+	}
+
+	{
+		XFenceWaiter Waiter(&Backend);
+		XSoftwareFence FenceA(&Backend);
+		XSoftwareFence FenceB(&Backend);
+		const XFenceWait Waits[] = { { &FenceA, FenceA.Signal() }, { &FenceB, FenceB.Signal() } };
+
+		std::thread GpuB = CompleteLater(FenceB, 1, 5);
+		const uint32_t CompletedIndex = Waiter.WaitForAny(Waits, 2);
+		GpuB.join();
+
+		FailedCount += Check("Wait for any returns the first fence to complete", CompletedIndex == 1 && FenceA.GetCompletedValue() == 0);
+
+		// The event armed on FenceA is reused once FenceA signals it
+		FenceA.Complete(1);
+		FenceB.Signal();
+		std::thread Gpu = CompleteLater(FenceB, 2, 5);
+		const bool bCompleted = Waiter.Wait(&FenceB, 2);
+		Gpu.join();
+
+		FailedCount += Check("Events left armed by wait for any are recycled", bCompleted && Waiter.GetStats().EventCount == 2);
+	}
+
+	{
+		XFenceWaiter Waiter(&Backend);
+		XSoftwareFence Fence(&Backend);
+		const XFenceWait Waits[] = { { &Fence, Fence.Signal() }, { &Fence, Fence.Signal() }, { &Fence, Fence.Signal() } };
+
+		const bool bTimedOut = !Waiter.WaitForAll(Waits, 3, 10);
+		const uint32_t AnyIndex = Waiter.WaitForAny(Waits, 3, 10);
+		const XFenceWaiter::Stats Stats = Waiter.GetStats();
+
+		FailedCount += Check("Waits time out", bTimedOut && AnyIndex == XFenceWaiter::NoneCompleted && Stats.TimeoutCount == 2);
+		// One event per wait, the one of the timed out wait stays armed
+		FailedCount += Check("Waits on the same fence are merged", Stats.MergedCount == 4 && Stats.EventCount == 2);
+
+		Fence.Complete(2);
+		FailedCount += Check("Wait for any picks a completed value", Waiter.WaitForAny(Waits, 3, 0) == 0 && !Waiter.WaitForAll(Waits, 3, 0));
+	}
+
+	{
+		// A GPU thread completes the values as the CPU waits for them, the CPU never runs ahead
+		XFenceWaiter Waiter(&Backend);
+		XSoftwareFence Fence(&Backend);
+		std::atomic<uint64_t> SubmittedValue = { 0 };
+
+		std::thread Gpu([&]()
+		{
+			for (uint64_t Value = 1; Value <= WaitCount; Value++)
+			{
+				while (SubmittedValue.load() < Value)
+				{
+					std::this_thread::yield();
+				}
+
+				Fence.Complete(Value);
+			}
+		});
+
+		bool bOrdered = true;
+		for (uint32_t i = 0; i < WaitCount; i++)
+		{
+			const uint64_t Value = Fence.Signal();
+			SubmittedValue.store(Value);
+
+			bOrdered &= Waiter.Wait(&Fence, Value) && Fence.GetCompletedValue() >= Value;
+		}
+
+		Gpu.join();
+
+		const XFenceWaiter::Stats Stats = Waiter.GetStats();
+		printf("%llu waits, %llu answered without blocking, %u events\n", (unsigned long long)Stats.WaitCount, (unsigned long long)Stats.CompletedCount, Stats.EventCount);
+		FailedCount += Check("Repeated waits reuse one event", bOrdered && Stats.WaitCount == WaitCount && Stats.EventCount <= 1);
+	}
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
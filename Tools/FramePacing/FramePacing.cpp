@@ -0,0 +1,85 @@
+// Simulates the frame loop of D3D12CommandContext against a GPU with a given cost and latency,
+// and reports how much the CPU and the GPU overlap for each depth of the frame ring.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o FramePacing Tools/FramePacing/FramePacing.cpp
+//
+// Usage: FramePacing [CpuFrameTime] [GpuFrameTime] [Latency] [FrameCount] [Jitter]
+//        Times in microseconds, each frame's CPU and GPU times vary randomly by up to Jitter percent
+
+#include "../../XD3DRenderer/Common/FrameRing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+static void RunSimulation(uint32_t FramesInFlight, uint64_t CpuFrameTime, uint64_t GpuFrameTime, uint64_t Latency, uint32_t FrameCount, uint32_t Jitter)
+{
+	XSimulatedCommandQueue Queue(Latency);
+	XFrameRing FrameRing;
+	FrameRing.Initialize(FramesInFlight, &Queue);
+
+	std::mt19937 Random(1234);
+	auto Vary = [&Random, Jitter](uint64_t Time)
+	{
+		if (Jitter == 0)
+		{
+			return Time;
+		}
+
+		const int64_t Delta = (int64_t)(Time * Jitter / 100);
+		return (uint64_t)((int64_t)Time - Delta + (int64_t)(Random() % (uint32_t)(2 * Delta + 1)));
+	};
+
+	uint32_t MaxFramesInFlight = 0;
+	for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+	{
+		FrameRing.BeginFrame();
+
+		// Record the frame, then submit it
+		Queue.AdvanceCpuTime(Vary(CpuFrameTime));
+		Queue.Submit(Vary(GpuFrameTime));
+
+		FrameRing.EndFrame();
+
+		const uint32_t FramesPending = (uint32_t)(Queue.GetFence()->GetCurrentValue() - 1 - Queue.GetFence()->GetCompletedValue());
+		MaxFramesInFlight = FramesPending > MaxFramesInFlight ? FramesPending : MaxFramesInFlight;
+	}
+
+	const uint64_t CpuTime = Queue.GetCpuTime();
+	FrameRing.WaitForIdle();
+	const uint64_t TotalTime = Queue.GetCpuTime();
+
+	printf("%6u %12.1f %9.1f%% %9.1f%% %8llu %10u\n",
+		FramesInFlight,
+		(double)CpuTime / FrameCount,
+		100.0 * (double)(Queue.GetCpuStallTime() - (TotalTime - CpuTime)) / (double)CpuTime,
+		100.0 * (double)Queue.GetGpuBusyTime() / (double)TotalTime,
+		(unsigned long long)FrameRing.GetStallCount(),
+		MaxFramesInFlight);
+}
+
+int main(int argc, char** argv)
+{
+	const uint64_t CpuFrameTime = argc > 1 ? (uint64_t)atoll(argv[1]) : 8000;
+	const uint64_t GpuFrameTime = argc > 2 ? (uint64_t)atoll(argv[2]) : 10000;
+	const uint64_t Latency = argc > 3 ? (uint64_t)atoll(argv[3]) : 1000;
+	const uint32_t FrameCount = argc > 4 ? (uint32_t)atoi(argv[4]) : 1000;
+	const uint32_t Jitter = argc > 5 ? (uint32_t)atoi(argv[5]) : 20;
+
+	if (FrameCount == 0 || Jitter > 100)
+	{
+		printf("Usage: %s [CpuFrameTime] [GpuFrameTime] [Latency] [FrameCount] [Jitter]\n", argv[0]);
+		return 1;
+	}
+
+	printf("CPU %llu us, GPU %llu us, latency %llu us, %u frames, jitter %u%%\n",
+		(unsigned long long)CpuFrameTime, (unsigned long long)GpuFrameTime, (unsigned long long)Latency, FrameCount, Jitter);
+	printf("%6s %12s %10s %10s %8s %10s\n", "Frames", "us/frame", "CPU stall", "GPU busy", "Stalls", "MaxPending");
+
+	// 1 is the previous behaviour, waiting for the GPU at the end of every frame
+	for (uint32_t FramesInFlight = 1; FramesInFlight <= 4; FramesInFlight++)
+	{
+		RunSimulation(FramesInFlight, CpuFrameTime, GpuFrameTime, Latency, FrameCount, Jitter);
+	}
+
+	return 0;
+}
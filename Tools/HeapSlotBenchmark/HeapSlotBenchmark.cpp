@@ -0,0 +1,201 @@
+// Measures descriptor slot allocation with the bitmap core of D3D12HeapSlotAllocator, against the
+// range free list it replaced. Descriptor heaps are faked with a base address and a descriptor size,
+// so it builds and runs without a GPU, e.g.
+//     g++ -std=c++17 -O2 -o HeapSlotBenchmark Tools/HeapSlotBenchmark/HeapSlotBenchmark.cpp
+//
+// Usage: HeapSlotBenchmark [DescriptorsPerHeap] [LiveViewCount] [OperationCount] [DescriptorSize]
+
+#include "../../XD3DRenderer/Common/HeapSlotAllocatorCore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <random>
+#include <chrono>
+
+struct FakeSlot
+{
+	uint32_t HeapIndex;
+
+	uint64_t Handle;
+};
+
+// Same handle arithmetic as D3D12HeapSlotAllocator
+class BitmapSlotAllocator
+{
+public:
+	BitmapSlotAllocator(uint32_t InDescriptorsPerHeap, uint32_t InDescriptorSize)
+		: DescriptorSize(InDescriptorSize), SlotCore(InDescriptorsPerHeap)
+	{
+	}
+
+	FakeSlot Allocate()
+	{
+		XHeapSlotAllocatorCore::Slot CoreSlot;
+		if (!SlotCore.Allocate(CoreSlot))
+		{
+			HeapBases.push_back(FakeHeapBase(SlotCore.AddHeap()));
+			SlotCore.Allocate(CoreSlot);
+		}
+
+		return { CoreSlot.HeapIndex, HeapBases[CoreSlot.HeapIndex] + (uint64_t)CoreSlot.SlotIndex * DescriptorSize };
+	}
+
+	void Free(const FakeSlot& Slot)
+	{
+		SlotCore.Deallocate(Slot.HeapIndex, (uint32_t)((Slot.Handle - HeapBases[Slot.HeapIndex]) / DescriptorSize));
+	}
+
+	uint32_t GetHeapCount() const { return SlotCore.GetHeapCount(); }
+
+	static uint64_t FakeHeapBase(uint32_t HeapIndex) { return (uint64_t)(HeapIndex + 1) << 32; }
+
+private:
+	uint32_t DescriptorSize;
+
+	XHeapSlotAllocatorCore SlotCore;
+
+	std::vector<uint64_t> HeapBases;
+};
+
+// The previous D3D12HeapSlotAllocator, a sorted list of free ranges per heap
+class FreeListSlotAllocator
+{
+public:
+	FreeListSlotAllocator(uint32_t InDescriptorsPerHeap, uint32_t InDescriptorSize)
+		: DescriptorsPerHeap(InDescriptorsPerHeap), DescriptorSize(InDescriptorSize)
+	{
+	}
+
+	FakeSlot Allocate()
+	{
+		int EntryIndex = -1;
+		for (int i = 0; i < (int)Heaps.size(); i++)
+		{
+			if (Heaps[i].size() > 0)
+			{
+				EntryIndex = i;
+				break;
+			}
+		}
+
+		if (EntryIndex == -1)
+		{
+			const uint64_t HeapBase = BitmapSlotAllocator::FakeHeapBase((uint32_t)Heaps.size());
+			Heaps.emplace_back();
+			Heaps.back().push_back({ HeapBase, HeapBase + (uint64_t)DescriptorsPerHeap * DescriptorSize });
+			EntryIndex = (int)Heaps.size() - 1;
+		}
+
+		FreeRange& Range = Heaps[EntryIndex].front();
+		FakeSlot Slot = { (uint32_t)EntryIndex, Range.Start };
+
+		Range.Start += DescriptorSize;
+		if (Range.Start == Range.End)
+		{
+			Heaps[EntryIndex].pop_front();
+		}
+
+		return Slot;
+	}
+
+	void Free(const FakeSlot& Slot)
+	{
+		std::list<FreeRange>& FreeList = Heaps[Slot.HeapIndex];
+		FreeRange NewRange = { Slot.Handle, Slot.Handle + DescriptorSize };
+
+		for (auto Node = FreeList.begin(); Node != FreeList.end(); Node++)
+		{
+			if (Node->Start == NewRange.End)
+			{
+				Node->Start = NewRange.Start;
+				return;
+			}
+			else if (Node->End == NewRange.Start)
+			{
+				Node->End = NewRange.End;
+				return;
+			}
+			else if (Node->Start > NewRange.Start)
+			{
+				FreeList.insert(Node, NewRange);
+				return;
+			}
+		}
+
+		FreeList.push_back(NewRange);
+	}
+
+	uint32_t GetHeapCount() const { return (uint32_t)Heaps.size(); }
+
+private:
+	struct FreeRange
+	{
+		uint64_t Start;
+
+		uint64_t End;
+	};
+
+	uint32_t DescriptorsPerHeap;
+
+	uint32_t DescriptorSize;
+
+	std::vector<std::list<FreeRange>> Heaps;
+};
+
+// Fill LiveViewCount views, then free a random view and create a new one OperationCount times
+template<typename AllocatorType>
+static void RunBenchmark(const char* Name, uint32_t DescriptorsPerHeap, uint32_t DescriptorSize, uint32_t LiveViewCount, uint32_t OperationCount)
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	AllocatorType Allocator(DescriptorsPerHeap, DescriptorSize);
+	std::vector<FakeSlot> LiveSlots;
+	LiveSlots.reserve(LiveViewCount);
+	std::mt19937 Random(1234);
+
+	const Clock::time_point FillStart = Clock::now();
+	for (uint32_t i = 0; i < LiveViewCount; i++)
+	{
+		LiveSlots.push_back(Allocator.Allocate());
+	}
+	const Clock::time_point ChurnStart = Clock::now();
+
+	for (uint32_t i = 0; i < OperationCount; i++)
+	{
+		const uint32_t Index = Random() % LiveViewCount;
+		Allocator.Free(LiveSlots[Index]);
+		LiveSlots[Index] = Allocator.Allocate();
+	}
+	const Clock::time_point End = Clock::now();
+
+	const double FillNanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(ChurnStart - FillStart).count();
+	const double ChurnNanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(End - ChurnStart).count();
+
+	printf("%-9s %8u %12.1f %14.1f\n",
+		Name,
+		Allocator.GetHeapCount(),
+		FillNanoseconds / LiveViewCount,
+		OperationCount == 0 ? 0.0 : ChurnNanoseconds / (2.0 * OperationCount));
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t DescriptorsPerHeap = argc > 1 ? (uint32_t)atoi(argv[1]) : 200;
+	const uint32_t LiveViewCount = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000;
+	const uint32_t OperationCount = argc > 3 ? (uint32_t)atoi(argv[3]) : 200000;
+	const uint32_t DescriptorSize = argc > 4 ? (uint32_t)atoi(argv[4]) : 32;
+
+	if (DescriptorsPerHeap == 0 || LiveViewCount == 0 || DescriptorSize == 0)
+	{
+		printf("Usage: %s [DescriptorsPerHeap] [LiveViewCount] [OperationCount] [DescriptorSize]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%u descriptors per heap, %u live views, %u operations, descriptor size %u\n", DescriptorsPerHeap, LiveViewCount, OperationCount, DescriptorSize);
+	printf("%-9s %8s %12s %14s\n", "Alloc", "Heaps", "Fill ns/op", "Churn ns/op");
+
+	RunBenchmark<BitmapSlotAllocator>("Bitmap", DescriptorsPerHeap, DescriptorSize, LiveViewCount, OperationCount);
+	RunBenchmark<FreeListSlotAllocator>("FreeList", DescriptorsPerHeap, DescriptorSize, LiveViewCount, OperationCount);
+
+	return 0;
+}
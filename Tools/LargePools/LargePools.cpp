@@ -0,0 +1,151 @@
+// Checks the buddy, TLSF and linear ring cores with pools, sizes and offsets above 4 GB, without a device:
+// the cores only do the bookkeeping, so a 16 GB pool costs a few hundred KB of side arrays.
+// Allocates, frees and merges blocks on both sides of the 4 GB boundary and checks that nothing is truncated.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o LargePools Tools/LargePools/LargePools.cpp
+//
+// Usage: LargePools
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/BuddyAllocatorCore.h"
+#include "../../XD3DRenderer/Common/TLSFAllocatorCore.h"
+#include "../../XD3DRenderer/Common/LinearRingAllocatorCore.h"
+#include <stdio.h>
+
+static constexpr uint64_t GB = 1024ull * 1024 * 1024;
+
+static constexpr uint64_t PoolSize = 16 * GB;
+
+static constexpr uint32_t BlockSize = 64 * 1024;
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+static uint32_t CheckBuddy()
+{
+	uint32_t FailedCount = 0;
+
+	XBuddyAllocatorCore Buddy(PoolSize, BlockSize);
+
+	// 8 GB, 4 GB, 2 GB and 2 GB blocks, in this order from the start of the pool
+	XBuddyAllocatorCore::Allocation A, B, C, D;
+	const bool bAllocated = Buddy.Allocate(5 * GB, 0, A) && Buddy.Allocate(3 * GB, 0, B) && Buddy.Allocate(3 * GB / 2, 0, C) && Buddy.Allocate(2 * GB, 0, D);
+
+	FailedCount += Check("Buddy: blocks above 4 GB get their full offset", bAllocated && A.AlignedOffsetInBytes == 0
+		&& B.AlignedOffsetInBytes == 8 * GB && C.AlignedOffsetInBytes == 12 * GB && D.AlignedOffsetInBytes == 14 * GB);
+	FailedCount += Check("Buddy: allocated size is counted in 64-bit", Buddy.GetTotalAllocSize() == PoolSize && !Buddy.CanAllocate(BlockSize));
+
+	// 5 GB rounds up to 2^33, 3 GB to 2^32, 1.5 GB and 2 GB to 2^31
+	const XAllocatorStats FullStats = Buddy.GetStats();
+	FailedCount += Check("Buddy: allocations of 2 GB and more get their own histogram buckets", FullStats.AllocationSizeHistogram[33] == 1
+		&& FullStats.AllocationSizeHistogram[32] == 1 && FullStats.AllocationSizeHistogram[31] == 2);
+
+	Buddy.Deallocate(C.Offset, C.Order, 3 * GB / 2);
+	Buddy.Deallocate(D.Offset, D.Order, 2 * GB);
+	FailedCount += Check("Buddy: freed buddies above 4 GB merge", Buddy.CanAllocate(4 * GB) && !Buddy.CanAllocate(4 * GB + 1));
+
+	Buddy.Deallocate(B.Offset, B.Order, 3 * GB);
+
+	XBuddyAllocatorCore::Allocation E;
+	FailedCount += Check("Buddy: the upper half merges back to 8 GB", Buddy.Allocate(6 * GB, 0, E) && E.AlignedOffsetInBytes == 8 * GB);
+
+	Buddy.Deallocate(A.Offset, A.Order, 5 * GB);
+	Buddy.Deallocate(E.Offset, E.Order, 6 * GB);
+
+	const XAllocatorStats Stats = Buddy.GetStats();
+	FailedCount += Check("Buddy: everything merges back into one 16 GB block", Buddy.GetTotalAllocSize() == 0 && Stats.FreeBlockCount == 1
+		&& Stats.FreeSize == PoolSize && Stats.LargestFreeBlock == PoolSize && Stats.FreeBlockHistogram[34] == 1);
+
+	XBuddyAllocatorCore::Allocation Whole;
+	FailedCount += Check("Buddy: the whole pool can be allocated", Buddy.Allocate(PoolSize, 0, Whole) && Whole.AlignedOffsetInBytes == 0);
+
+	return FailedCount;
+}
+
+static uint32_t CheckTLSF()
+{
+	uint32_t FailedCount = 0;
+
+	XTLSFAllocatorCore TLSF(PoolSize, BlockSize);
+
+	XTLSFAllocatorCore::Allocation A, B, C;
+	const bool bAllocated = TLSF.Allocate(5 * GB, 0, A) && TLSF.Allocate(5 * GB, 0, B) && TLSF.Allocate(5 * GB, 0, C);
+
+	FailedCount += Check("TLSF: blocks above 4 GB get their full offset and size", bAllocated && A.OffsetInBytes == 0 && B.OffsetInBytes == 5 * GB
+		&& C.OffsetInBytes == 10 * GB && C.SizeInBytes == 5 * GB);
+	FailedCount += Check("TLSF: allocated size is counted in 64-bit", TLSF.GetTotalAllocSize() == 15 * GB);
+
+	// Alignments the granularity does not satisfy are padded, the aligned offset stays above 4 GB
+	XTLSFAllocatorCore::Allocation Aligned;
+	const uint32_t Alignment = 1024 * 1024;
+	FailedCount += Check("TLSF: aligned offsets above 4 GB", TLSF.Allocate(3 * BlockSize, Alignment, Aligned)
+		&& Aligned.OffsetInBytes == 15 * GB && Aligned.AlignedOffsetInBytes % Alignment == 0 && Aligned.AlignedOffsetInBytes >= 15 * GB);
+	TLSF.Deallocate(Aligned.BlockIndex, 3 * BlockSize);
+
+	TLSF.Deallocate(B.BlockIndex, 5 * GB);
+	FailedCount += Check("TLSF: a hole between used blocks does not merge", !TLSF.CanAllocate(6 * GB) && TLSF.GetStats().FreeBlockCount == 2);
+
+	TLSF.Deallocate(C.BlockIndex, 5 * GB);
+
+	XTLSFAllocatorCore::Allocation D;
+	FailedCount += Check("TLSF: freed neighbours above 4 GB merge", TLSF.GetStats().FreeBlockCount == 1 && TLSF.GetStats().LargestFreeBlock == 11 * GB
+		&& TLSF.Allocate(10 * GB, 0, D) && D.OffsetInBytes == 5 * GB);
+
+	TLSF.Deallocate(D.BlockIndex, 10 * GB);
+	TLSF.Deallocate(A.BlockIndex, 5 * GB);
+
+	const XAllocatorStats Stats = TLSF.GetStats();
+	FailedCount += Check("TLSF: everything merges back into one 16 GB block", TLSF.GetTotalAllocSize() == 0 && Stats.FreeBlockCount == 1
+		&& Stats.FreeSize == PoolSize && Stats.LargestFreeBlock == PoolSize && Stats.FreeBlockHistogram[34] == 1);
+
+	return FailedCount;
+}
+
+static uint32_t CheckLinearRing()
+{
+	uint32_t FailedCount = 0;
+
+	XMockFence Fence;
+	XLinearRingAllocatorCore Ring;
+	Ring.Initialize(3 * GB, 3, &Fence);
+
+	const uint64_t Frame0 = Ring.Allocate(GB, 256);
+	Fence.Signal();
+	Ring.EndFrame();
+
+	const uint64_t Frame1First = Ring.Allocate(GB, 256);
+	const uint64_t Frame1Second = Ring.Allocate(2 * GB, 256);
+	Fence.Signal();
+	Ring.EndFrame();
+
+	const uint64_t Frame2 = Ring.Allocate(3 * GB, 256);
+	Fence.Signal();
+	Ring.EndFrame();
+
+	FailedCount += Check("Ring: segments above 4 GB get their full offset", Ring.GetRingSize() == 9 * GB && Frame0 == 0
+		&& Frame1First == 3 * GB && Frame1Second == 4 * GB && Frame2 == 6 * GB);
+
+	FailedCount += Check("Ring: a segment is not reused before its fence completes", Ring.Allocate(GB, 256) == XLinearRingAllocatorCore::InvalidOffset);
+
+	Fence.Complete(1);
+	FailedCount += Check("Ring: a segment is reused once its fence completes", Ring.Allocate(GB, 256) == 0);
+
+	return FailedCount;
+}
+
+int main()
+{
+	uint32_t FailedCount = 0;
+
+	FailedCount += CheckBuddy();
+	FailedCount += CheckTLSF();
+	FailedCount += CheckLinearRing();
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
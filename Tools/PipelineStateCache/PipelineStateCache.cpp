@@ -0,0 +1,179 @@
+// Checks the key, lookup and cache file layers of the pipeline state cache with fake pipelines, without a device:
+// two runs share a cache file, the second one creates every pipeline from its blob. Also checks that corrupt files,
+// files of another device and blobs rejected by the driver fall back to compiling.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o PipelineStateCache Tools/PipelineStateCache/PipelineStateCache.cpp
+//
+// Usage: PipelineStateCache [PipelineCount] [CacheFile]
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/PipelineStateCache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+
+// What a driver would compile, the blob is the key repeated
+struct XFakePipeline
+{
+	uint64_t Key = 0;
+
+	bool bFromBlob = false;
+};
+
+using XFakePipelineRef = std::shared_ptr<XFakePipeline>;
+
+// Part of a pipeline description, with the padding of D3D12_RENDER_TARGET_BLEND_DESC
+struct XFakeBlendDesc
+{
+	int BlendEnable;
+
+	int SrcBlend;
+
+	uint8_t WriteMask;
+};
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+static uint64_t HashDesc(uint64_t ShaderHash, const XFakeBlendDesc& Blend, const char* Semantic, uint32_t RTVFormat)
+{
+	XPipelineStateHasher Hasher;
+	Hasher.AddHash(ShaderHash);
+	Hasher.AddValue(Blend.BlendEnable);
+	Hasher.AddValue(Blend.SrcBlend);
+	Hasher.AddValue(Blend.WriteMask);
+	Hasher.AddString(Semantic);
+	Hasher.AddValue(RTVFormat);
+
+	return Hasher.GetHash();
+}
+
+// Creates PipelineCount pipelines, the driver rejects the blobs if bDriverUpdated
+static void RunFrame(XPipelineStateCache<XFakePipelineRef>& Cache, uint32_t PipelineCount, bool bDriverUpdated)
+{
+	for (uint32_t i = 0; i < PipelineCount; i++)
+	{
+		const uint64_t Key = HashDesc(HashHelper::HashString("Shader" + std::to_string(i % 7)), { 1, (int)i, 0xf }, "POSITION", 28 + i % 3);
+
+		Cache.FindOrCreate(Key, [Key, bDriverUpdated](const std::vector<uint8_t>* CachedBlob, std::vector<uint8_t>& OutBlob)
+		{
+			XFakePipelineRef Pipeline = std::make_shared<XFakePipeline>();
+			Pipeline->Key = Key;
+
+			if (CachedBlob)
+			{
+				uint64_t BlobKey = 0;
+				if (bDriverUpdated || CachedBlob->size() != sizeof(BlobKey))
+				{
+					return XFakePipelineRef();
+				}
+
+				memcpy(&BlobKey, CachedBlob->data(), sizeof(BlobKey));
+				Pipeline->bFromBlob = BlobKey == Key;
+
+				return Pipeline->bFromBlob ? Pipeline : XFakePipelineRef();
+			}
+
+			OutBlob.resize(sizeof(Key));
+			memcpy(OutBlob.data(), &Key, sizeof(Key));
+
+			return Pipeline;
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t PipelineCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 300;
+	const std::string FileName = argc > 2 ? argv[2] : "PipelineStateCache.bin";
+	const uint64_t DeviceKey = HashHelper::HashString("Adapter 0x10de 0x2684, driver 31.0.15.5222");
+
+	uint32_t FailedCount = 0;
+
+	{
+		const XFakeBlendDesc Blend = { 1, 5, 0xf };
+		const uint64_t Key = HashDesc(42, Blend, "POSITION", 28);
+
+		XFakeBlendDesc PaddedBlend;
+		memset(&PaddedBlend, 0xcd, sizeof(PaddedBlend));
+		PaddedBlend.BlendEnable = 1;
+		PaddedBlend.SrcBlend = 5;
+		PaddedBlend.WriteMask = 0xf;
+
+		const char Semantic[] = "POSITION";
+		FailedCount += Check("Equal descriptions have equal keys, whatever their padding and pointers",
+			Key == HashDesc(42, PaddedBlend, Semantic, 28));
+		FailedCount += Check("Any field changes the key", Key != HashDesc(43, Blend, "POSITION", 28) && Key != HashDesc(42, { 1, 5, 0x7 }, "POSITION", 28)
+			&& Key != HashDesc(42, Blend, "NORMAL", 28) && Key != HashDesc(42, Blend, "POSITION", 29));
+	}
+
+	{
+		XPipelineCacheFile File(DeviceKey);
+		File.SetBlob(1, { 1, 2, 3 });
+		File.SetBlob(2, {});
+		File.SetBlob(3, std::vector<uint8_t>(1000, 7));
+
+		std::vector<uint8_t> Data;
+		File.Serialize(Data);
+
+		XPipelineCacheFile Loaded(DeviceKey);
+		const bool bLoaded = Loaded.Deserialize(Data.data(), Data.size());
+		FailedCount += Check("Blobs round trip", bLoaded && Loaded.GetBlobCount() == 3 && *Loaded.FindBlob(1) == std::vector<uint8_t>({ 1, 2, 3 })
+			&& Loaded.FindBlob(2)->empty() && *Loaded.FindBlob(3) == std::vector<uint8_t>(1000, 7) && !Loaded.IsDirty());
+
+		XPipelineCacheFile OtherDevice(DeviceKey + 1);
+		FailedCount += Check("A file of another device is dropped", !OtherDevice.Deserialize(Data.data(), Data.size()) && OtherDevice.GetBlobCount() == 0);
+
+		std::vector<uint8_t> Corrupt = Data;
+		Corrupt.back() ^= 0xff;
+		const bool bCorruptLoaded = Loaded.Deserialize(Corrupt.data(), Corrupt.size());
+		FailedCount += Check("A corrupt blob is skipped", bCorruptLoaded && Loaded.GetBlobCount() == 2 && Loaded.IsDirty());
+
+		FailedCount += Check("A truncated file is dropped", !Loaded.Deserialize(Data.data(), Data.size() - 1) && Loaded.GetBlobCount() == 0);
+	}
+
+	remove(FileName.c_str());
+
+	{
+		XPipelineStateCache<XFakePipelineRef> Cache(DeviceKey);
+		const bool bLoaded = Cache.LoadFromFile(FileName);
+		RunFrame(Cache, PipelineCount, false);
+		RunFrame(Cache, PipelineCount, false);
+
+		const XPipelineStateCache<XFakePipelineRef>::Stats Stats = Cache.GetStats();
+		printf("first run: %llu compiled, %llu from blobs, %llu hits\n", (unsigned long long)Stats.CompileCount, (unsigned long long)Stats.BlobHitCount, (unsigned long long)Stats.HitCount);
+		FailedCount += Check("The first run compiles every pipeline once", !bLoaded && Stats.CompileCount == Cache.GetPipelineCount()
+			&& Stats.HitCount == 2ull * PipelineCount - Stats.CompileCount && Stats.BlobHitCount == 0);
+		FailedCount += Check("The cache file is saved", Cache.SaveToFile(FileName));
+	}
+
+	{
+		XPipelineStateCache<XFakePipelineRef> Cache(DeviceKey);
+		const bool bLoaded = Cache.LoadFromFile(FileName);
+		RunFrame(Cache, PipelineCount, false);
+
+		const XPipelineStateCache<XFakePipelineRef>::Stats Stats = Cache.GetStats();
+		printf("second run: %llu compiled, %llu from blobs, %llu hits\n", (unsigned long long)Stats.CompileCount, (unsigned long long)Stats.BlobHitCount, (unsigned long long)Stats.HitCount);
+		FailedCount += Check("The second run creates every pipeline from its blob", bLoaded && Stats.CompileCount == 0 && Stats.BlobHitCount == Cache.GetPipelineCount());
+	}
+
+	{
+		XPipelineStateCache<XFakePipelineRef> Cache(DeviceKey);
+		Cache.LoadFromFile(FileName);
+		RunFrame(Cache, PipelineCount, true);
+
+		const XPipelineStateCache<XFakePipelineRef>::Stats Stats = Cache.GetStats();
+		FailedCount += Check("Blobs rejected by the driver are compiled again", Stats.RejectedBlobCount == Cache.GetPipelineCount()
+			&& Stats.CompileCount == Cache.GetPipelineCount() && Stats.BlobHitCount == 0);
+	}
+
+	remove(FileName.c_str());
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
@@ -0,0 +1,138 @@
+// Checks the fence deferred deletion of the sub-allocators against a mock fence, without a device:
+// freed blocks go through an XRetirementQueue tagged with the current fence value, like D3D12BuddyAllocator,
+// and must only be given back to the buddy core once the GPU has completed that value.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o RetirementQueue Tools/RetirementQueue/RetirementQueue.cpp
+//
+// Usage: RetirementQueue
+//        Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/BuddyAllocatorCore.h"
+#include "../../XD3DRenderer/Common/RetirementQueue.h"
+#include "../../XD3DRenderer/Common/Fence.h"
+#include <stdio.h>
+
+static constexpr uint32_t BlockSize = 256 * 1024;
+
+static constexpr uint32_t BlockCount = 4;
+
+// Same deferred deletion as D3D12BuddyAllocator, over a pool of BlockCount blocks
+class XDeferredBuddyAllocator
+{
+public:
+	XDeferredBuddyAllocator(XFence* InFence) : Core((uint64_t)BlockSize * BlockCount, BlockSize), Fence(InFence) {}
+
+	bool Allocate(XBuddyAllocatorCore::Allocation& OutAllocation)
+	{
+		return Core.Allocate(BlockSize, 0, OutAllocation);
+	}
+
+	// The GPU may still use the block until the work recorded so far has completed
+	void Deallocate(const XBuddyAllocatorCore::Allocation& Allocation)
+	{
+		DeferredDeletionQueue.Enqueue(Allocation, Fence->GetCurrentValue());
+	}
+
+	uint32_t CleanUpAllocations()
+	{
+		return DeferredDeletionQueue.Retire(Fence->GetCompletedValue(), [this](const XBuddyAllocatorCore::Allocation& Allocation)
+		{
+			Core.Deallocate(Allocation.Offset, Allocation.Order, BlockSize);
+		});
+	}
+
+	uint32_t GetAllocatedBlockCount() const { return (uint32_t)(Core.GetTotalAllocSize() / BlockSize); }
+
+	size_t GetPendingBlockCount() const { return DeferredDeletionQueue.GetSize(); }
+
+private:
+	XBuddyAllocatorCore Core;
+
+	XFence* Fence = nullptr;
+
+	XRetirementQueue<XBuddyAllocatorCore::Allocation> DeferredDeletionQueue;
+};
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+int main()
+{
+	uint32_t FailedCount = 0;
+
+	XMockFence Fence;
+	XDeferredBuddyAllocator Allocator(&Fence);
+
+	XBuddyAllocatorCore::Allocation Blocks[BlockCount];
+	bool bAllocated = true;
+	for (XBuddyAllocatorCore::Allocation& Block : Blocks)
+	{
+		bAllocated = Allocator.Allocate(Block) && bAllocated;
+	}
+	FailedCount += Check("The pool is full", bAllocated && Allocator.GetAllocatedBlockCount() == BlockCount);
+
+	// Frame 1 frees block 0
+	Allocator.Deallocate(Blocks[0]);
+	const uint64_t Frame1 = Fence.Signal();
+
+	{
+		XBuddyAllocatorCore::Allocation Block;
+		const uint32_t RetiredCount = Allocator.CleanUpAllocations();
+		FailedCount += Check("A block is not reclaimed while its frame runs on the GPU", RetiredCount == 0 && Allocator.GetAllocatedBlockCount() == BlockCount
+			&& !Allocator.Allocate(Block));
+	}
+
+	// Frame 2 frees blocks 1 and 2, the GPU finishes frame 1 meanwhile
+	Allocator.Deallocate(Blocks[1]);
+	Allocator.Deallocate(Blocks[2]);
+	const uint64_t Frame2 = Fence.Signal();
+	Fence.Complete(Frame1);
+
+	FailedCount += Check("Only the blocks of the completed frame are reclaimed", Allocator.CleanUpAllocations() == 1
+		&& Allocator.GetAllocatedBlockCount() == BlockCount - 1 && Allocator.GetPendingBlockCount() == 2);
+
+	FailedCount += Check("Cleaning up again without progress reclaims nothing", Allocator.CleanUpAllocations() == 0 && Allocator.GetPendingBlockCount() == 2);
+
+	{
+		XBuddyAllocatorCore::Allocation Block;
+		FailedCount += Check("A reclaimed block is reused", Allocator.Allocate(Block) && Block.Offset == Blocks[0].Offset);
+		Blocks[0] = Block;
+	}
+
+	// Frames 3 and 4 free blocks 3 and 0, then the GPU finishes frames 2 to 4 one by one
+	Allocator.Deallocate(Blocks[3]);
+	const uint64_t Frame3 = Fence.Signal();
+	Allocator.Deallocate(Blocks[0]);
+	const uint64_t Frame4 = Fence.Signal();
+
+	Fence.Complete(Frame2);
+	FailedCount += Check("Frames complete one at a time over several clean ups", Allocator.CleanUpAllocations() == 2
+		&& Allocator.GetPendingBlockCount() == 2 && Allocator.GetAllocatedBlockCount() == 2);
+
+	Fence.Complete(Frame3);
+	FailedCount += Check("The next clean up takes the next frame only", Allocator.CleanUpAllocations() == 1 && Allocator.GetPendingBlockCount() == 1);
+
+	Fence.Complete(Frame4);
+	FailedCount += Check("Everything is reclaimed once the last frame completes", Allocator.CleanUpAllocations() == 1
+		&& Allocator.GetPendingBlockCount() == 0 && Allocator.GetAllocatedBlockCount() == 0);
+
+	{
+		// A block freed in a frame that is not signaled yet waits for that frame, even if every previous one has completed
+		XBuddyAllocatorCore::Allocation Block;
+		Allocator.Allocate(Block);
+		Allocator.Deallocate(Block);
+		Fence.CompleteAll();
+		FailedCount += Check("A block of the frame being recorded is not reclaimed", Allocator.CleanUpAllocations() == 0 && Allocator.GetAllocatedBlockCount() == 1);
+
+		Fence.Complete(Fence.Signal());
+		FailedCount += Check("It is reclaimed once that frame is signaled and completes", Allocator.CleanUpAllocations() == 1 && Allocator.GetAllocatedBlockCount() == 0);
+	}
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
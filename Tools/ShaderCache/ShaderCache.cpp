@@ -0,0 +1,138 @@
+// Checks XShaderCache without a compiler: stores fake shaders in a directory, reads them back,
+// and checks that missing, truncated or corrupt files and key mismatches are misses. Then reports the cost of a hit.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o ShaderCache Tools/ShaderCache/ShaderCache.cpp
+//
+// Usage: ShaderCache [Directory] [BytecodeSize]
+//        The directory must exist, default is the current one. Returns the number of failed checks
+
+#include "../../XD3DRenderer/Common/ShaderCache.h"
+#include <stdlib.h>
+#include <chrono>
+
+static uint32_t Check(const char* Name, bool bPassed)
+{
+	printf("%s %s\n", bPassed ? "PASS" : "FAIL", Name);
+
+	return bPassed ? 0 : 1;
+}
+
+static XShaderCacheEntry MakeEntry(size_t BytecodeSize, uint8_t Seed)
+{
+	XShaderCacheEntry Entry;
+	Entry.Bytecode.resize(BytecodeSize);
+	for (size_t i = 0; i < BytecodeSize; i++)
+	{
+		Entry.Bytecode[i] = (uint8_t)(i * 31 + Seed);
+	}
+
+	// cbuffer, Texture2D and bindless constants, as D3D_SHADER_INPUT_TYPE values
+	XShaderBindingRecord Binding;
+	Binding.Name = "cbPass";
+	Binding.Type = 0;
+	Binding.ConstantBufferSize = 256;
+	Entry.Bindings.push_back(Binding);
+
+	Binding.Name = "BaseColorTexture";
+	Binding.Type = 2;
+	Binding.BindPoint = 3;
+	Binding.BindCount = 1;
+	Binding.ConstantBufferSize = 0;
+	Entry.Bindings.push_back(Binding);
+
+	Binding.Name = "BindlessIndices";
+	Binding.Type = 0;
+	Binding.BindPoint = 0;
+	Binding.RegisterSpace = 1;
+	Binding.ConstantBufferSize = 16;
+	Entry.Bindings.push_back(Binding);
+
+	return Entry;
+}
+
+static bool IsSameEntry(const XShaderCacheEntry& A, const XShaderCacheEntry& B)
+{
+	return A.Bytecode == B.Bytecode && A.Bindings == B.Bindings;
+}
+
+static void WriteFile(const std::string& FileName, const std::vector<uint8_t>& Data)
+{
+	std::ofstream File(FileName, std::ios::binary);
+	File.write((const char*)Data.data(), (std::streamsize)Data.size());
+}
+
+int main(int argc, char** argv)
+{
+	const std::string Directory = argc > 1 ? argv[1] : ".";
+	const size_t BytecodeSize = argc > 2 ? (size_t)atoi(argv[2]) : 8 * 1024;
+
+	XShaderCache Cache(Directory);
+	uint32_t FailedCount = 0;
+
+	// Keys of the checks, as D3DShader would compute them
+	const uint64_t Key = HashHelper::Combine(HashHelper::HashString("#line 1 \"Shaders/BasePass.hlsl\" ..."), HashHelper::HashString("VS"));
+	const uint64_t OtherKey = Key + 1;
+	const XShaderCacheEntry Entry = MakeEntry(BytecodeSize, 1);
+
+	remove(Cache.GetFileName(Key).c_str());
+	remove(Cache.GetFileName(OtherKey).c_str());
+
+	{
+		XShaderCacheEntry Found;
+		FailedCount += Check("A shader never compiled is a miss", !Cache.Find(Key, Found));
+	}
+
+	{
+		XShaderCacheEntry Found;
+		const bool bStored = Cache.Store(Key, Entry);
+		FailedCount += Check("A stored shader is found with its reflection", bStored && Cache.Find(Key, Found) && IsSameEntry(Found, Entry));
+	}
+
+	{
+		std::vector<uint8_t> Data;
+		XShaderCache::Serialize(Key, Entry, Data);
+
+		XShaderCacheEntry Found;
+		FailedCount += Check("An entry does not load under another key", !XShaderCache::Deserialize(OtherKey, Data.data(), Data.size(), Found));
+
+		std::vector<uint8_t> Corrupt = Data;
+		Corrupt[Corrupt.size() / 2] ^= 0x40;
+		WriteFile(Cache.GetFileName(OtherKey), Corrupt);
+		FailedCount += Check("A corrupt file is a miss", !Cache.Find(OtherKey, Found));
+
+		Data.resize(Data.size() - 3);
+		WriteFile(Cache.GetFileName(OtherKey), Data);
+		FailedCount += Check("A truncated file is a miss", !Cache.Find(OtherKey, Found));
+
+		// Recompiled and stored again
+		const XShaderCacheEntry NewEntry = MakeEntry(BytecodeSize / 2, 2);
+		FailedCount += Check("A bad file is replaced", Cache.Store(OtherKey, NewEntry) && Cache.Find(OtherKey, Found) && IsSameEntry(Found, NewEntry));
+	}
+
+	{
+		const XShaderCache::Stats Stats = Cache.GetStats();
+		FailedCount += Check("Hits and misses are counted", Stats.HitCount == 2 && Stats.MissCount == 3 && Stats.CorruptCount == 2);
+		printf("%s\n", Cache.GetStatsString().c_str());
+	}
+
+	{
+		const uint32_t LoadCount = 1000;
+		XShaderCacheEntry Found;
+
+		auto Start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < LoadCount; i++)
+		{
+			Cache.Find(Key, Found);
+		}
+		const double Elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+
+		printf("%zu bytes of bytecode load in %.1f us\n", BytecodeSize, Elapsed / LoadCount / 1000.0);
+	}
+
+	remove(Cache.GetFileName(Key).c_str());
+	remove(Cache.GetFileName(OtherKey).c_str());
+
+	printf("%u failed\n", FailedCount);
+
+	return (int)FailedCount;
+}
@@ -0,0 +1,109 @@
+// Simulates a burst of uploads streamed by D3D12UploadManager on a copy queue with a given bandwidth,
+// and reports for several per-frame budgets how long the burst takes and how long each upload waits.
+// Only depends on the device-independent headers of XD3DRenderer/Common, builds anywhere, e.g.
+//     g++ -std=c++17 -O2 -o UploadStreaming Tools/UploadStreaming/UploadStreaming.cpp
+//
+// Usage: UploadStreaming [UploadCount] [MaxUploadSize] [Bandwidth] [FrameTime]
+//        Sizes in KB, bandwidth in KB per microsecond of copy queue time, frame time in microseconds
+
+#include "../../XD3DRenderer/Common/UploadScheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+struct XSimulatedUpload
+{
+	uint64_t Size = 0;
+
+	uint32_t EnqueueFrame = 0;
+};
+
+static void RunSimulation(uint64_t FrameBudget, uint32_t UploadCount, uint64_t MaxUploadSize, uint64_t Bandwidth, uint64_t FrameTime)
+{
+	XSimulatedCommandQueue Queue(FrameTime / 10);
+	XUploadScheduler<XSimulatedUpload> Scheduler(&Queue, FrameBudget);
+
+	// The whole burst arrives on the first frame, e.g. a level load
+	std::mt19937 Random(1234);
+	for (uint32_t i = 0; i < UploadCount; i++)
+	{
+		const uint64_t Size = 1 + Random() % MaxUploadSize;
+
+		XSimulatedUpload Upload;
+		Upload.Size = Size;
+		Scheduler.Enqueue(std::move(Upload), Size);
+	}
+
+	uint64_t MaxFrameSize = 0;
+	uint64_t TotalWait = 0;
+	uint32_t MaxWait = 0;
+	uint32_t Frame = 0;
+	uint32_t Released = 0;
+
+	while (Released < UploadCount)
+	{
+		uint64_t FrameSize = 0;
+		Scheduler.SubmitFrame([&](std::vector<XSimulatedUpload*>& Batch)
+		{
+			for (XSimulatedUpload* Upload : Batch)
+			{
+				FrameSize += Upload->Size;
+			}
+			Queue.Submit(FrameSize / Bandwidth);
+		});
+
+		Scheduler.Retire([&](XSimulatedUpload& Upload)
+		{
+			const uint32_t Wait = Frame - Upload.EnqueueFrame;
+			TotalWait += Wait;
+			MaxWait = Wait > MaxWait ? Wait : MaxWait;
+			Released++;
+		});
+
+		MaxFrameSize = FrameSize > MaxFrameSize ? FrameSize : MaxFrameSize;
+		Queue.AdvanceCpuTime(FrameTime);
+		Frame++;
+	}
+
+	char BudgetText[32] = "none";
+	if (FrameBudget != UINT64_MAX)
+	{
+		snprintf(BudgetText, sizeof(BudgetText), "%llu", (unsigned long long)FrameBudget);
+	}
+
+	printf("%10s %8u %12llu %10.1f %8u %9.1f%%\n",
+		BudgetText,
+		Frame,
+		(unsigned long long)MaxFrameSize,
+		(double)TotalWait / UploadCount,
+		MaxWait,
+		100.0 * (double)Queue.GetGpuBusyTime() / (double)Queue.GetCpuTime());
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t UploadCount = argc > 1 ? (uint32_t)atoi(argv[1]) : 500;
+	const uint64_t MaxUploadSize = argc > 2 ? (uint64_t)atoll(argv[2]) : 4096;
+	const uint64_t Bandwidth = argc > 3 ? (uint64_t)atoll(argv[3]) : 4;
+	const uint64_t FrameTime = argc > 4 ? (uint64_t)atoll(argv[4]) : 16000;
+
+	if (UploadCount == 0 || MaxUploadSize == 0 || Bandwidth == 0 || FrameTime == 0)
+	{
+		printf("Usage: %s [UploadCount] [MaxUploadSize] [Bandwidth] [FrameTime]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%u uploads up to %llu KB, %llu KB/us, %llu us/frame\n",
+		UploadCount, (unsigned long long)MaxUploadSize, (unsigned long long)Bandwidth, (unsigned long long)FrameTime);
+	printf("%10s %8s %12s %10s %8s %10s\n", "Budget KB", "Frames", "MaxFrame KB", "AvgWait", "MaxWait", "Copy busy");
+
+	for (uint64_t FrameBudget = 4 * 1024; FrameBudget <= 256 * 1024; FrameBudget *= 2)
+	{
+		RunSimulation(FrameBudget, UploadCount, MaxUploadSize, Bandwidth, FrameTime);
+	}
+
+	// No budget, the whole burst is submitted on the first frame
+	RunSimulation(UINT64_MAX, UploadCount, MaxUploadSize, Bandwidth, FrameTime);
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+// Compact binary recording of the calls made to the memory allocators, replayed offline by XAllocationTraceReplayer.
+// Each allocation gets an id, its deallocation refers to that id. CleanUp events mark the frame boundaries
+// at which an allocator reclaims its deferred deallocations.
+class XAllocationTrace
+{
+public:
+	static constexpr uint32_t InvalidId = 0;
+
+	enum class EEventType : uint8_t
+	{
+		Allocate,
+		Deallocate,
+		CleanUp,
+	};
+
+	// 24 bytes, written as is to the trace file
+	struct Event
+	{
+		EEventType Type;
+
+		uint8_t Channel;  // Which allocator, only for Allocate and CleanUp
+
+		uint16_t Reserved;
+
+		uint32_t Id;
+
+		uint64_t Size;
+
+		uint32_t Alignment;
+
+		uint32_t Padding;
+	};
+
+	static_assert(sizeof(Event) == 24, "Trace events are stored as 24 bytes");
+
+public:
+	void Start() { bRecording = true; }
+
+	void Stop() { bRecording = false; }
+
+	bool IsRecording() const { return bRecording; }
+
+	// Returns InvalidId when not recording
+	uint32_t RecordAllocate(uint8_t Channel, uint64_t Size, uint32_t Alignment)
+	{
+		if (!bRecording)
+		{
+			return InvalidId;
+		}
+
+		const uint32_t Id = NextId++;
+		Events.push_back({ EEventType::Allocate, Channel, 0, Id, Size, Alignment, 0 });
+
+		return Id;
+	}
+
+	void RecordDeallocate(uint32_t Id)
+	{
+		if (bRecording && Id != InvalidId)
+		{
+			Events.push_back({ EEventType::Deallocate, 0, 0, Id, 0, 0, 0 });
+		}
+	}
+
+	void RecordCleanUp(uint8_t Channel)
+	{
+		if (bRecording)
+		{
+			Events.push_back({ EEventType::CleanUp, Channel, 0, 0, 0, 0, 0 });
+		}
+	}
+
+	const std::vector<Event>& GetEvents() const { return Events; }
+
+	void Clear()
+	{
+		Events.clear();
+	}
+
+	bool SaveToFile(const std::string& FileName) const;
+
+	bool LoadFromFile(const std::string& FileName);
+
+private:
+	static constexpr uint32_t FileMagic = 0x52544158;  // "XATR"
+
+	static constexpr uint32_t FileVersion = 2;
+
+	bool bRecording = false;
+
+	uint32_t NextId = InvalidId + 1;
+
+	std::vector<Event> Events;
+};
+
+inline bool XAllocationTrace::SaveToFile(const std::string& FileName) const
+{
+	std::ofstream File(FileName, std::ios::binary);
+	if (!File)
+	{
+		return false;
+	}
+
+	const uint32_t Header[2] = { FileMagic, FileVersion };
+	const uint64_t EventCount = Events.size();
+
+	File.write((const char*)Header, sizeof(Header));
+	File.write((const char*)&EventCount, sizeof(EventCount));
+	File.write((const char*)Events.data(), (std::streamsize)(EventCount * sizeof(Event)));
+
+	return (bool)File;
+}
+
+inline bool XAllocationTrace::LoadFromFile(const std::string& FileName)
+{
+	std::ifstream File(FileName, std::ios::binary);
+	if (!File)
+	{
+		return false;
+	}
+
+	uint32_t Header[2] = {};
+	uint64_t EventCount = 0;
+	File.read((char*)Header, sizeof(Header));
+	File.read((char*)&EventCount, sizeof(EventCount));
+	if (!File || Header[0] != FileMagic || Header[1] != FileVersion)
+	{
+		return false;
+	}
+
+	Events.resize((size_t)EventCount);
+	File.read((char*)Events.data(), (std::streamsize)(EventCount * sizeof(Event)));
+	if (!File)
+	{
+		Events.clear();
+
+		return false;
+	}
+
+	return true;
+}
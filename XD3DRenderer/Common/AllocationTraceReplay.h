@@ -0,0 +1,302 @@
+#pragma once
+
+#include "AllocationTrace.h"
+#include "BuddyAllocatorCore.h"
+#include "TLSFAllocatorCore.h"
+#include "SlabAllocatorCore.h"
+#include "RetirementQueue.h"
+#include <unordered_map>
+#include <chrono>
+
+struct XAllocationReplayResult
+{
+	uint64_t OperationCount = 0;
+
+	// Time spent in Allocate and Deallocate only
+	uint64_t TotalNanoseconds = 0;
+
+	uint32_t FailedAllocationCount = 0;
+
+	// Sampled at every CleanUp event
+	uint64_t PeakAllocatedSize = 0;
+
+	float PeakExternalFragmentation = 0.0f;
+
+	// Once the replay is done, before the remaining allocations are released
+	XAllocatorStats FinalStats;
+
+	double GetNanosecondsPerOperation() const
+	{
+		return OperationCount == 0 ? 0.0 : (double)TotalNanoseconds / (double)OperationCount;
+	}
+};
+
+// Replays the events of one channel of an XAllocationTrace against an allocator adapter.
+// Deallocations are applied FrameLatency CleanUp events after they were recorded, like the fence
+// deferred deletion of the GPU allocators. AdapterType provides a Handle type and
+// bool Allocate(uint64_t Size, uint32_t Alignment, Handle&), void Deallocate(const Handle&), XAllocatorStats GetStats().
+template<typename AdapterType>
+class XAllocationTraceReplayer
+{
+public:
+	static XAllocationReplayResult Replay(const std::vector<XAllocationTrace::Event>& Events, uint8_t Channel, uint32_t FrameLatency, AdapterType& Adapter);
+};
+
+template<typename AdapterType>
+inline XAllocationReplayResult XAllocationTraceReplayer<AdapterType>::Replay(const std::vector<XAllocationTrace::Event>& Events, uint8_t Channel, uint32_t FrameLatency, AdapterType& Adapter)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	using Handle = typename AdapterType::Handle;
+
+	XAllocationReplayResult Result;
+
+	std::unordered_map<uint32_t, Handle> LiveAllocations;
+	XRetirementQueue<Handle> PendingDeallocations;
+	uint64_t FrameIndex = FrameLatency;
+
+	auto Deallocate = [&Adapter, &Result](const Handle& Allocation)
+	{
+		const Clock::time_point StartTime = Clock::now();
+		Adapter.Deallocate(Allocation);
+		Result.TotalNanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - StartTime).count();
+		Result.OperationCount++;
+	};
+
+	for (const XAllocationTrace::Event& Event : Events)
+	{
+		switch (Event.Type)
+		{
+		case XAllocationTrace::EEventType::Allocate:
+		{
+			if (Event.Channel != Channel)
+			{
+				break;
+			}
+
+			Handle Allocation;
+
+			const Clock::time_point StartTime = Clock::now();
+			const bool bSucceeded = Adapter.Allocate(Event.Size, Event.Alignment, Allocation);
+			Result.TotalNanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - StartTime).count();
+			Result.OperationCount++;
+
+			if (bSucceeded)
+			{
+				LiveAllocations[Event.Id] = Allocation;
+			}
+			else
+			{
+				Result.FailedAllocationCount++;
+			}
+
+			break;
+		}
+		case XAllocationTrace::EEventType::Deallocate:
+		{
+			// Ids are unique over all channels, unknown ones belong to another channel or failed
+			auto Iter = LiveAllocations.find(Event.Id);
+			if (Iter != LiveAllocations.end())
+			{
+				PendingDeallocations.Enqueue(Iter->second, FrameIndex);
+				LiveAllocations.erase(Iter);
+			}
+
+			break;
+		}
+		case XAllocationTrace::EEventType::CleanUp:
+		{
+			if (Event.Channel != Channel)
+			{
+				break;
+			}
+
+			const XAllocatorStats Stats = Adapter.GetStats();
+			Result.PeakAllocatedSize = Stats.AllocatedSize > Result.PeakAllocatedSize ? Stats.AllocatedSize : Result.PeakAllocatedSize;
+			Result.PeakExternalFragmentation = Stats.GetExternalFragmentation() > Result.PeakExternalFragmentation ? Stats.GetExternalFragmentation() : Result.PeakExternalFragmentation;
+
+			PendingDeallocations.Retire(FrameIndex - FrameLatency, Deallocate);
+			FrameIndex++;
+
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	PendingDeallocations.RetireAll(Deallocate);
+
+	Result.FinalStats = Adapter.GetStats();
+	Result.PeakAllocatedSize = Result.FinalStats.PeakAllocatedSize > Result.PeakAllocatedSize ? Result.FinalStats.PeakAllocatedSize : Result.PeakAllocatedSize;
+
+	for (const auto& Pair : LiveAllocations)
+	{
+		Adapter.Deallocate(Pair.second);
+	}
+
+	return Result;
+}
+
+class XBuddyReplayAdapter
+{
+public:
+	struct Handle
+	{
+		XBuddyAllocatorCore::Allocation Allocation;
+
+		uint64_t Size = 0;
+	};
+
+public:
+	XBuddyReplayAdapter(uint64_t PoolSize, uint32_t MinBlockSize) : Core(PoolSize, MinBlockSize) {}
+
+	bool Allocate(uint64_t Size, uint32_t Alignment, Handle& OutHandle)
+	{
+		OutHandle.Size = Size;
+		return Core.Allocate(Size, Alignment, OutHandle.Allocation);
+	}
+
+	void Deallocate(const Handle& InHandle)
+	{
+		Core.Deallocate(InHandle.Allocation.Offset, InHandle.Allocation.Order, InHandle.Size);
+	}
+
+	XAllocatorStats GetStats() const { return Core.GetStats(); }
+
+private:
+	XBuddyAllocatorCore Core;
+};
+
+class XTLSFReplayAdapter
+{
+public:
+	struct Handle
+	{
+		XTLSFAllocatorCore::Allocation Allocation;
+
+		uint64_t Size = 0;
+	};
+
+public:
+	XTLSFReplayAdapter(uint64_t PoolSize, uint32_t Granularity) : Core(PoolSize, Granularity) {}
+
+	bool Allocate(uint64_t Size, uint32_t Alignment, Handle& OutHandle)
+	{
+		OutHandle.Size = Size;
+		return Core.Allocate(Size, Alignment, OutHandle.Allocation);
+	}
+
+	void Deallocate(const Handle& InHandle)
+	{
+		Core.Deallocate(InHandle.Allocation.BlockIndex, InHandle.Size);
+	}
+
+	XAllocatorStats GetStats() const { return Core.GetStats(); }
+
+private:
+	XTLSFAllocatorCore Core;
+};
+
+// Slabs carved from a buddy allocator, same policy as D3D12SlabAllocator
+class XSlabReplayAdapter
+{
+public:
+	struct Handle
+	{
+		XSlabAllocatorCore::Allocation Slot;  // SlabIndex is InvalidIndex for the requests served by the buddy allocator
+
+		XBuddyAllocatorCore::Allocation Allocation;
+
+		uint64_t Size = 0;
+	};
+
+public:
+	XSlabReplayAdapter(uint64_t PoolSize, uint32_t MinBlockSize, uint32_t MinClassSize, uint32_t MaxClassSize)
+		: SlabCore(MinClassSize, MaxClassSize), BuddyCore(PoolSize, MinBlockSize)
+	{
+	}
+
+	bool Allocate(uint64_t Size, uint32_t Alignment, Handle& OutHandle)
+	{
+		OutHandle.Size = Size;
+
+		const uint32_t SizeClass = SlabCore.GetSizeClass(Size, Alignment);
+		if (SizeClass == XSlabAllocatorCore::InvalidIndex)
+		{
+			OutHandle.Slot.SlabIndex = XSlabAllocatorCore::InvalidIndex;
+			return BuddyCore.Allocate(Size, Alignment, OutHandle.Allocation);
+		}
+
+		if (!SlabCore.Allocate(SizeClass, OutHandle.Slot))
+		{
+			XBuddyAllocatorCore::Allocation SlabAllocation;
+			if (!BuddyCore.Allocate(SlabCore.GetSlabSize(SizeClass), SlabCore.GetClassSize(SizeClass), SlabAllocation))
+			{
+				return false;
+			}
+
+			const uint32_t SlabIndex = SlabCore.AddSlab(SizeClass);
+			if (SlabIndex >= SlabBlocks.size())
+			{
+				SlabBlocks.resize(SlabIndex + 1);
+			}
+			SlabBlocks[SlabIndex] = SlabAllocation;
+			SlabBytes += SlabCore.GetSlabSize(SizeClass);
+			SlabCount++;
+
+			SlabCore.Allocate(SizeClass, OutHandle.Slot);
+		}
+
+		RequestedSize += Size;
+		SlotCount++;
+
+		return true;
+	}
+
+	void Deallocate(const Handle& InHandle)
+	{
+		if (InHandle.Slot.SlabIndex == XSlabAllocatorCore::InvalidIndex)
+		{
+			BuddyCore.Deallocate(InHandle.Allocation.Offset, InHandle.Allocation.Order, InHandle.Size);
+			return;
+		}
+
+		RequestedSize -= InHandle.Size;
+		SlotCount--;
+
+		const uint32_t SlabIndex = InHandle.Slot.SlabIndex;
+		if (SlabCore.Deallocate(SlabIndex, InHandle.Slot.SlotIndex) && SlabCore.GetEmptySlabCount(SlabCore.GetSlabSizeClass(SlabIndex)) > 1)
+		{
+			const uint32_t SlabSize = SlabCore.GetSlabSize(SlabCore.GetSlabSizeClass(SlabIndex));
+			SlabCore.RemoveSlab(SlabIndex);
+			BuddyCore.Deallocate(SlabBlocks[SlabIndex].Offset, SlabBlocks[SlabIndex].Order, SlabSize);
+			SlabBytes -= SlabSize;
+			SlabCount--;
+		}
+	}
+
+	// Footprint of the buddy allocator, with the slots counted as allocations instead of the slabs
+	XAllocatorStats GetStats() const
+	{
+		XAllocatorStats Stats = BuddyCore.GetStats();
+		Stats.RequestedSize = Stats.RequestedSize - SlabBytes + RequestedSize;
+		Stats.AllocationCount = Stats.AllocationCount - SlabCount + SlotCount;
+
+		return Stats;
+	}
+
+private:
+	XSlabAllocatorCore SlabCore;
+
+	XBuddyAllocatorCore BuddyCore;
+
+	std::vector<XBuddyAllocatorCore::Allocation> SlabBlocks;
+
+	uint64_t SlabBytes = 0;
+
+	uint32_t SlabCount = 0;
+
+	uint64_t RequestedSize = 0;
+
+	uint32_t SlotCount = 0;
+};
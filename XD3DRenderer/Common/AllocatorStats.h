@@ -0,0 +1,153 @@
+#pragma once
+
+#include "BitHelper.h"
+#include <string>
+#include <sstream>
+
+// Usage snapshot of one allocator pool, comparable between allocation strategies
+struct XAllocatorStats
+{
+	// One bucket per power of two, covers every 64-bit size
+	static constexpr uint32_t Log2BucketCount = 64;
+
+	uint64_t PoolSize = 0;
+
+	// Bytes asked for by the callers
+	uint64_t RequestedSize = 0;
+
+	// Bytes taken from the pool, including rounding and alignment padding
+	uint64_t AllocatedSize = 0;
+
+	// Highest AllocatedSize reached
+	uint64_t PeakAllocatedSize = 0;
+
+	uint64_t FreeSize = 0;
+
+	uint64_t LargestFreeBlock = 0;
+
+	uint32_t FreeBlockCount = 0;
+
+	uint32_t AllocationCount = 0;
+
+	// Dedicated resources made outside the pools when they can't serve a request, not part of the sizes above
+	uint64_t StandAloneSize = 0;
+
+	uint32_t StandAloneCount = 0;
+
+	// Free blocks by floor(log2(size in bytes)), for the buddy allocator this is the free block count of each order
+	uint32_t FreeBlockHistogram[Log2BucketCount] = {};
+
+	// Every allocation made so far by ceil(log2(requested size in bytes))
+	uint64_t AllocationSizeHistogram[Log2BucketCount] = {};
+
+	// Share of the allocated bytes lost to rounding
+	float GetInternalFragmentation() const
+	{
+		return AllocatedSize == 0 ? 0.0f : 1.0f - (float)((double)RequestedSize / (double)AllocatedSize);
+	}
+
+	// Share of the free bytes that can't be served as one allocation
+	float GetExternalFragmentation() const
+	{
+		return FreeSize == 0 ? 0.0f : 1.0f - (float)((double)LargestFreeBlock / (double)FreeSize);
+	}
+
+	static uint32_t GetFloorLog2Bucket(uint64_t Size)
+	{
+		const uint32_t Bucket = BitHelper::FindHighestSetBit(Size);
+		return Bucket < Log2BucketCount ? Bucket : Log2BucketCount - 1;
+	}
+
+	static uint32_t GetCeilLog2Bucket(uint64_t Size)
+	{
+		const uint32_t Bucket = BitHelper::CeilLog2(Size);
+		return Bucket < Log2BucketCount ? Bucket : Log2BucketCount - 1;
+	}
+
+	// Sum the stats of several pools, peaks are summed too so the result is an upper bound
+	void Accumulate(const XAllocatorStats& Other)
+	{
+		PoolSize += Other.PoolSize;
+		RequestedSize += Other.RequestedSize;
+		AllocatedSize += Other.AllocatedSize;
+		PeakAllocatedSize += Other.PeakAllocatedSize;
+		FreeSize += Other.FreeSize;
+		LargestFreeBlock = Other.LargestFreeBlock > LargestFreeBlock ? Other.LargestFreeBlock : LargestFreeBlock;
+		FreeBlockCount += Other.FreeBlockCount;
+		AllocationCount += Other.AllocationCount;
+		StandAloneSize += Other.StandAloneSize;
+		StandAloneCount += Other.StandAloneCount;
+
+		for (uint32_t Bucket = 0; Bucket < Log2BucketCount; Bucket++)
+		{
+			FreeBlockHistogram[Bucket] += Other.FreeBlockHistogram[Bucket];
+			AllocationSizeHistogram[Bucket] += Other.AllocationSizeHistogram[Bucket];
+		}
+	}
+
+	// One JSON object, histograms are arrays of Log2BucketCount entries indexed by log2 of the size
+	std::string ToJson() const
+	{
+		std::ostringstream Stream;
+		Stream << "{\"PoolSize\":" << PoolSize
+			<< ",\"RequestedSize\":" << RequestedSize
+			<< ",\"AllocatedSize\":" << AllocatedSize
+			<< ",\"PeakAllocatedSize\":" << PeakAllocatedSize
+			<< ",\"FreeSize\":" << FreeSize
+			<< ",\"LargestFreeBlock\":" << LargestFreeBlock
+			<< ",\"FreeBlockCount\":" << FreeBlockCount
+			<< ",\"AllocationCount\":" << AllocationCount
+			<< ",\"StandAloneSize\":" << StandAloneSize
+			<< ",\"StandAloneCount\":" << StandAloneCount
+			<< ",\"InternalFragmentation\":" << GetInternalFragmentation()
+			<< ",\"ExternalFragmentation\":" << GetExternalFragmentation();
+
+		Stream << ",\"FreeBlockHistogram\":[";
+		for (uint32_t Bucket = 0; Bucket < Log2BucketCount; Bucket++)
+		{
+			Stream << (Bucket == 0 ? "" : ",") << FreeBlockHistogram[Bucket];
+		}
+
+		Stream << "],\"AllocationSizeHistogram\":[";
+		for (uint32_t Bucket = 0; Bucket < Log2BucketCount; Bucket++)
+		{
+			Stream << (Bucket == 0 ? "" : ",") << AllocationSizeHistogram[Bucket];
+		}
+		Stream << "]}";
+
+		return Stream.str();
+	}
+};
+
+// Lifetime counters of an allocator, copied into its XAllocatorStats snapshots
+struct XAllocationCounters
+{
+	uint64_t PeakAllocatedSize = 0;
+
+	uint64_t AllocationSizeHistogram[XAllocatorStats::Log2BucketCount] = {};
+
+	void RecordAllocation(uint64_t RequestedSize)
+	{
+		AllocationSizeHistogram[XAllocatorStats::GetCeilLog2Bucket(RequestedSize)]++;
+	}
+
+	void RecordUsage(uint64_t AllocatedSize)
+	{
+		PeakAllocatedSize = AllocatedSize > PeakAllocatedSize ? AllocatedSize : PeakAllocatedSize;
+	}
+
+	void CopyTo(XAllocatorStats& Stats) const
+	{
+		Stats.PeakAllocatedSize = PeakAllocatedSize;
+
+		for (uint32_t Bucket = 0; Bucket < XAllocatorStats::Log2BucketCount; Bucket++)
+		{
+			Stats.AllocationSizeHistogram[Bucket] = AllocationSizeHistogram[Bucket];
+		}
+	}
+
+	void Reset()
+	{
+		*this = XAllocationCounters();
+	}
+};
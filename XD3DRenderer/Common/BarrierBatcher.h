@@ -0,0 +1,350 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <vector>
+
+// Device-independent state of a resource, one state for the whole resource until a single subresource is transitioned.
+// States are the D3D12_RESOURCE_STATES values, stored as integers so it does not depend on the D3D12 headers.
+class XResourceState
+{
+public:
+	// Same value as D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+	static const uint32_t AllSubresources = UINT32_MAX;
+
+public:
+	XResourceState() {}
+
+	XResourceState(uint32_t InSubresourceCount, uint32_t InitState) { Initialize(InSubresourceCount, InitState); }
+
+	void Initialize(uint32_t InSubresourceCount, uint32_t InitState)
+	{
+		assert(InSubresourceCount > 0);
+
+		SubresourceCount = InSubresourceCount;
+		State = InitState;
+		SubresourceStates.clear();
+	}
+
+	bool AreAllSubresourcesSame() const { return SubresourceStates.empty(); }
+
+	uint32_t GetSubresourceState(uint32_t Subresource) const
+	{
+		assert(Subresource < SubresourceCount);
+
+		return AreAllSubresourcesSame() ? State : SubresourceStates[Subresource];
+	}
+
+	// True if every subresource is in InState
+	bool IsInState(uint32_t InState) const;
+
+	void SetSubresourceState(uint32_t Subresource, uint32_t NewState);
+
+	uint32_t GetSubresourceCount() const { return SubresourceCount; }
+
+private:
+	uint32_t SubresourceCount = 1;
+
+	// State of every subresource while they are the same
+	uint32_t State = 0;
+
+	// One state per subresource, empty while they are the same
+	std::vector<uint32_t> SubresourceStates;
+};
+
+inline bool XResourceState::IsInState(uint32_t InState) const
+{
+	if (AreAllSubresourcesSame())
+	{
+		return State == InState;
+	}
+
+	for (uint32_t SubresourceState : SubresourceStates)
+	{
+		if (SubresourceState != InState)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+inline void XResourceState::SetSubresourceState(uint32_t Subresource, uint32_t NewState)
+{
+	if (Subresource == AllSubresources || SubresourceCount == 1)
+	{
+		State = NewState;
+		SubresourceStates.clear();
+
+		return;
+	}
+
+	assert(Subresource < SubresourceCount);
+
+	if (AreAllSubresourcesSame())
+	{
+		if (State == NewState)
+		{
+			return;
+		}
+
+		SubresourceStates.assign(SubresourceCount, State);
+	}
+
+	SubresourceStates[Subresource] = NewState;
+}
+
+// Device-independent batching of transition barriers.
+// Transitions are collected and emitted together by Flush(), right before the next draw, dispatch or copy.
+// Successive transitions of a subresource within a batch collapse into one, and a transition that comes back
+// to the initial state disappears. Split barriers begin a transition known ahead of time and end it where the
+// resource is needed, letting the GPU overlap it with the work in between.
+class XBarrierBatcher
+{
+public:
+	// Same values as D3D12_RESOURCE_BARRIER_FLAGS
+	enum EBarrierFlags : uint32_t
+	{
+		BarrierFlagNone = 0,
+		BarrierFlagBeginOnly = 1,
+		BarrierFlagEndOnly = 2,
+	};
+
+	struct XBarrier
+	{
+		void* Resource = nullptr;
+
+		uint32_t Subresource = XResourceState::AllSubresources;
+
+		uint32_t StateBefore = 0;
+
+		uint32_t StateAfter = 0;
+
+		uint32_t Flags = BarrierFlagNone;
+
+		bool operator==(const XBarrier& Other) const
+		{
+			return Resource == Other.Resource && Subresource == Other.Subresource && StateBefore == Other.StateBefore
+				&& StateAfter == Other.StateAfter && Flags == Other.Flags;
+		}
+	};
+
+	struct Stats
+	{
+		// Transitions requested, including the ones that were already in the right state
+		uint64_t RequestCount = 0;
+
+		uint64_t BarrierCount = 0;
+
+		// Barriers removed by collapsing transitions of the same batch
+		uint64_t CollapsedCount = 0;
+
+		uint64_t FlushCount = 0;
+	};
+
+public:
+	// Transition Subresource, or every subresource, of Resource to StateAfter. Ends its pending split transition first.
+	void Transition(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter);
+
+	// Start a split transition, the resource must not be used until EndTransition
+	void BeginTransition(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter);
+
+	// Finish the split transitions of Subresource, or of every subresource, of Resource
+	void EndTransition(void* Resource, uint32_t Subresource);
+
+	// Finish every split transition, they cannot span command lists
+	void EndPendingTransitions();
+
+	// Calls Emit(const std::vector<XBarrier>&) with the batch if it is not empty, then clears it
+	template<typename EmitFuncType>
+	void Flush(EmitFuncType&& Emit);
+
+	const std::vector<XBarrier>& GetPendingBarriers() const { return Barriers; }
+
+	uint32_t GetPendingTransitionCount() const { return (uint32_t)SplitTransitions.size(); }
+
+	const Stats& GetStats() const { return BatchStats; }
+
+private:
+	void AddTransitions(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter, uint32_t Flags);
+
+	void AddBarrier(const XBarrier& Barrier);
+
+	void EndSplitTransition(const XBarrier& Split);
+
+private:
+	std::vector<XBarrier> Barriers;
+
+	// Begun split transitions, ended with the same states
+	std::vector<XBarrier> SplitTransitions;
+
+	Stats BatchStats;
+};
+
+inline void XBarrierBatcher::Transition(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter)
+{
+	BatchStats.RequestCount++;
+
+	EndTransition(Resource, Subresource);
+
+	AddTransitions(Resource, State, Subresource, StateAfter, BarrierFlagNone);
+}
+
+inline void XBarrierBatcher::BeginTransition(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter)
+{
+	BatchStats.RequestCount++;
+
+	EndTransition(Resource, Subresource);
+
+	AddTransitions(Resource, State, Subresource, StateAfter, BarrierFlagBeginOnly);
+}
+
+inline void XBarrierBatcher::EndTransition(void* Resource, uint32_t Subresource)
+{
+	for (size_t i = 0; i < SplitTransitions.size();)
+	{
+		XBarrier& Split = SplitTransitions[i];
+
+		// A whole resource transition ends the transitions of its subresources and the other way around
+		const bool bMatch = Split.Resource == Resource && (Subresource == XResourceState::AllSubresources
+			|| Split.Subresource == XResourceState::AllSubresources || Split.Subresource == Subresource);
+
+		if (bMatch)
+		{
+			EndSplitTransition(Split);
+
+			SplitTransitions[i] = SplitTransitions.back();
+			SplitTransitions.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+inline void XBarrierBatcher::EndPendingTransitions()
+{
+	for (const XBarrier& Split : SplitTransitions)
+	{
+		EndSplitTransition(Split);
+	}
+
+	SplitTransitions.clear();
+}
+
+inline void XBarrierBatcher::AddTransitions(void* Resource, XResourceState& State, uint32_t Subresource, uint32_t StateAfter, uint32_t Flags)
+{
+	XBarrier Barrier;
+	Barrier.Resource = Resource;
+	Barrier.StateAfter = StateAfter;
+	Barrier.Flags = Flags;
+
+	if (Subresource == XResourceState::AllSubresources && !State.AreAllSubresourcesSame())
+	{
+		// One barrier per subresource not already in StateAfter
+		for (uint32_t i = 0; i < State.GetSubresourceCount(); i++)
+		{
+			Barrier.Subresource = i;
+			Barrier.StateBefore = State.GetSubresourceState(i);
+
+			if (Barrier.StateBefore != StateAfter)
+			{
+				AddBarrier(Barrier);
+			}
+		}
+	}
+	else
+	{
+		Barrier.Subresource = State.GetSubresourceCount() == 1 ? XResourceState::AllSubresources : Subresource;
+		Barrier.StateBefore = State.GetSubresourceState(Subresource == XResourceState::AllSubresources ? 0 : Subresource);
+
+		if (Barrier.StateBefore != StateAfter)
+		{
+			AddBarrier(Barrier);
+		}
+	}
+
+	// Split transitions are tracked in their final state, the resource is not used until they end
+	State.SetSubresourceState(Subresource, StateAfter);
+}
+
+inline void XBarrierBatcher::AddBarrier(const XBarrier& Barrier)
+{
+	if (Barrier.Flags == BarrierFlagBeginOnly)
+	{
+		SplitTransitions.push_back(Barrier);
+	}
+
+	// Collapse with the last transition of the same subresource in the batch, e.g. A->B then B->C becomes A->C
+	if (Barrier.Flags == BarrierFlagNone)
+	{
+		for (size_t i = Barriers.size(); i-- > 0;)
+		{
+			XBarrier& Previous = Barriers[i];
+			if (Previous.Resource != Barrier.Resource)
+			{
+				continue;
+			}
+
+			if (Previous.Subresource == Barrier.Subresource && Previous.Flags == BarrierFlagNone && Previous.StateAfter == Barrier.StateBefore)
+			{
+				BatchStats.CollapsedCount++;
+
+				if (Previous.StateBefore == Barrier.StateAfter)
+				{
+					Barriers.erase(Barriers.begin() + i);
+					BatchStats.CollapsedCount++;
+				}
+				else
+				{
+					Previous.StateAfter = Barrier.StateAfter;
+				}
+
+				return;
+			}
+
+			// Any other barrier of the resource keeps the order
+			break;
+		}
+	}
+
+	Barriers.push_back(Barrier);
+}
+
+inline void XBarrierBatcher::EndSplitTransition(const XBarrier& Split)
+{
+	// Begun in the same batch, nothing to overlap with: one full barrier instead
+	for (XBarrier& Barrier : Barriers)
+	{
+		if (Barrier == Split)
+		{
+			Barrier.Flags = BarrierFlagNone;
+			BatchStats.CollapsedCount++;
+
+			return;
+		}
+	}
+
+	XBarrier End = Split;
+	End.Flags = BarrierFlagEndOnly;
+	Barriers.push_back(End);
+}
+
+template<typename EmitFuncType>
+inline void XBarrierBatcher::Flush(EmitFuncType&& Emit)
+{
+	if (Barriers.empty())
+	{
+		return;
+	}
+
+	Emit(Barriers);
+
+	BatchStats.BarrierCount += Barriers.size();
+	BatchStats.FlushCount++;
+
+	Barriers.clear();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Fence.h"
+#include "RetirementQueue.h"
+#include <vector>
+
+// Device-independent allocator of the stable indices of a bindless descriptor table.
+// A freed index may still be read by the frames in flight, it is handed out again only
+// once the fence current at Free() has completed.
+class XBindlessIndexAllocator
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+public:
+	XBindlessIndexAllocator() {}
+
+	void Initialize(uint32_t InCapacity, XFence* InFence);
+
+	// Returns InvalidIndex if every index is used or waiting for its fence
+	uint32_t Allocate();
+
+	void Free(uint32_t Index);
+
+	// Make the indices whose fence has completed available again
+	void Retire();
+
+	uint32_t GetCapacity() const { return Capacity; }
+
+	uint32_t GetAllocatedCount() const { return AllocatedCount; }
+
+	uint32_t GetPendingCount() const { return (uint32_t)PendingIndices.GetSize(); }
+
+private:
+	uint32_t Capacity = 0;
+
+	XFence* Fence = nullptr;
+
+	// Indices below NextUnusedIndex that can be reused, the most recently retired last
+	std::vector<uint32_t> FreeIndices;
+
+	uint32_t NextUnusedIndex = 0;
+
+	XRetirementQueue<uint32_t> PendingIndices;
+
+	uint32_t AllocatedCount = 0;
+};
+
+inline void XBindlessIndexAllocator::Initialize(uint32_t InCapacity, XFence* InFence)
+{
+	assert(InCapacity > 0 && InFence != nullptr);
+
+	Capacity = InCapacity;
+	Fence = InFence;
+
+	FreeIndices.clear();
+	NextUnusedIndex = 0;
+	AllocatedCount = 0;
+}
+
+inline uint32_t XBindlessIndexAllocator::Allocate()
+{
+	if (FreeIndices.empty())
+	{
+		if (NextUnusedIndex < Capacity)
+		{
+			AllocatedCount++;
+
+			return NextUnusedIndex++;
+		}
+
+		Retire();
+
+		if (FreeIndices.empty())
+		{
+			return InvalidIndex;
+		}
+	}
+
+	const uint32_t Index = FreeIndices.back();
+	FreeIndices.pop_back();
+	AllocatedCount++;
+
+	return Index;
+}
+
+inline void XBindlessIndexAllocator::Free(uint32_t Index)
+{
+	assert(Index < NextUnusedIndex && AllocatedCount > 0);
+
+	PendingIndices.Enqueue(Index, Fence->GetCurrentValue());
+	AllocatedCount--;
+}
+
+inline void XBindlessIndexAllocator::Retire()
+{
+	PendingIndices.Retire(Fence->GetCompletedValue(), [this](uint32_t Index)
+	{
+		FreeIndices.push_back(Index);
+	});
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+class BitHelper
+{
+public:
+	// Index of the lowest set bit, Value must not be zero
+	static uint32_t FindLowestSetBit(uint64_t Value)
+	{
+		assert(Value != 0);
+
+#if defined(_MSC_VER)
+		unsigned long Result;
+		_BitScanForward64(&Result, Value);
+		return (uint32_t)Result;
+#else
+		return (uint32_t)__builtin_ctzll(Value);
+#endif
+	}
+
+	// Index of the highest set bit, Value must not be zero
+	static uint32_t FindHighestSetBit(uint64_t Value)
+	{
+		assert(Value != 0);
+
+#if defined(_MSC_VER)
+		unsigned long Result;
+		_BitScanReverse64(&Result, Value);
+		return (uint32_t)Result;
+#else
+		return 63u - (uint32_t)__builtin_clzll(Value);
+#endif
+	}
+
+	// ceil(log2(Value)), Value must not be zero
+	static uint32_t CeilLog2(uint64_t Value)
+	{
+		return Value == 1 ? 0 : FindHighestSetBit(Value - 1) + 1;
+	}
+
+	static bool IsPowerOfTwo(uint64_t Value)
+	{
+		return Value != 0 && (Value & (Value - 1)) == 0;
+	}
+};
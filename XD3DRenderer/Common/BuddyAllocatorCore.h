@@ -0,0 +1,356 @@
+#pragma once
+
+#include "BitHelper.h"
+#include "AllocatorStats.h"
+#include <vector>
+
+// Device-independent bookkeeping of a buddy allocator.
+// Blocks are addressed in units of MinBlockSize, the memory itself is owned by the caller (heap, buffer...).
+// Sizes and byte offsets are 64-bit, a pool can hold up to 2^31 blocks of MinBlockSize.
+// Every order keeps a bitmap of its free blocks and a doubly linked free list, so allocation and
+// deallocation only do bit scans and index updates, without any heap traffic after Initialize().
+class XBuddyAllocatorCore
+{
+public:
+	static constexpr uint32_t InvalidOffset = 0xFFFFFFFF;
+
+	struct Allocation
+	{
+		uint32_t Offset = InvalidOffset;  // In MinBlockSize units
+
+		uint32_t Order = 0;
+
+		uint64_t AlignedOffsetInBytes = 0;
+	};
+
+public:
+	XBuddyAllocatorCore() {}
+
+	XBuddyAllocatorCore(uint64_t InPoolSize, uint32_t InMinBlockSize)
+	{
+		Initialize(InPoolSize, InMinBlockSize);
+	}
+
+	// PoolSize / MinBlockSize must be a power of two
+	void Initialize(uint64_t InPoolSize, uint32_t InMinBlockSize);
+
+	bool Allocate(uint64_t Size, uint32_t Alignment, Allocation& OutAllocation);
+
+	void Deallocate(uint32_t Offset, uint32_t Order, uint64_t RequestedSize);
+
+	bool CanAllocate(uint64_t SizeToAllocate) const;
+
+	uint64_t GetSizeToAllocate(uint64_t Size, uint32_t Alignment) const;
+
+	uint64_t GetPoolSize() const { return PoolSize; }
+
+	uint32_t GetMinBlockSize() const { return MinBlockSize; }
+
+	uint32_t GetMaxOrder() const { return MaxOrder; }
+
+	uint64_t GetTotalAllocSize() const { return TotalAllocSize; }
+
+	XAllocatorStats GetStats() const;
+
+	// Size must not exceed the pool size
+	uint32_t SizeToUnitSize(uint64_t Size) const
+	{
+		return (uint32_t)((Size + (MinBlockSize - 1)) / MinBlockSize);
+	}
+
+	uint32_t UnitSizeToOrder(uint32_t UnitSize) const
+	{
+		return BitHelper::CeilLog2(UnitSize);
+	}
+
+	uint32_t OrderToUnitSize(uint32_t Order) const
+	{
+		return ((uint32_t)1) << Order;
+	}
+
+	uint64_t OrderToSize(uint32_t Order) const
+	{
+		return (uint64_t)OrderToUnitSize(Order) * MinBlockSize;
+	}
+
+	uint64_t GetAllocOffsetInBytes(uint32_t Offset) const { return (uint64_t)Offset * MinBlockSize; }
+
+private:
+	uint32_t AllocateBlock(uint32_t Order);
+
+	void DeallocateBlock(uint32_t Offset, uint32_t Order);
+
+	void PushFreeBlock(uint32_t Offset, uint32_t Order);
+
+	void RemoveFreeBlock(uint32_t Offset, uint32_t Order);
+
+	bool IsBlockFree(uint32_t Offset, uint32_t Order) const
+	{
+		const uint32_t BlockIndex = Offset >> Order;
+		return (FreeBitmaps[Order][BlockIndex >> 6] >> (BlockIndex & 63)) & 1;
+	}
+
+private:
+	uint64_t PoolSize = 0;
+
+	uint32_t MinBlockSize = 256;
+
+	uint32_t MaxOrder = 0;
+
+	uint64_t TotalAllocSize = 0;
+
+	uint64_t RequestedSize = 0;
+
+	uint32_t AllocationCount = 0;
+
+	uint32_t FreeBlockCount = 0;
+
+	XAllocationCounters Counters;
+
+	std::vector<uint32_t> FreeBlockCountPerOrder;
+
+	// Bit N is set if FreeListHeads[N] is not empty
+	uint64_t NonEmptyOrderMask = 0;
+
+	std::vector<uint32_t> FreeListHeads;
+
+	// Free list links, indexed by the unit offset of a free block.
+	// GPU memory can't hold the links itself, so they live in these side arrays.
+	std::vector<uint32_t> NextFreeBlocks;
+
+	std::vector<uint32_t> PrevFreeBlocks;
+
+	// One bit per block of each order, set if the block is free
+	std::vector<std::vector<uint64_t>> FreeBitmaps;
+};
+
+inline void XBuddyAllocatorCore::Initialize(uint64_t InPoolSize, uint32_t InMinBlockSize)
+{
+	PoolSize = InPoolSize;
+	MinBlockSize = InMinBlockSize;
+
+	// Unit offsets are 32-bit and InvalidOffset must stay out of range
+	assert(PoolSize / MinBlockSize <= 0x80000000ull);
+
+	const uint32_t TotalUnitSize = (uint32_t)(PoolSize / MinBlockSize);
+	assert(BitHelper::IsPowerOfTwo(TotalUnitSize) && (uint64_t)TotalUnitSize * MinBlockSize == PoolSize);
+
+	MaxOrder = UnitSizeToOrder(TotalUnitSize);
+	TotalAllocSize = 0;
+	RequestedSize = 0;
+	AllocationCount = 0;
+	FreeBlockCount = 0;
+	NonEmptyOrderMask = 0;
+	Counters.Reset();
+
+	FreeBlockCountPerOrder.assign(MaxOrder + 1, 0);
+	FreeListHeads.assign(MaxOrder + 1, InvalidOffset);
+	NextFreeBlocks.assign(TotalUnitSize, InvalidOffset);
+	PrevFreeBlocks.assign(TotalUnitSize, InvalidOffset);
+
+	FreeBitmaps.resize(MaxOrder + 1);
+	for (uint32_t Order = 0; Order <= MaxOrder; Order++)
+	{
+		const uint32_t BlockCount = TotalUnitSize >> Order;
+		FreeBitmaps[Order].assign((BlockCount + 63) / 64, 0);
+	}
+
+	// Add the free block for MaxOrder
+	PushFreeBlock(0, MaxOrder);
+}
+
+inline uint64_t XBuddyAllocatorCore::GetSizeToAllocate(uint64_t Size, uint32_t Alignment) const
+{
+	uint64_t SizeToAllocate = Size;
+
+	// If the alignment doesn't match the block size
+	if (Alignment != 0 && MinBlockSize % Alignment != 0)
+	{
+		// Blocks are aligned to their own size, a power of two alignment only needs padding if it is larger
+		const bool bNaturallyAligned = BitHelper::IsPowerOfTwo(Alignment) && Size != 0 && Size <= PoolSize
+			&& OrderToSize(UnitSizeToOrder(SizeToUnitSize(Size))) >= Alignment;
+
+		if (!bNaturallyAligned)
+		{
+			SizeToAllocate = Size + Alignment;
+		}
+	}
+
+	return SizeToAllocate;
+}
+
+inline bool XBuddyAllocatorCore::CanAllocate(uint64_t SizeToAllocate) const
+{
+	if (SizeToAllocate == 0 || SizeToAllocate > PoolSize)
+	{
+		return false;
+	}
+
+	const uint32_t Order = UnitSizeToOrder(SizeToUnitSize(SizeToAllocate));
+
+	return (NonEmptyOrderMask >> Order) != 0;
+}
+
+inline bool XBuddyAllocatorCore::Allocate(uint64_t Size, uint32_t Alignment, Allocation& OutAllocation)
+{
+	const uint64_t SizeToAllocate = GetSizeToAllocate(Size, Alignment);
+
+	if (!CanAllocate(SizeToAllocate))
+	{
+		return false;
+	}
+
+	const uint32_t Order = UnitSizeToOrder(SizeToUnitSize(SizeToAllocate));
+	const uint32_t Offset = AllocateBlock(Order);
+	TotalAllocSize += OrderToSize(Order);
+	RequestedSize += Size;
+	AllocationCount++;
+	Counters.RecordAllocation(Size);
+	Counters.RecordUsage(TotalAllocSize);
+
+	//Calculate AlignedOffsetFromResourceBase
+	const uint64_t OffsetInBytes = GetAllocOffsetInBytes(Offset);
+	uint64_t AlignedOffsetInBytes = OffsetInBytes;
+	if (Alignment != 0 && OffsetInBytes % Alignment != 0)
+	{
+		AlignedOffsetInBytes = ((OffsetInBytes + Alignment - 1) / Alignment) * Alignment;
+
+		uint64_t Padding = AlignedOffsetInBytes - OffsetInBytes;
+		assert((Padding + Size) <= OrderToSize(Order));
+	}
+
+	OutAllocation.Offset = Offset;
+	OutAllocation.Order = Order;
+	OutAllocation.AlignedOffsetInBytes = AlignedOffsetInBytes;
+
+	return true;
+}
+
+inline void XBuddyAllocatorCore::Deallocate(uint32_t Offset, uint32_t Order, uint64_t InRequestedSize)
+{
+	assert(Order <= MaxOrder && !IsBlockFree(Offset, Order));
+
+	DeallocateBlock(Offset, Order);
+
+	TotalAllocSize -= OrderToSize(Order);
+	RequestedSize -= InRequestedSize;
+	AllocationCount--;
+}
+
+inline XAllocatorStats XBuddyAllocatorCore::GetStats() const
+{
+	XAllocatorStats Stats;
+	Stats.PoolSize = PoolSize;
+	Stats.RequestedSize = RequestedSize;
+	Stats.AllocatedSize = TotalAllocSize;
+	Stats.FreeSize = PoolSize - TotalAllocSize;
+	Stats.FreeBlockCount = FreeBlockCount;
+	Stats.AllocationCount = AllocationCount;
+	Counters.CopyTo(Stats);
+
+	if (NonEmptyOrderMask != 0)
+	{
+		Stats.LargestFreeBlock = OrderToSize(BitHelper::FindHighestSetBit(NonEmptyOrderMask));
+	}
+
+	for (uint32_t Order = 0; Order <= MaxOrder; Order++)
+	{
+		Stats.FreeBlockHistogram[XAllocatorStats::GetFloorLog2Bucket(OrderToSize(Order))] += FreeBlockCountPerOrder[Order];
+	}
+
+	return Stats;
+}
+
+inline uint32_t XBuddyAllocatorCore::AllocateBlock(uint32_t Order)
+{
+	assert(Order <= MaxOrder);
+
+	// Smallest non-empty order that can hold the request
+	const uint64_t Candidates = NonEmptyOrderMask & (~0ull << Order);
+	assert(Candidates != 0);
+
+	uint32_t FreeOrder = BitHelper::FindLowestSetBit(Candidates);
+	const uint32_t Offset = FreeListHeads[FreeOrder];
+	RemoveFreeBlock(Offset, FreeOrder);
+
+	// Split down to the requested order, keep the left block and free the right ones
+	while (FreeOrder > Order)
+	{
+		FreeOrder--;
+		PushFreeBlock(Offset + OrderToUnitSize(FreeOrder), FreeOrder);
+	}
+
+	return Offset;
+}
+
+inline void XBuddyAllocatorCore::DeallocateBlock(uint32_t Offset, uint32_t Order)
+{
+	// Merge with the buddy block as long as it is free
+	while (Order < MaxOrder)
+	{
+		const uint32_t Buddy = Offset ^ OrderToUnitSize(Order);
+		if (!IsBlockFree(Buddy, Order))
+		{
+			break;
+		}
+
+		RemoveFreeBlock(Buddy, Order);
+
+		Offset = Offset < Buddy ? Offset : Buddy;
+		Order++;
+	}
+
+	PushFreeBlock(Offset, Order);
+}
+
+inline void XBuddyAllocatorCore::PushFreeBlock(uint32_t Offset, uint32_t Order)
+{
+	const uint32_t Head = FreeListHeads[Order];
+
+	NextFreeBlocks[Offset] = Head;
+	PrevFreeBlocks[Offset] = InvalidOffset;
+	if (Head != InvalidOffset)
+	{
+		PrevFreeBlocks[Head] = Offset;
+	}
+	FreeListHeads[Order] = Offset;
+
+	const uint32_t BlockIndex = Offset >> Order;
+	FreeBitmaps[Order][BlockIndex >> 6] |= (1ull << (BlockIndex & 63));
+
+	NonEmptyOrderMask |= (1ull << Order);
+
+	FreeBlockCountPerOrder[Order]++;
+	FreeBlockCount++;
+}
+
+inline void XBuddyAllocatorCore::RemoveFreeBlock(uint32_t Offset, uint32_t Order)
+{
+	const uint32_t Next = NextFreeBlocks[Offset];
+	const uint32_t Prev = PrevFreeBlocks[Offset];
+
+	if (Prev != InvalidOffset)
+	{
+		NextFreeBlocks[Prev] = Next;
+	}
+	else
+	{
+		FreeListHeads[Order] = Next;
+	}
+
+	if (Next != InvalidOffset)
+	{
+		PrevFreeBlocks[Next] = Prev;
+	}
+
+	const uint32_t BlockIndex = Offset >> Order;
+	FreeBitmaps[Order][BlockIndex >> 6] &= ~(1ull << (BlockIndex & 63));
+
+	if (FreeListHeads[Order] == InvalidOffset)
+	{
+		NonEmptyOrderMask &= ~(1ull << Order);
+	}
+
+	FreeBlockCountPerOrder[Order]--;
+	FreeBlockCount--;
+}
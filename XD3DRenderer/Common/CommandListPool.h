@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Fence.h"
+#include "RetirementQueue.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+// Device-independent recycling of command recording contexts (a command list and its allocator)
+// between threads. A submitted context is handed out again once the fence it was released with has completed.
+template<typename ContextType>
+class XCommandListPool
+{
+public:
+	XCommandListPool(XFence* InFence, std::function<ContextType*()> InCreateContext)
+		: Fence(InFence), CreateContext(InCreateContext)
+	{
+		assert(Fence != nullptr);
+	}
+
+	// Thread safe. A context the GPU is done with, or a new one; the caller resets it before recording
+	ContextType* Acquire();
+
+	// Thread safe. Called once the context was submitted, FenceValue is signaled after its work
+	void Release(ContextType* Context, uint64_t FenceValue);
+
+	uint32_t GetContextCount() const { return (uint32_t)Contexts.size(); }
+
+private:
+	XFence* Fence = nullptr;
+
+	std::function<ContextType*()> CreateContext;
+
+	std::mutex Mutex;
+
+	std::vector<std::unique_ptr<ContextType>> Contexts;
+
+	std::vector<ContextType*> AvailableContexts;
+
+	XRetirementQueue<ContextType*> SubmittedContexts;
+};
+
+template<typename ContextType>
+inline ContextType* XCommandListPool<ContextType>::Acquire()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	if (AvailableContexts.empty())
+	{
+		SubmittedContexts.Retire(Fence->GetCompletedValue(), [this](ContextType* Context)
+		{
+			AvailableContexts.push_back(Context);
+		});
+	}
+
+	if (AvailableContexts.empty())
+	{
+		Contexts.emplace_back(CreateContext());
+
+		return Contexts.back().get();
+	}
+
+	ContextType* Context = AvailableContexts.back();
+	AvailableContexts.pop_back();
+
+	return Context;
+}
+
+template<typename ContextType>
+inline void XCommandListPool<ContextType>::Release(ContextType* Context, uint64_t FenceValue)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	SubmittedContexts.Enqueue(Context, FenceValue);
+}
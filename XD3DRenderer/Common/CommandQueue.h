@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Fence.h"
+#include <deque>
+
+// Device-independent view of a GPU queue and its fence, what frame pacing needs to know about it
+class XCommandQueue
+{
+public:
+	virtual ~XCommandQueue() {}
+
+	// Signal the fence once the work submitted so far has completed, returns the signaled value
+	virtual uint64_t Signal() = 0;
+
+	// Block the CPU until the GPU has reached FenceValue
+	virtual void WaitForFence(uint64_t FenceValue) = 0;
+
+	// Make the work submitted to this queue from now on wait until OtherQueue has reached FenceValue,
+	// e.g. a compute pass that reads what a graphics pass wrote. The CPU does not block.
+	virtual void WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue) = 0;
+
+	virtual XFence* GetFence() = 0;
+};
+
+// Queue with a simulated GPU, to measure pacing without a device.
+// Time is in arbitrary units: the caller advances the CPU clock for its own work, Submit() adds GPU work,
+// and the GPU runs the submitted work in order, Latency units after it was signaled at the earliest.
+// Queues waiting on each other must be simulated queues whose CPU clocks are advanced together.
+class XSimulatedCommandQueue : public XCommandQueue
+{
+public:
+	XSimulatedCommandQueue(uint64_t InLatency = 0) : Latency(InLatency), Fence(this) {}
+
+	// GPU cost of the work recorded until the next Signal()
+	void Submit(uint64_t GpuTime) { PendingGpuTime += GpuTime; }
+
+	void AdvanceCpuTime(uint64_t Time) { CpuTime += Time; }
+
+	virtual uint64_t Signal() override
+	{
+		uint64_t StartTime = CpuTime + Latency > GpuBusyUntil ? CpuTime + Latency : GpuBusyUntil;
+		StartTime = StartTime > GpuWaitUntil ? StartTime : GpuWaitUntil;
+		GpuBusyUntil = StartTime + PendingGpuTime;
+		GpuBusyTime += PendingGpuTime;
+		PendingGpuTime = 0;
+
+		const uint64_t SignaledValue = CurrentValue++;
+		PendingSignals.push_back({ SignaledValue, GpuBusyUntil });
+
+		return SignaledValue;
+	}
+
+	virtual void WaitForFence(uint64_t FenceValue) override
+	{
+		if (Fence.IsFenceComplete(FenceValue))
+		{
+			return;
+		}
+
+		// Signals complete in order, jump to the one we wait for
+		for (const PendingSignal& Signal : PendingSignals)
+		{
+			if (Signal.FenceValue >= FenceValue)
+			{
+				CpuStallTime += Signal.CompletionTime - CpuTime;
+				CpuTime = Signal.CompletionTime;
+				WaitCount++;
+				break;
+			}
+		}
+
+		assert(Fence.IsFenceComplete(FenceValue));
+	}
+
+	// The work pending since the last Signal() waits too
+	virtual void WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue) override
+	{
+		XSimulatedCommandQueue* Other = static_cast<XSimulatedCommandQueue*>(OtherQueue);
+		assert(FenceValue < Other->CurrentValue);
+
+		for (const PendingSignal& Signal : Other->PendingSignals)
+		{
+			if (Signal.FenceValue >= FenceValue)
+			{
+				GpuWaitUntil = Signal.CompletionTime > GpuWaitUntil ? Signal.CompletionTime : GpuWaitUntil;
+				break;
+			}
+		}
+	}
+
+	virtual XFence* GetFence() override { return &Fence; }
+
+	uint64_t GetCpuTime() const { return CpuTime; }
+
+	// Time the CPU spent blocked in WaitForFence
+	uint64_t GetCpuStallTime() const { return CpuStallTime; }
+
+	// Time the GPU spent executing work, the rest of GetCpuTime() it was idle
+	uint64_t GetGpuBusyTime() const { return GpuBusyTime; }
+
+	uint32_t GetWaitCount() const { return WaitCount; }
+
+private:
+	class XSimulatedFence : public XFence
+	{
+	public:
+		XSimulatedFence(XSimulatedCommandQueue* InQueue) : Queue(InQueue) {}
+
+		virtual uint64_t GetCompletedValue() override
+		{
+			while (!Queue->PendingSignals.empty() && Queue->PendingSignals.front().CompletionTime <= Queue->CpuTime)
+			{
+				CompletedValue = Queue->PendingSignals.front().FenceValue;
+				Queue->PendingSignals.pop_front();
+			}
+
+			return CompletedValue;
+		}
+
+		virtual uint64_t GetCurrentValue() const override { return Queue->CurrentValue; }
+
+	private:
+		XSimulatedCommandQueue* Queue = nullptr;
+
+		uint64_t CompletedValue = 0;
+	};
+
+	struct PendingSignal
+	{
+		uint64_t FenceValue;
+
+		uint64_t CompletionTime;
+	};
+
+	uint64_t Latency = 0;
+
+	XSimulatedFence Fence;
+
+	std::deque<PendingSignal> PendingSignals;
+
+	uint64_t CurrentValue = 1;
+
+	uint64_t CpuTime = 0;
+
+	uint64_t GpuBusyUntil = 0;
+
+	// Completion time of the work of other queues the next submission waits for
+	uint64_t GpuWaitUntil = 0;
+
+	uint64_t PendingGpuTime = 0;
+
+	uint64_t GpuBusyTime = 0;
+
+	uint64_t CpuStallTime = 0;
+
+	uint32_t WaitCount = 0;
+};
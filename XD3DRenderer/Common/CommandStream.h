@@ -0,0 +1,588 @@
+#pragma once
+
+#include "BarrierBatcher.h"
+#include <string.h>
+#include <string>
+
+// What a frame records: bindings, barriers, draws, dispatches and copies.
+// Resources, pipeline states and root signatures are opaque handles owned by the caller, GPU addresses and
+// descriptor handles are passed as integers, states and formats as their D3D12 values.
+// bCompute selects the compute root signature bindings instead of the graphics ones.
+class XCommandTarget
+{
+public:
+	virtual ~XCommandTarget() {}
+
+	virtual void SetPipelineState(void* PipelineState) = 0;
+
+	virtual void SetRootSignature(void* RootSignature, bool bCompute) = 0;
+
+	virtual void SetRootDescriptorTable(uint32_t Slot, uint64_t GpuDescriptorHandle, bool bCompute) = 0;
+
+	virtual void SetRootConstantBufferView(uint32_t Slot, uint64_t GpuVirtualAddress, bool bCompute) = 0;
+
+	virtual void SetRootConstants(uint32_t Slot, uint32_t Count, const uint32_t* Constants, bool bCompute) = 0;
+
+	virtual void SetVertexBuffer(uint32_t Slot, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride) = 0;
+
+	virtual void SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Format) = 0;
+
+	virtual void ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers) = 0;
+
+	virtual void Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance) = 0;
+
+	virtual void DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance) = 0;
+
+	virtual void Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ) = 0;
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) = 0;
+
+	virtual void CopyResource(void* DstResource, void* SrcResource) = 0;
+};
+
+enum class ECommandType : uint32_t
+{
+	SetPipelineState,
+	SetRootSignature,
+	SetRootDescriptorTable,
+	SetRootConstantBufferView,
+	SetRootConstants,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	ResourceBarriers,
+	Draw,
+	DrawIndexed,
+	Dispatch,
+	CopyBufferRegion,
+	CopyResource,
+	Count,
+};
+
+// Compact CPU-side encoding of the commands of a frame, replayed later into any target:
+// the D3D12 command list, or XNullCommandTarget to validate and count them without a device.
+// Each command is a header followed by its arguments, padded to 8 bytes.
+class XCommandStream : public XCommandTarget
+{
+public:
+	virtual void SetPipelineState(void* PipelineState) override;
+
+	virtual void SetRootSignature(void* RootSignature, bool bCompute) override;
+
+	virtual void SetRootDescriptorTable(uint32_t Slot, uint64_t GpuDescriptorHandle, bool bCompute) override;
+
+	virtual void SetRootConstantBufferView(uint32_t Slot, uint64_t GpuVirtualAddress, bool bCompute) override;
+
+	virtual void SetRootConstants(uint32_t Slot, uint32_t Count, const uint32_t* Constants, bool bCompute) override;
+
+	virtual void SetVertexBuffer(uint32_t Slot, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride) override;
+
+	virtual void SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Format) override;
+
+	virtual void ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers) override;
+
+	virtual void Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance) override;
+
+	virtual void DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance) override;
+
+	virtual void Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ) override;
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override;
+
+	virtual void CopyResource(void* DstResource, void* SrcResource) override;
+
+	// Issue the recorded commands to Target, in order. The stream can be replayed several times.
+	void Replay(XCommandTarget& Target) const;
+
+	// Forget the commands, keeping the memory
+	void Reset()
+	{
+		Data.clear();
+		CommandCount = 0;
+	}
+
+	size_t GetSize() const { return Data.size(); }
+
+	uint32_t GetCommandCount() const { return CommandCount; }
+
+private:
+	struct Header
+	{
+		ECommandType Type;
+
+		// Of the whole command, header included
+		uint32_t Size;
+	};
+
+	struct RootBindingArgs
+	{
+		uint64_t Value;
+
+		uint32_t Slot;
+
+		uint32_t bCompute;
+	};
+
+	struct RootConstantsArgs
+	{
+		uint32_t Slot;
+
+		uint32_t Count;
+
+		uint32_t bCompute;
+	};
+
+	struct VertexBufferArgs
+	{
+		uint64_t GpuVirtualAddress;
+
+		uint32_t Slot;
+
+		uint32_t Size;
+
+		uint32_t Stride;
+	};
+
+	struct IndexBufferArgs
+	{
+		uint64_t GpuVirtualAddress;
+
+		uint32_t Size;
+
+		uint32_t Format;
+	};
+
+	struct DrawArgs
+	{
+		uint32_t Count;
+
+		uint32_t InstanceCount;
+
+		uint32_t Start;
+
+		int32_t BaseVertex;
+
+		uint32_t StartInstance;
+	};
+
+	struct CopyArgs
+	{
+		void* DstResource;
+
+		void* SrcResource;
+
+		uint64_t DstOffset;
+
+		uint64_t SrcOffset;
+
+		uint64_t Size;
+	};
+
+	// Appends the command, Extra (e.g. the constants) follows the arguments
+	template<typename ArgsType>
+	void Write(ECommandType Type, const ArgsType& Args, const void* Extra = nullptr, uint32_t ExtraSize = 0);
+
+	template<typename ArgsType>
+	static ArgsType Read(const uint8_t* Command)
+	{
+		ArgsType Args;
+		memcpy(&Args, Command + sizeof(Header), sizeof(ArgsType));
+
+		return Args;
+	}
+
+private:
+	std::vector<uint8_t> Data;
+
+	uint32_t CommandCount = 0;
+
+	// Scratch for the variable sized arguments while replaying
+	mutable std::vector<uint32_t> ReplayConstants;
+
+	mutable std::vector<XBarrierBatcher::XBarrier> ReplayBarriers;
+};
+
+template<typename ArgsType>
+inline void XCommandStream::Write(ECommandType Type, const ArgsType& Args, const void* Extra, uint32_t ExtraSize)
+{
+	const uint32_t Size = (uint32_t)((sizeof(Header) + sizeof(ArgsType) + ExtraSize + 7) & ~7ull);
+
+	const size_t Offset = Data.size();
+	Data.resize(Offset + Size);
+
+	Header CommandHeader = { Type, Size };
+	memcpy(&Data[Offset], &CommandHeader, sizeof(Header));
+	memcpy(&Data[Offset + sizeof(Header)], &Args, sizeof(ArgsType));
+
+	if (ExtraSize > 0)
+	{
+		memcpy(&Data[Offset + sizeof(Header) + sizeof(ArgsType)], Extra, ExtraSize);
+	}
+
+	CommandCount++;
+}
+
+inline void XCommandStream::SetPipelineState(void* PipelineState)
+{
+	Write(ECommandType::SetPipelineState, PipelineState);
+}
+
+inline void XCommandStream::SetRootSignature(void* RootSignature, bool bCompute)
+{
+	Write(ECommandType::SetRootSignature, RootBindingArgs{ (uint64_t)(uintptr_t)RootSignature, 0, bCompute });
+}
+
+inline void XCommandStream::SetRootDescriptorTable(uint32_t Slot, uint64_t GpuDescriptorHandle, bool bCompute)
+{
+	Write(ECommandType::SetRootDescriptorTable, RootBindingArgs{ GpuDescriptorHandle, Slot, bCompute });
+}
+
+inline void XCommandStream::SetRootConstantBufferView(uint32_t Slot, uint64_t GpuVirtualAddress, bool bCompute)
+{
+	Write(ECommandType::SetRootConstantBufferView, RootBindingArgs{ GpuVirtualAddress, Slot, bCompute });
+}
+
+inline void XCommandStream::SetRootConstants(uint32_t Slot, uint32_t Count, const uint32_t* Constants, bool bCompute)
+{
+	Write(ECommandType::SetRootConstants, RootConstantsArgs{ Slot, Count, bCompute }, Constants, Count * (uint32_t)sizeof(uint32_t));
+}
+
+inline void XCommandStream::SetVertexBuffer(uint32_t Slot, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride)
+{
+	Write(ECommandType::SetVertexBuffer, VertexBufferArgs{ GpuVirtualAddress, Slot, Size, Stride });
+}
+
+inline void XCommandStream::SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Format)
+{
+	Write(ECommandType::SetIndexBuffer, IndexBufferArgs{ GpuVirtualAddress, Size, Format });
+}
+
+inline void XCommandStream::ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers)
+{
+	Write(ECommandType::ResourceBarriers, Count, Barriers, Count * (uint32_t)sizeof(XBarrierBatcher::XBarrier));
+}
+
+inline void XCommandStream::Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance)
+{
+	Write(ECommandType::Draw, DrawArgs{ VertexCount, InstanceCount, StartVertex, 0, StartInstance });
+}
+
+inline void XCommandStream::DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance)
+{
+	Write(ECommandType::DrawIndexed, DrawArgs{ IndexCount, InstanceCount, StartIndex, BaseVertex, StartInstance });
+}
+
+inline void XCommandStream::Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ)
+{
+	const uint32_t GroupCounts[3] = { GroupCountX, GroupCountY, GroupCountZ };
+
+	Write(ECommandType::Dispatch, GroupCounts);
+}
+
+inline void XCommandStream::CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size)
+{
+	Write(ECommandType::CopyBufferRegion, CopyArgs{ DstResource, SrcResource, DstOffset, SrcOffset, Size });
+}
+
+inline void XCommandStream::CopyResource(void* DstResource, void* SrcResource)
+{
+	Write(ECommandType::CopyResource, CopyArgs{ DstResource, SrcResource, 0, 0, 0 });
+}
+
+inline void XCommandStream::Replay(XCommandTarget& Target) const
+{
+	size_t Offset = 0;
+	while (Offset < Data.size())
+	{
+		const uint8_t* Command = &Data[Offset];
+
+		Header CommandHeader;
+		memcpy(&CommandHeader, Command, sizeof(Header));
+		assert(CommandHeader.Size >= sizeof(Header) && Offset + CommandHeader.Size <= Data.size());
+
+		switch (CommandHeader.Type)
+		{
+		case ECommandType::SetPipelineState:
+			Target.SetPipelineState(Read<void*>(Command));
+			break;
+
+		case ECommandType::SetRootSignature:
+		{
+			const RootBindingArgs Args = Read<RootBindingArgs>(Command);
+			Target.SetRootSignature((void*)(uintptr_t)Args.Value, Args.bCompute != 0);
+			break;
+		}
+
+		case ECommandType::SetRootDescriptorTable:
+		{
+			const RootBindingArgs Args = Read<RootBindingArgs>(Command);
+			Target.SetRootDescriptorTable(Args.Slot, Args.Value, Args.bCompute != 0);
+			break;
+		}
+
+		case ECommandType::SetRootConstantBufferView:
+		{
+			const RootBindingArgs Args = Read<RootBindingArgs>(Command);
+			Target.SetRootConstantBufferView(Args.Slot, Args.Value, Args.bCompute != 0);
+			break;
+		}
+
+		case ECommandType::SetRootConstants:
+		{
+			const RootConstantsArgs Args = Read<RootConstantsArgs>(Command);
+			ReplayConstants.resize(Args.Count);
+			if (Args.Count > 0)
+			{
+				memcpy(ReplayConstants.data(), Command + sizeof(Header) + sizeof(RootConstantsArgs), Args.Count * sizeof(uint32_t));
+			}
+			Target.SetRootConstants(Args.Slot, Args.Count, ReplayConstants.data(), Args.bCompute != 0);
+			break;
+		}
+
+		case ECommandType::SetVertexBuffer:
+		{
+			const VertexBufferArgs Args = Read<VertexBufferArgs>(Command);
+			Target.SetVertexBuffer(Args.Slot, Args.GpuVirtualAddress, Args.Size, Args.Stride);
+			break;
+		}
+
+		case ECommandType::SetIndexBuffer:
+		{
+			const IndexBufferArgs Args = Read<IndexBufferArgs>(Command);
+			Target.SetIndexBuffer(Args.GpuVirtualAddress, Args.Size, Args.Format);
+			break;
+		}
+
+		case ECommandType::ResourceBarriers:
+		{
+			const uint32_t Count = Read<uint32_t>(Command);
+			ReplayBarriers.resize(Count);
+			if (Count > 0)
+			{
+				memcpy(ReplayBarriers.data(), Command + sizeof(Header) + sizeof(uint32_t), Count * sizeof(XBarrierBatcher::XBarrier));
+			}
+			Target.ResourceBarriers(Count, ReplayBarriers.data());
+			break;
+		}
+
+		case ECommandType::Draw:
+		{
+			const DrawArgs Args = Read<DrawArgs>(Command);
+			Target.Draw(Args.Count, Args.InstanceCount, Args.Start, Args.StartInstance);
+			break;
+		}
+
+		case ECommandType::DrawIndexed:
+		{
+			const DrawArgs Args = Read<DrawArgs>(Command);
+			Target.DrawIndexed(Args.Count, Args.InstanceCount, Args.Start, Args.BaseVertex, Args.StartInstance);
+			break;
+		}
+
+		case ECommandType::Dispatch:
+		{
+			uint32_t GroupCounts[3];
+			memcpy(GroupCounts, Command + sizeof(Header), sizeof(GroupCounts));
+			Target.Dispatch(GroupCounts[0], GroupCounts[1], GroupCounts[2]);
+			break;
+		}
+
+		case ECommandType::CopyBufferRegion:
+		{
+			const CopyArgs Args = Read<CopyArgs>(Command);
+			Target.CopyBufferRegion(Args.DstResource, Args.DstOffset, Args.SrcResource, Args.SrcOffset, Args.Size);
+			break;
+		}
+
+		case ECommandType::CopyResource:
+		{
+			const CopyArgs Args = Read<CopyArgs>(Command);
+			Target.CopyResource(Args.DstResource, Args.SrcResource);
+			break;
+		}
+
+		default:
+			assert(0);
+			break;
+		}
+
+		Offset += CommandHeader.Size;
+	}
+}
+
+// Target that only validates and counts the commands, to run a frame headless.
+// A command is invalid when D3D12 would reject it, e.g. a draw without a pipeline state or a no-op barrier.
+class XNullCommandTarget : public XCommandTarget
+{
+public:
+	struct Stats
+	{
+		uint64_t CommandCounts[(uint32_t)ECommandType::Count] = {};
+
+		uint64_t BarrierCount = 0;
+
+		uint64_t PrimitiveVertexCount = 0;
+
+		uint64_t CopiedSize = 0;
+
+		uint64_t ErrorCount = 0;
+	};
+
+public:
+	virtual void SetPipelineState(void* PipelineState) override
+	{
+		Count(ECommandType::SetPipelineState);
+		Check(PipelineState != nullptr, "SetPipelineState", "null pipeline state");
+
+		bPipelineStateSet = PipelineState != nullptr;
+	}
+
+	virtual void SetRootSignature(void* RootSignature, bool bCompute) override
+	{
+		Count(ECommandType::SetRootSignature);
+		Check(RootSignature != nullptr, "SetRootSignature", "null root signature");
+
+		(bCompute ? bComputeRootSignatureSet : bGraphicsRootSignatureSet) = RootSignature != nullptr;
+	}
+
+	virtual void SetRootDescriptorTable(uint32_t /*Slot*/, uint64_t GpuDescriptorHandle, bool bCompute) override
+	{
+		Count(ECommandType::SetRootDescriptorTable);
+		CheckRootSignature(bCompute, "SetRootDescriptorTable");
+		Check(GpuDescriptorHandle != 0, "SetRootDescriptorTable", "null descriptor handle");
+	}
+
+	virtual void SetRootConstantBufferView(uint32_t /*Slot*/, uint64_t GpuVirtualAddress, bool bCompute) override
+	{
+		Count(ECommandType::SetRootConstantBufferView);
+		CheckRootSignature(bCompute, "SetRootConstantBufferView");
+		Check(GpuVirtualAddress % 256 == 0, "SetRootConstantBufferView", "address not 256 bytes aligned");
+	}
+
+	virtual void SetRootConstants(uint32_t /*Slot*/, uint32_t ConstantCount, const uint32_t* Constants, bool bCompute) override
+	{
+		Count(ECommandType::SetRootConstants);
+		CheckRootSignature(bCompute, "SetRootConstants");
+		Check(ConstantCount > 0 && Constants != nullptr, "SetRootConstants", "no constants");
+	}
+
+	virtual void SetVertexBuffer(uint32_t /*Slot*/, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride) override
+	{
+		Count(ECommandType::SetVertexBuffer);
+		Check(GpuVirtualAddress != 0 && Stride > 0 && Size >= Stride, "SetVertexBuffer", "invalid view");
+	}
+
+	virtual void SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t /*Format*/) override
+	{
+		Count(ECommandType::SetIndexBuffer);
+		Check(GpuVirtualAddress != 0 && Size > 0, "SetIndexBuffer", "invalid view");
+
+		bIndexBufferSet = GpuVirtualAddress != 0;
+	}
+
+	virtual void ResourceBarriers(uint32_t BarrierCount, const XBarrierBatcher::XBarrier* Barriers) override
+	{
+		Count(ECommandType::ResourceBarriers);
+		Check(BarrierCount > 0, "ResourceBarriers", "empty list");
+
+		for (uint32_t i = 0; i < BarrierCount; i++)
+		{
+			Check(Barriers[i].Resource != nullptr, "ResourceBarriers", "null resource");
+			Check(Barriers[i].StateBefore != Barriers[i].StateAfter, "ResourceBarriers", "StateBefore equals StateAfter");
+		}
+
+		FrameStats.BarrierCount += BarrierCount;
+	}
+
+	virtual void Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t /*StartVertex*/, uint32_t /*StartInstance*/) override
+	{
+		Count(ECommandType::Draw);
+		CheckDraw("Draw");
+
+		FrameStats.PrimitiveVertexCount += (uint64_t)VertexCount * InstanceCount;
+	}
+
+	virtual void DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t /*StartIndex*/, int32_t /*BaseVertex*/, uint32_t /*StartInstance*/) override
+	{
+		Count(ECommandType::DrawIndexed);
+		CheckDraw("DrawIndexed");
+		Check(bIndexBufferSet, "DrawIndexed", "no index buffer");
+
+		FrameStats.PrimitiveVertexCount += (uint64_t)IndexCount * InstanceCount;
+	}
+
+	virtual void Dispatch(uint32_t /*GroupCountX*/, uint32_t /*GroupCountY*/, uint32_t /*GroupCountZ*/) override
+	{
+		Count(ECommandType::Dispatch);
+		Check(bPipelineStateSet && bComputeRootSignatureSet, "Dispatch", "no pipeline state or compute root signature");
+	}
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override
+	{
+		Count(ECommandType::CopyBufferRegion);
+		Check(DstResource != nullptr && SrcResource != nullptr && Size > 0, "CopyBufferRegion", "invalid copy");
+		Check(DstResource != SrcResource || DstOffset + Size <= SrcOffset || SrcOffset + Size <= DstOffset, "CopyBufferRegion", "overlapping regions");
+
+		FrameStats.CopiedSize += Size;
+	}
+
+	virtual void CopyResource(void* DstResource, void* SrcResource) override
+	{
+		Count(ECommandType::CopyResource);
+		Check(DstResource != nullptr && SrcResource != nullptr && DstResource != SrcResource, "CopyResource", "invalid copy");
+	}
+
+	// Forget the bound state, like a new command list
+	void ResetState()
+	{
+		bPipelineStateSet = false;
+		bGraphicsRootSignatureSet = false;
+		bComputeRootSignatureSet = false;
+		bIndexBufferSet = false;
+	}
+
+	const Stats& GetStats() const { return FrameStats; }
+
+	// The first errors, the following ones are only counted
+	const std::vector<std::string>& GetErrors() const { return Errors; }
+
+private:
+	void Count(ECommandType Type) { FrameStats.CommandCounts[(uint32_t)Type]++; }
+
+	void Check(bool bValid, const char* Command, const char* Error)
+	{
+		if (!bValid)
+		{
+			FrameStats.ErrorCount++;
+
+			if (Errors.size() < MaxErrorCount)
+			{
+				Errors.push_back(std::string(Command) + ": " + Error);
+			}
+		}
+	}
+
+	void CheckRootSignature(bool bCompute, const char* Command)
+	{
+		Check(bCompute ? bComputeRootSignatureSet : bGraphicsRootSignatureSet, Command, "no root signature");
+	}
+
+	void CheckDraw(const char* Command)
+	{
+		Check(bPipelineStateSet && bGraphicsRootSignatureSet, Command, "no pipeline state or graphics root signature");
+	}
+
+private:
+	static const size_t MaxErrorCount = 64;
+
+	Stats FrameStats;
+
+	std::vector<std::string> Errors;
+
+	bool bPipelineStateSet = false;
+
+	bool bGraphicsRootSignatureSet = false;
+
+	bool bComputeRootSignatureSet = false;
+
+	bool bIndexBufferSet = false;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Device-independent recorder of buffer to buffer copies.
+// Resources are opaque handles owned by the caller, e.g. the backing resource of an allocator pool.
+class XCopyQueue
+{
+public:
+	virtual ~XCopyQueue() {}
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) = 0;
+};
+
+// Records the copies instead of executing them, to check copy based logic without a device
+class XMockCopyQueue : public XCopyQueue
+{
+public:
+	struct Copy
+	{
+		void* DstResource;
+
+		uint64_t DstOffset;
+
+		void* SrcResource;
+
+		uint64_t SrcOffset;
+
+		uint64_t Size;
+	};
+
+public:
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override
+	{
+		Copies.push_back({ DstResource, DstOffset, SrcResource, SrcOffset, Size });
+
+		CopiedSize += Size;
+	}
+
+	void Reset()
+	{
+		Copies.clear();
+
+		CopiedSize = 0;
+	}
+
+public:
+	std::vector<Copy> Copies;
+
+	uint64_t CopiedSize = 0;
+};
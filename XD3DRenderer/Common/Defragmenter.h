@@ -0,0 +1,125 @@
+#pragma once
+
+#include "AllocatorStats.h"
+#include "CopyQueue.h"
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+// Device-independent planning of an incremental compaction over a set of pools.
+// Allocations of the least used pools are moved into the most used ones, so the former end up empty
+// and can be released. Each Step() moves at most MaxBytes, which spreads the copies over several frames.
+// Pools and allocations are opaque to the defragmenter, the caller places the new blocks and releases the old ones.
+class XDefragmenter
+{
+public:
+	struct Pool
+	{
+		XAllocatorStats Stats;
+
+		void* Resource = nullptr;  // Handed to the copy queue
+	};
+
+	struct Candidate
+	{
+		void* Handle = nullptr;  // Caller side allocation, passed back to the callbacks
+
+		uint32_t PoolIndex = 0;
+
+		uint64_t Offset = 0;  // From the start of the pool resource
+
+		uint64_t Size = 0;
+	};
+
+public:
+	// Only pools used below this ratio are evacuated
+	void SetMaxSourceUsage(float InMaxSourceUsage) { MaxSourceUsage = InMaxSourceUsage; }
+
+	// AllocateFunc(DstPoolIndex, Candidate, uint64_t& OutOffset) places a copy of Candidate in the pool, returns false if it doesn't fit.
+	// RelocateFunc(Candidate) is called once the copy is recorded, it has to switch the allocation to its new block
+	// and release the old one, after the GPU is done with it.
+	// Returns the number of bytes moved.
+	template<typename AllocateFuncType, typename RelocateFuncType>
+	uint64_t Step(const std::vector<Pool>& Pools, const std::vector<Candidate>& Candidates, XCopyQueue& CopyQueue, uint64_t MaxBytes,
+		AllocateFuncType&& AllocateFunc, RelocateFuncType&& RelocateFunc) const;
+
+	static float GetUsage(const XAllocatorStats& Stats)
+	{
+		return Stats.PoolSize == 0 ? 1.0f : (float)((double)Stats.AllocatedSize / (double)Stats.PoolSize);
+	}
+
+private:
+	float MaxSourceUsage = 0.5f;
+};
+
+template<typename AllocateFuncType, typename RelocateFuncType>
+inline uint64_t XDefragmenter::Step(const std::vector<Pool>& Pools, const std::vector<Candidate>& Candidates, XCopyQueue& CopyQueue, uint64_t MaxBytes,
+	AllocateFuncType&& AllocateFunc, RelocateFuncType&& RelocateFunc) const
+{
+	if (Pools.size() < 2 || MaxBytes == 0)
+	{
+		return 0;
+	}
+
+	// Least used pools first, they are the cheapest to empty
+	std::vector<uint32_t> SortedPools(Pools.size());
+	for (uint32_t i = 0; i < (uint32_t)Pools.size(); i++)
+	{
+		SortedPools[i] = i;
+	}
+	std::stable_sort(SortedPools.begin(), SortedPools.end(), [&Pools](uint32_t A, uint32_t B)
+	{
+		return GetUsage(Pools[A].Stats) < GetUsage(Pools[B].Stats);
+	});
+
+	uint64_t MovedSize = 0;
+
+	for (uint32_t SrcRank = 0; SrcRank + 1 < (uint32_t)SortedPools.size(); SrcRank++)
+	{
+		const uint32_t SrcPoolIndex = SortedPools[SrcRank];
+		if (GetUsage(Pools[SrcPoolIndex].Stats) >= MaxSourceUsage)
+		{
+			break;
+		}
+
+		for (const Candidate& Allocation : Candidates)
+		{
+			if (Allocation.PoolIndex != SrcPoolIndex)
+			{
+				continue;
+			}
+
+			if (MovedSize + Allocation.Size > MaxBytes)
+			{
+				return MovedSize;
+			}
+
+			// Only move towards more used pools, so allocations never bounce between two pools.
+			// The fullest pool is tried first to keep the free space of the others in one piece.
+			for (uint32_t DstRank = (uint32_t)SortedPools.size() - 1; DstRank > SrcRank; DstRank--)
+			{
+				const uint32_t DstPoolIndex = SortedPools[DstRank];
+				if (Pools[DstPoolIndex].Stats.LargestFreeBlock < Allocation.Size)
+				{
+					continue;
+				}
+
+				uint64_t NewOffset = 0;
+				if (!AllocateFunc(DstPoolIndex, Allocation, NewOffset))
+				{
+					continue;
+				}
+
+				CopyQueue.CopyBufferRegion(Pools[DstPoolIndex].Resource, NewOffset, Pools[SrcPoolIndex].Resource, Allocation.Offset, Allocation.Size);
+
+				RelocateFunc(Allocation);
+
+				MovedSize += Allocation.Size;
+
+				break;
+			}
+		}
+	}
+
+	return MovedSize;
+}
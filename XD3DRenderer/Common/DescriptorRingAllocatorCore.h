@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Fence.h"
+#include "RetirementQueue.h"
+
+// Device-independent bookkeeping of a ring of descriptors in a shader-visible heap.
+// Tables are carved contiguously from the head; a table that would cross the end of the heap starts
+// again at slot 0. Every EndFrame() tags the head with the frame's fence, the slots before it are
+// reused once that fence has completed, so several frames can be in flight.
+class XDescriptorRingAllocatorCore
+{
+public:
+	static constexpr uint32_t InvalidOffset = 0xFFFFFFFF;
+
+public:
+	XDescriptorRingAllocatorCore() {}
+
+	void Initialize(uint32_t InDescriptorCount, XFence* InFence);
+
+	// Returns the first slot of Count contiguous descriptors, or InvalidOffset if the slots are still used by the GPU.
+	// Callers are expected to wait for GetOldestPendingFenceValue() and try again.
+	uint32_t Allocate(uint32_t Count);
+
+	// Close the current frame, called once per frame before its fence is signaled
+	void EndFrame();
+
+	// Reclaim the slots of the frames whose fence has completed
+	void Retire();
+
+	bool HasPendingFrames() const { return !PendingFrames.IsEmpty(); }
+
+	uint64_t GetOldestPendingFenceValue() const { return PendingFrames.GetOldestFenceValue(); }
+
+	uint32_t GetDescriptorCount() const { return DescriptorCount; }
+
+	uint32_t GetUsedCount() const { return (uint32_t)(Head - Tail); }
+
+private:
+	uint32_t DescriptorCount = 0;
+
+	XFence* Fence = nullptr;
+
+	// Slots ever allocated and ever reclaimed, the ring position is modulo DescriptorCount
+	uint64_t Head = 0;
+
+	uint64_t Tail = 0;
+
+	// Head at the end of each frame still in flight
+	XRetirementQueue<uint64_t> PendingFrames;
+
+	uint64_t LastFrameHead = 0;
+};
+
+inline void XDescriptorRingAllocatorCore::Initialize(uint32_t InDescriptorCount, XFence* InFence)
+{
+	assert(InDescriptorCount > 0 && InFence != nullptr);
+
+	DescriptorCount = InDescriptorCount;
+	Fence = InFence;
+
+	Head = 0;
+	Tail = 0;
+	LastFrameHead = 0;
+}
+
+inline uint32_t XDescriptorRingAllocatorCore::Allocate(uint32_t Count)
+{
+	assert(Count > 0 && Count <= DescriptorCount);
+
+	const uint32_t Position = (uint32_t)(Head % DescriptorCount);
+
+	// Skip the end of the heap if the table does not fit before it, tables must be contiguous
+	const uint32_t Padding = Position + Count > DescriptorCount ? DescriptorCount - Position : 0;
+	const uint64_t Needed = (uint64_t)Padding + Count;
+
+	if (Head - Tail + Needed > DescriptorCount)
+	{
+		Retire();
+
+		if (Head - Tail + Needed > DescriptorCount)
+		{
+			return InvalidOffset;
+		}
+	}
+
+	Head += Needed;
+
+	return Padding > 0 ? 0 : Position;
+}
+
+inline void XDescriptorRingAllocatorCore::EndFrame()
+{
+	if (Head != LastFrameHead)
+	{
+		PendingFrames.Enqueue(Head, Fence->GetCurrentValue());
+		LastFrameHead = Head;
+	}
+
+	Retire();
+}
+
+inline void XDescriptorRingAllocatorCore::Retire()
+{
+	PendingFrames.Retire(Fence->GetCompletedValue(), [this](uint64_t FrameHead)
+	{
+		Tail = FrameHead;
+	});
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+// Device-independent map from a list of source descriptors to the table they were already copied to.
+// Handles are stored as integers so it does not depend on the D3D12 headers.
+// The cache only lives for one frame: the tables are recycled by the descriptor ring afterwards.
+class XDescriptorTableCache
+{
+public:
+	struct Stats
+	{
+		uint64_t HitCount = 0;
+
+		uint64_t MissCount = 0;
+
+		// Descriptors not copied thanks to the hits
+		uint64_t SavedDescriptorCount = 0;
+
+		float GetHitRate() const
+		{
+			return HitCount + MissCount == 0 ? 0.0f : (float)HitCount / (float)(HitCount + MissCount);
+		}
+	};
+
+public:
+	// Returns true and the table's GPU handle if SrcHandles were already copied this frame
+	bool Find(const std::vector<uint64_t>& SrcHandles, uint64_t& OutTableHandle);
+
+	void Add(const std::vector<uint64_t>& SrcHandles, uint64_t TableHandle);
+
+	// Forget every table, called at the end of the frame
+	void Reset();
+
+	// Forget every table but keep the frame stats, called when a source descriptor is freed or rewritten:
+	// its handle may be reused by another view while the cached tables still hold the old descriptor
+	void Invalidate();
+
+	const Stats& GetFrameStats() const { return FrameStats; }
+
+	const Stats& GetTotalStats() const { return TotalStats; }
+
+	size_t GetTableCount() const { return Tables.size(); }
+
+private:
+	struct KeyHasher
+	{
+		size_t operator()(const std::vector<uint64_t>& Key) const
+		{
+			// FNV-1a over the handles
+			uint64_t Hash = 14695981039346656037ull;
+			for (uint64_t Handle : Key)
+			{
+				Hash ^= Handle;
+				Hash *= 1099511628211ull;
+			}
+
+			return (size_t)Hash;
+		}
+	};
+
+	std::unordered_map<std::vector<uint64_t>, uint64_t, KeyHasher> Tables;
+
+	Stats FrameStats;
+
+	Stats TotalStats;
+};
+
+inline bool XDescriptorTableCache::Find(const std::vector<uint64_t>& SrcHandles, uint64_t& OutTableHandle)
+{
+	auto Iter = Tables.find(SrcHandles);
+	if (Iter == Tables.end())
+	{
+		FrameStats.MissCount++;
+		TotalStats.MissCount++;
+
+		return false;
+	}
+
+	FrameStats.HitCount++;
+	FrameStats.SavedDescriptorCount += SrcHandles.size();
+	TotalStats.HitCount++;
+	TotalStats.SavedDescriptorCount += SrcHandles.size();
+
+	OutTableHandle = Iter->second;
+
+	return true;
+}
+
+inline void XDescriptorTableCache::Add(const std::vector<uint64_t>& SrcHandles, uint64_t TableHandle)
+{
+	Tables[SrcHandles] = TableHandle;
+}
+
+inline void XDescriptorTableCache::Reset()
+{
+	Tables.clear();
+	FrameStats = Stats();
+}
+
+inline void XDescriptorTableCache::Invalidate()
+{
+	Tables.clear();
+}
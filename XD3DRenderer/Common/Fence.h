@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include <atomic>
+
+// Device-independent view of a GPU timeline fence.
+// Work recorded by the CPU is tagged with GetCurrentValue(), that value is signaled once the GPU has finished it.
+class XFence
+{
+public:
+	virtual ~XFence() {}
+
+	// Last value signaled by the GPU
+	virtual uint64_t GetCompletedValue() = 0;
+
+	// Value that will be signaled once the work recorded so far has completed
+	virtual uint64_t GetCurrentValue() const = 0;
+
+	// Querying the fence may call into the driver, most checks are answered by the last value seen
+	bool IsFenceComplete(uint64_t FenceValue)
+	{
+		if (FenceValue <= CachedCompletedValue.load(std::memory_order_relaxed))
+		{
+			return true;
+		}
+
+		return FenceValue <= UpdateCompletedValue();
+	}
+
+	// Query the fence and cache the completed value, thread safe
+	uint64_t UpdateCompletedValue()
+	{
+		const uint64_t CompletedValue = GetCompletedValue();
+
+		// The value only grows, a thread with an older one must not overwrite a newer one
+		uint64_t CachedValue = CachedCompletedValue.load(std::memory_order_relaxed);
+		while (CachedValue < CompletedValue && !CachedCompletedValue.compare_exchange_weak(CachedValue, CompletedValue, std::memory_order_relaxed))
+		{
+		}
+
+		return CompletedValue;
+	}
+
+	// Completed value seen by the last query, may be behind the GPU
+	uint64_t GetCachedCompletedValue() const { return CachedCompletedValue.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> CachedCompletedValue = { 0 };
+};
+
+// Software fence driven by hand, to exercise fence based logic without a device
+class XMockFence : public XFence
+{
+public:
+	virtual uint64_t GetCompletedValue() override { return CompletedValue; }
+
+	virtual uint64_t GetCurrentValue() const override { return CurrentValue; }
+
+	// Simulate the CPU submitting the current work, returns the value the GPU will signal
+	uint64_t Signal()
+	{
+		return CurrentValue++;
+	}
+
+	// Simulate the GPU finishing all work up to FenceValue
+	void Complete(uint64_t FenceValue)
+	{
+		assert(FenceValue < CurrentValue && FenceValue >= CompletedValue);
+
+		CompletedValue = FenceValue;
+	}
+
+	// Simulate the GPU catching up with everything submitted so far
+	void CompleteAll()
+	{
+		CompletedValue = CurrentValue - 1;
+	}
+
+private:
+	uint64_t CompletedValue = 0;
+
+	uint64_t CurrentValue = 1;
+};
@@ -0,0 +1,492 @@
+#pragma once
+
+#include "Fence.h"
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Fence value a CPU thread waits for
+struct XFenceWait
+{
+	XFence* Fence = nullptr;
+
+	uint64_t FenceValue = 0;
+};
+
+// OS side of the CPU waits: auto-reset events signaled once a fence reaches a value.
+// Win32 events for D3D12, a condition variable for XSoftwareFence.
+class XWaitEventBackend
+{
+public:
+	// Same value as INFINITE
+	static const uint32_t InfiniteTimeout = UINT32_MAX;
+
+	// Returned by WaitForEvents when the timeout elapsed
+	static const uint32_t WaitTimeout = UINT32_MAX;
+
+public:
+	virtual ~XWaitEventBackend() {}
+
+	virtual void* CreateWaitEvent() = 0;
+
+	virtual void DestroyWaitEvent(void* Event) = 0;
+
+	// Signal Event once Fence has reached FenceValue, cannot be cancelled
+	virtual void SetEventOnCompletion(XFence* Fence, uint64_t FenceValue, void* Event) = 0;
+
+	// Block until every event is signaled, or one of them if !bWaitAll, and reset the events waited for.
+	// Returns the index of the signaled event, 0 if bWaitAll, or WaitTimeout.
+	virtual uint32_t WaitForEvents(void* const* Events, uint32_t Count, bool bWaitAll, uint32_t TimeoutMs) = 0;
+};
+
+// Blocks the CPU on fences, with a small pool of events reused between waits.
+// Waits answered by the cached completed value do not touch an event, and waits on the same fence are merged:
+// one event for the highest value when waiting for all, for the lowest one when waiting for any.
+// Thread safe, the events are only locked while taken from or given back to the pool.
+class XFenceWaiter
+{
+public:
+	// Same value as MAXIMUM_WAIT_OBJECTS, different fences a single wait can block on
+	static const uint32_t MaxWaitCount = 64;
+
+	// Returned by WaitForAny when the timeout elapsed
+	static const uint32_t NoneCompleted = UINT32_MAX;
+
+	struct Stats
+	{
+		uint64_t WaitCount = 0;
+
+		// Waits that found their fences complete and did not block
+		uint64_t CompletedCount = 0;
+
+		// Waits on the same fence merged into another one
+		uint64_t MergedCount = 0;
+
+		uint64_t TimeoutCount = 0;
+
+		// Events in the pool, it only grows with the number of fences waited for at once
+		uint32_t EventCount = 0;
+	};
+
+public:
+	XFenceWaiter(XWaitEventBackend* InBackend) : Backend(InBackend) {}
+
+	~XFenceWaiter();
+
+	// Returns false if FenceValue was not reached within TimeoutMs
+	bool Wait(XFence* Fence, uint64_t FenceValue, uint32_t TimeoutMs = XWaitEventBackend::InfiniteTimeout)
+	{
+		const XFenceWait FenceWait = { Fence, FenceValue };
+
+		return WaitForAll(&FenceWait, 1, TimeoutMs);
+	}
+
+	// Returns false if some fence did not reach its value within TimeoutMs
+	bool WaitForAll(const XFenceWait* Waits, uint32_t Count, uint32_t TimeoutMs = XWaitEventBackend::InfiniteTimeout);
+
+	// Returns the index of a completed wait, or NoneCompleted if none completed within TimeoutMs
+	uint32_t WaitForAny(const XFenceWait* Waits, uint32_t Count, uint32_t TimeoutMs = XWaitEventBackend::InfiniteTimeout);
+
+	Stats GetStats();
+
+private:
+	// Merge the waits that are not complete yet per fence, keeping the index of the original wait.
+	// Returns the number of merged waits, or NoneCompleted with CompletedIndex set if !bWaitAll and a wait is complete.
+	uint32_t MergeWaits(const XFenceWait* Waits, uint32_t Count, bool bWaitAll, XFenceWait* Merged, uint32_t* MergedIndices, uint32_t& CompletedIndex);
+
+	// Take Count armed events from the pool, creating them if needed
+	void AcquireEvents(const XFenceWait* Merged, uint32_t Count, void** Events);
+
+	// Back to the pool. Events still armed wait in PendingEvents until the fence signals them.
+	void ReleaseEvents(void* const* Events, uint32_t Count, bool bSignaled);
+
+	void CountWait(bool bBlocked, bool bTimeout);
+
+private:
+	XWaitEventBackend* Backend = nullptr;
+
+	std::mutex Mutex;
+
+	std::vector<void*> FreeEvents;
+
+	// Armed by a wait that returned before them, reused once they are signaled
+	std::vector<void*> PendingEvents;
+
+	Stats WaiterStats;
+};
+
+inline XFenceWaiter::~XFenceWaiter()
+{
+	for (void* Event : FreeEvents)
+	{
+		Backend->DestroyWaitEvent(Event);
+	}
+
+	for (void* Event : PendingEvents)
+	{
+		Backend->DestroyWaitEvent(Event);
+	}
+}
+
+inline uint32_t XFenceWaiter::MergeWaits(const XFenceWait* Waits, uint32_t Count, bool bWaitAll, XFenceWait* Merged, uint32_t* MergedIndices, uint32_t& CompletedIndex)
+{
+	uint32_t MergedCount = 0;
+	uint64_t MergedWaitCount = 0;
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const XFenceWait& FenceWait = Waits[i];
+		assert(FenceWait.Fence != nullptr);
+
+		if (FenceWait.Fence->IsFenceComplete(FenceWait.FenceValue))
+		{
+			if (!bWaitAll)
+			{
+				CompletedIndex = i;
+
+				return NoneCompleted;
+			}
+
+			continue;
+		}
+
+		uint32_t j = 0;
+		for (; j < MergedCount && Merged[j].Fence != FenceWait.Fence; j++)
+		{
+		}
+
+		if (j == MergedCount)
+		{
+			assert(MergedCount < MaxWaitCount);
+
+			Merged[MergedCount] = FenceWait;
+			MergedIndices[MergedCount] = i;
+			MergedCount++;
+		}
+		else
+		{
+			// Values of a fence are reached in order
+			const bool bReplace = bWaitAll ? FenceWait.FenceValue > Merged[j].FenceValue : FenceWait.FenceValue < Merged[j].FenceValue;
+			if (bReplace)
+			{
+				Merged[j].FenceValue = FenceWait.FenceValue;
+				MergedIndices[j] = i;
+			}
+
+			MergedWaitCount++;
+		}
+	}
+
+	if (MergedWaitCount > 0)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		WaiterStats.MergedCount += MergedWaitCount;
+	}
+
+	return MergedCount;
+}
+
+inline bool XFenceWaiter::WaitForAll(const XFenceWait* Waits, uint32_t Count, uint32_t TimeoutMs)
+{
+	XFenceWait Merged[MaxWaitCount];
+	uint32_t MergedIndices[MaxWaitCount];
+	uint32_t CompletedIndex = 0;
+	const uint32_t MergedCount = MergeWaits(Waits, Count, true, Merged, MergedIndices, CompletedIndex);
+
+	if (MergedCount == 0)
+	{
+		CountWait(false, false);
+
+		return true;
+	}
+
+	void* Events[MaxWaitCount];
+	AcquireEvents(Merged, MergedCount, Events);
+
+	// Every event is reset when they are all signaled, none on timeout
+	const bool bTimeout = Backend->WaitForEvents(Events, MergedCount, true, TimeoutMs) == XWaitEventBackend::WaitTimeout;
+
+	ReleaseEvents(Events, MergedCount, !bTimeout);
+	CountWait(true, bTimeout);
+
+	return !bTimeout;
+}
+
+inline uint32_t XFenceWaiter::WaitForAny(const XFenceWait* Waits, uint32_t Count, uint32_t TimeoutMs)
+{
+	assert(Count > 0);
+
+	XFenceWait Merged[MaxWaitCount];
+	uint32_t MergedIndices[MaxWaitCount];
+	uint32_t CompletedIndex = 0;
+	const uint32_t MergedCount = MergeWaits(Waits, Count, false, Merged, MergedIndices, CompletedIndex);
+
+	if (MergedCount == NoneCompleted)
+	{
+		CountWait(false, false);
+
+		return CompletedIndex;
+	}
+
+	void* Events[MaxWaitCount];
+	AcquireEvents(Merged, MergedCount, Events);
+
+	const uint32_t SignaledIndex = Backend->WaitForEvents(Events, MergedCount, false, TimeoutMs);
+	const bool bTimeout = SignaledIndex == XWaitEventBackend::WaitTimeout;
+
+	CountWait(true, bTimeout);
+
+	if (bTimeout)
+	{
+		ReleaseEvents(Events, MergedCount, false);
+
+		return NoneCompleted;
+	}
+
+	// Only the signaled event was reset, the others are still armed
+	std::swap(Events[0], Events[SignaledIndex]);
+	ReleaseEvents(Events, 1, true);
+	ReleaseEvents(Events + 1, MergedCount - 1, false);
+
+	return MergedIndices[SignaledIndex];
+}
+
+inline void XFenceWaiter::AcquireEvents(const XFenceWait* Merged, uint32_t Count, void** Events)
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		// Recycle the pending events signaled since, checking one resets it
+		if (FreeEvents.size() < Count)
+		{
+			for (size_t i = 0; i < PendingEvents.size();)
+			{
+				if (Backend->WaitForEvents(&PendingEvents[i], 1, true, 0) != XWaitEventBackend::WaitTimeout)
+				{
+					FreeEvents.push_back(PendingEvents[i]);
+					PendingEvents[i] = PendingEvents.back();
+					PendingEvents.pop_back();
+				}
+				else
+				{
+					i++;
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			if (FreeEvents.empty())
+			{
+				FreeEvents.push_back(Backend->CreateWaitEvent());
+				WaiterStats.EventCount++;
+			}
+
+			Events[i] = FreeEvents.back();
+			FreeEvents.pop_back();
+		}
+	}
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		Backend->SetEventOnCompletion(Merged[i].Fence, Merged[i].FenceValue, Events[i]);
+	}
+}
+
+inline void XFenceWaiter::ReleaseEvents(void* const* Events, uint32_t Count, bool bSignaled)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	std::vector<void*>& Pool = bSignaled ? FreeEvents : PendingEvents;
+	Pool.insert(Pool.end(), Events, Events + Count);
+}
+
+inline void XFenceWaiter::CountWait(bool bBlocked, bool bTimeout)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	WaiterStats.WaitCount++;
+	WaiterStats.CompletedCount += bBlocked ? 0 : 1;
+	WaiterStats.TimeoutCount += bTimeout ? 1 : 0;
+}
+
+inline XFenceWaiter::Stats XFenceWaiter::GetStats()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	return WaiterStats;
+}
+
+class XSoftwareFence;
+
+// Events of XSoftwareFence, to exercise XFenceWaiter without a device
+class XSoftwareWaitEventBackend : public XWaitEventBackend
+{
+public:
+	virtual void* CreateWaitEvent() override { return new XSoftwareEvent(); }
+
+	virtual void DestroyWaitEvent(void* Event) override;
+
+	virtual void SetEventOnCompletion(XFence* Fence, uint64_t FenceValue, void* Event) override;
+
+	virtual uint32_t WaitForEvents(void* const* Events, uint32_t Count, bool bWaitAll, uint32_t TimeoutMs) override;
+
+private:
+	friend class XSoftwareFence;
+
+	struct XSoftwareEvent
+	{
+		bool bSignaled = false;
+	};
+
+	struct ArmedEvent
+	{
+		XFence* Fence;
+
+		uint64_t FenceValue;
+
+		XSoftwareEvent* Event;
+	};
+
+	// Called by the fence once it has reached FenceValue
+	void OnFenceCompleted(XFence* Fence, uint64_t FenceValue);
+
+private:
+	std::mutex Mutex;
+
+	std::condition_variable Condition;
+
+	std::vector<ArmedEvent> ArmedEvents;
+};
+
+// Software fence completed by hand from any thread, the GPU of XSoftwareWaitEventBackend
+class XSoftwareFence : public XFence
+{
+public:
+	XSoftwareFence(XSoftwareWaitEventBackend* InBackend) : Backend(InBackend) {}
+
+	virtual uint64_t GetCompletedValue() override { return CompletedValue.load(); }
+
+	virtual uint64_t GetCurrentValue() const override { return CurrentValue.load(); }
+
+	// Simulate the CPU submitting the current work, returns the value the GPU will signal
+	uint64_t Signal() { return CurrentValue++; }
+
+	// Simulate the GPU finishing all work up to FenceValue, signals the events waiting for it
+	void Complete(uint64_t FenceValue)
+	{
+		assert(FenceValue < CurrentValue.load() && FenceValue >= CompletedValue.load());
+
+		CompletedValue.store(FenceValue);
+		Backend->OnFenceCompleted(this, FenceValue);
+	}
+
+private:
+	XSoftwareWaitEventBackend* Backend = nullptr;
+
+	std::atomic<uint64_t> CompletedValue = { 0 };
+
+	std::atomic<uint64_t> CurrentValue = { 1 };
+};
+
+inline void XSoftwareWaitEventBackend::DestroyWaitEvent(void* Event)
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		for (size_t i = 0; i < ArmedEvents.size();)
+		{
+			if (ArmedEvents[i].Event == Event)
+			{
+				ArmedEvents[i] = ArmedEvents.back();
+				ArmedEvents.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	delete (XSoftwareEvent*)Event;
+}
+
+inline void XSoftwareWaitEventBackend::SetEventOnCompletion(XFence* Fence, uint64_t FenceValue, void* Event)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	// Checked under the lock, a Complete() after this finds the event armed
+	if (Fence->GetCompletedValue() >= FenceValue)
+	{
+		((XSoftwareEvent*)Event)->bSignaled = true;
+		Condition.notify_all();
+	}
+	else
+	{
+		ArmedEvents.push_back({ Fence, FenceValue, (XSoftwareEvent*)Event });
+	}
+}
+
+inline void XSoftwareWaitEventBackend::OnFenceCompleted(XFence* Fence, uint64_t FenceValue)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	for (size_t i = 0; i < ArmedEvents.size();)
+	{
+		if (ArmedEvents[i].Fence == Fence && ArmedEvents[i].FenceValue <= FenceValue)
+		{
+			ArmedEvents[i].Event->bSignaled = true;
+			ArmedEvents[i] = ArmedEvents.back();
+			ArmedEvents.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	Condition.notify_all();
+}
+
+inline uint32_t XSoftwareWaitEventBackend::WaitForEvents(void* const* Events, uint32_t Count, bool bWaitAll, uint32_t TimeoutMs)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+
+	// First signaled event, 0 once they are all signaled if bWaitAll
+	uint32_t SignaledIndex = 0;
+	auto IsSignaled = [&]()
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			const bool bSignaled = ((XSoftwareEvent*)Events[i])->bSignaled;
+			if (bSignaled != bWaitAll)
+			{
+				SignaledIndex = i;
+
+				return !bWaitAll;
+			}
+		}
+
+		SignaledIndex = 0;
+
+		return bWaitAll;
+	};
+
+	if (TimeoutMs == InfiniteTimeout)
+	{
+		Condition.wait(Lock, IsSignaled);
+	}
+	else if (!Condition.wait_for(Lock, std::chrono::milliseconds(TimeoutMs), IsSignaled))
+	{
+		return WaitTimeout;
+	}
+
+	// Auto-reset, like the Win32 events
+	for (uint32_t i = bWaitAll ? 0 : SignaledIndex; i < (bWaitAll ? Count : SignaledIndex + 1); i++)
+	{
+		((XSoftwareEvent*)Events[i])->bSignaled = false;
+	}
+
+	return SignaledIndex;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CommandQueue.h"
+#include <vector>
+
+// Device-independent pacing of a ring of frame contexts.
+// Each context (command allocator, upload segment...) is reused every FrameCount frames;
+// BeginFrame() only blocks when the CPU has lapped the GPU and the context is still in flight.
+class XFrameRing
+{
+public:
+	XFrameRing() {}
+
+	void Initialize(uint32_t InFrameCount, XCommandQueue* InQueue);
+
+	// Wait for the GPU to be done with the next context, returns its index
+	uint32_t BeginFrame();
+
+	// Signal the queue after the frame's work, the context is reused once the signal has completed
+	void EndFrame();
+
+	// Wait for every frame in flight, e.g. before resizing the swap chain
+	void WaitForIdle();
+
+	uint32_t GetFrameIndex() const { return FrameIndex; }
+
+	bool IsInFrame() const { return bInFrame; }
+
+	uint32_t GetFrameCount() const { return (uint32_t)FrameFenceValues.size(); }
+
+	// Fence value signaled at the end of the last frame that used the context, 0 if never used
+	uint64_t GetFrameFenceValue(uint32_t Index) const { return FrameFenceValues[Index]; }
+
+	uint64_t GetCompletedFrameCount() const { return FrameCounter; }
+
+	// Frames whose BeginFrame() had to wait for the GPU
+	uint64_t GetStallCount() const { return StallCount; }
+
+private:
+	XCommandQueue* Queue = nullptr;
+
+	std::vector<uint64_t> FrameFenceValues;
+
+	uint32_t FrameIndex = 0;
+
+	uint64_t FrameCounter = 0;
+
+	uint64_t StallCount = 0;
+
+	bool bInFrame = false;
+};
+
+inline void XFrameRing::Initialize(uint32_t InFrameCount, XCommandQueue* InQueue)
+{
+	assert(InFrameCount > 0 && InQueue != nullptr);
+
+	Queue = InQueue;
+	FrameFenceValues.assign(InFrameCount, 0);
+
+	FrameIndex = 0;
+	FrameCounter = 0;
+	StallCount = 0;
+	bInFrame = false;
+}
+
+inline uint32_t XFrameRing::BeginFrame()
+{
+	assert(!bInFrame);
+
+	FrameIndex = (uint32_t)(FrameCounter % FrameFenceValues.size());
+
+	const uint64_t FenceValue = FrameFenceValues[FrameIndex];
+	if (FenceValue != 0 && !Queue->GetFence()->IsFenceComplete(FenceValue))
+	{
+		StallCount++;
+		Queue->WaitForFence(FenceValue);
+	}
+
+	bInFrame = true;
+
+	return FrameIndex;
+}
+
+inline void XFrameRing::EndFrame()
+{
+	assert(bInFrame);
+
+	FrameFenceValues[FrameIndex] = Queue->Signal();
+	FrameCounter++;
+
+	bInFrame = false;
+}
+
+inline void XFrameRing::WaitForIdle()
+{
+	for (uint64_t FenceValue : FrameFenceValues)
+	{
+		if (FenceValue != 0)
+		{
+			Queue->WaitForFence(FenceValue);
+		}
+	}
+}
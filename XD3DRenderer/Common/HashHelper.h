@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+// 64-bit hashes that are stable between runs, usable as keys of the caches saved to disk
+class HashHelper
+{
+public:
+	// MurmurHash64A of Size bytes
+	static uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 0)
+	{
+		const uint64_t M = 0xc6a4a7935bd1e995ull;
+		const int R = 47;
+
+		uint64_t Hash = Seed ^ (Size * M);
+
+		const uint8_t* Bytes = (const uint8_t*)Data;
+		const uint8_t* End = Bytes + (Size & ~(size_t)7);
+
+		for (; Bytes != End; Bytes += 8)
+		{
+			uint64_t Block;
+			memcpy(&Block, Bytes, 8);
+
+			Block *= M;
+			Block ^= Block >> R;
+			Block *= M;
+
+			Hash ^= Block;
+			Hash *= M;
+		}
+
+		const size_t Remaining = Size & 7;
+		if (Remaining > 0)
+		{
+			uint64_t Tail = 0;
+			memcpy(&Tail, Bytes, Remaining);
+
+			Hash ^= Tail;
+			Hash *= M;
+		}
+
+		Hash ^= Hash >> R;
+		Hash *= M;
+		Hash ^= Hash >> R;
+
+		return Hash;
+	}
+
+	static uint64_t HashString(const std::string& Str, uint64_t Seed = 0)
+	{
+		return HashBytes(Str.data(), Str.size(), Seed);
+	}
+
+	// Order dependent: Combine(Combine(S, A), B) differs from Combine(Combine(S, B), A)
+	static uint64_t Combine(uint64_t Seed, uint64_t Value)
+	{
+		return Mix(Seed * 0x9e3779b97f4a7c15ull + Value);
+	}
+
+	// SplitMix64 finalizer, every input bit flips about half of the output bits
+	static uint64_t Mix(uint64_t Value)
+	{
+		Value ^= Value >> 30;
+		Value *= 0xbf58476d1ce4e5b9ull;
+		Value ^= Value >> 27;
+		Value *= 0x94d049bb133111ebull;
+		Value ^= Value >> 31;
+
+		return Value;
+	}
+};
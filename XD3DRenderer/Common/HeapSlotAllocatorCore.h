@@ -0,0 +1,388 @@
+#pragma once
+
+#include "BitHelper.h"
+#include <vector>
+
+// Device-independent bookkeeping of descriptor slots spread over several fixed size heaps.
+// Every heap keeps an occupancy bitmap with a summary word per 64 bitmap words, and the heaps with
+// free slots are chained in a list, so allocation and deallocation are a few bit scans.
+// Contiguous ranges are placed best-fit over the free runs of the bitmaps, they are meant for view creation, not per draw work.
+// The heaps themselves (descriptor heaps...) are owned by the caller.
+class XHeapSlotAllocatorCore
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		uint32_t HeapIndex = InvalidIndex;
+
+		uint32_t SlotIndex = 0;
+	};
+
+public:
+	XHeapSlotAllocatorCore() {}
+
+	explicit XHeapSlotAllocatorCore(uint32_t InSlotsPerHeap)
+	{
+		Initialize(InSlotsPerHeap);
+	}
+
+	void Initialize(uint32_t InSlotsPerHeap);
+
+	// Register a new heap with all of its slots free, returns its index
+	uint32_t AddHeap();
+
+	// Returns false if every heap is full, add one then
+	bool Allocate(Slot& OutSlot);
+
+	void Deallocate(uint32_t HeapIndex, uint32_t SlotIndex);
+
+	// Count consecutive slots of one heap, in the smallest free run that holds them.
+	// Returns false if no heap has such a run, add one then. Count must not exceed the slots per heap.
+	bool AllocateRange(uint32_t Count, Slot& OutFirstSlot);
+
+	void DeallocateRange(uint32_t HeapIndex, uint32_t FirstSlotIndex, uint32_t Count);
+
+	bool IsSlotFree(uint32_t HeapIndex, uint32_t SlotIndex) const
+	{
+		return (Heaps[HeapIndex].FreeMasks[SlotIndex >> 6] >> (SlotIndex & 63)) & 1;
+	}
+
+	uint32_t GetSlotsPerHeap() const { return SlotsPerHeap; }
+
+	uint32_t GetHeapCount() const { return (uint32_t)Heaps.size(); }
+
+	uint32_t GetFreeSlotCount(uint32_t HeapIndex) const { return Heaps[HeapIndex].FreeSlotCount; }
+
+	uint32_t GetAllocatedSlotCount() const { return AllocatedSlotCount; }
+
+private:
+	struct Heap
+	{
+		// Bit N of word W is set if slot W * 64 + N is free
+		std::vector<uint64_t> FreeMasks;
+
+		// Bit N of word W is set if FreeMasks[W * 64 + N] is not zero
+		std::vector<uint64_t> NonEmptyMasks;
+
+		uint32_t FreeSlotCount = 0;
+
+		// Links of the list of heaps with at least one free slot
+		uint32_t PrevAvailable = InvalidIndex;
+
+		uint32_t NextAvailable = InvalidIndex;
+	};
+
+	// First run of free slots at or after StartSlotIndex, returns false if there is none
+	bool FindFreeRun(const Heap& InHeap, uint32_t StartSlotIndex, uint32_t& OutRunStart, uint32_t& OutRunLength) const;
+
+	// Mark Count slots from FirstSlotIndex as free or used, they must all be in the other state
+	void SetSlotRange(uint32_t HeapIndex, uint32_t FirstSlotIndex, uint32_t Count, bool bFree);
+
+	void PushAvailableHeap(uint32_t HeapIndex);
+
+	void RemoveAvailableHeap(uint32_t HeapIndex);
+
+private:
+	uint32_t SlotsPerHeap = 0;
+
+	std::vector<Heap> Heaps;
+
+	uint32_t AvailableHead = InvalidIndex;
+
+	uint32_t AllocatedSlotCount = 0;
+};
+
+inline void XHeapSlotAllocatorCore::Initialize(uint32_t InSlotsPerHeap)
+{
+	assert(InSlotsPerHeap > 0);
+
+	SlotsPerHeap = InSlotsPerHeap;
+	Heaps.clear();
+	AvailableHead = InvalidIndex;
+	AllocatedSlotCount = 0;
+}
+
+inline uint32_t XHeapSlotAllocatorCore::AddHeap()
+{
+	const uint32_t HeapIndex = (uint32_t)Heaps.size();
+	Heaps.emplace_back();
+
+	Heap& NewHeap = Heaps.back();
+
+	// All slots free, the bits past SlotsPerHeap stay cleared
+	const uint32_t WordCount = (SlotsPerHeap + 63) / 64;
+	NewHeap.FreeMasks.assign(WordCount, ~0ull);
+	if (SlotsPerHeap % 64 != 0)
+	{
+		NewHeap.FreeMasks.back() = (1ull << (SlotsPerHeap % 64)) - 1;
+	}
+
+	NewHeap.NonEmptyMasks.assign((WordCount + 63) / 64, ~0ull);
+	if (WordCount % 64 != 0)
+	{
+		NewHeap.NonEmptyMasks.back() = (1ull << (WordCount % 64)) - 1;
+	}
+
+	NewHeap.FreeSlotCount = SlotsPerHeap;
+
+	PushAvailableHeap(HeapIndex);
+
+	return HeapIndex;
+}
+
+inline bool XHeapSlotAllocatorCore::Allocate(Slot& OutSlot)
+{
+	const uint32_t HeapIndex = AvailableHead;
+	if (HeapIndex == InvalidIndex)
+	{
+		return false;
+	}
+
+	Heap& Current = Heaps[HeapIndex];
+
+	// First summary word with a bit set, heaps of up to 4096 slots only have one
+	uint32_t SummaryIndex = 0;
+	while (Current.NonEmptyMasks[SummaryIndex] == 0)
+	{
+		SummaryIndex++;
+	}
+
+	const uint32_t WordIndex = SummaryIndex * 64 + BitHelper::FindLowestSetBit(Current.NonEmptyMasks[SummaryIndex]);
+	uint64_t& FreeMask = Current.FreeMasks[WordIndex];
+	const uint32_t BitIndex = BitHelper::FindLowestSetBit(FreeMask);
+
+	FreeMask &= ~(1ull << BitIndex);
+	if (FreeMask == 0)
+	{
+		Current.NonEmptyMasks[SummaryIndex] &= ~(1ull << (WordIndex & 63));
+	}
+
+	Current.FreeSlotCount--;
+	if (Current.FreeSlotCount == 0)
+	{
+		RemoveAvailableHeap(HeapIndex);
+	}
+
+	AllocatedSlotCount++;
+
+	OutSlot.HeapIndex = HeapIndex;
+	OutSlot.SlotIndex = WordIndex * 64 + BitIndex;
+
+	return true;
+}
+
+inline void XHeapSlotAllocatorCore::Deallocate(uint32_t HeapIndex, uint32_t SlotIndex)
+{
+	assert(HeapIndex < Heaps.size() && SlotIndex < SlotsPerHeap && !IsSlotFree(HeapIndex, SlotIndex));
+
+	Heap& Current = Heaps[HeapIndex];
+
+	const uint32_t WordIndex = SlotIndex >> 6;
+	Current.FreeMasks[WordIndex] |= (1ull << (SlotIndex & 63));
+	Current.NonEmptyMasks[WordIndex >> 6] |= (1ull << (WordIndex & 63));
+
+	if (Current.FreeSlotCount == 0)
+	{
+		PushAvailableHeap(HeapIndex);
+	}
+	Current.FreeSlotCount++;
+
+	AllocatedSlotCount--;
+}
+
+inline bool XHeapSlotAllocatorCore::AllocateRange(uint32_t Count, Slot& OutFirstSlot)
+{
+	assert(Count > 0 && Count <= SlotsPerHeap);
+
+	if (Count == 1)
+	{
+		return Allocate(OutFirstSlot);
+	}
+
+	uint32_t BestHeap = InvalidIndex;
+	uint32_t BestStart = 0;
+	uint32_t BestLength = 0;
+
+	for (uint32_t HeapIndex = AvailableHead; HeapIndex != InvalidIndex; HeapIndex = Heaps[HeapIndex].NextAvailable)
+	{
+		const Heap& Current = Heaps[HeapIndex];
+		if (Current.FreeSlotCount < Count)
+		{
+			continue;
+		}
+
+		uint32_t RunStart = 0;
+		uint32_t RunLength = 0;
+		for (uint32_t SlotIndex = 0; FindFreeRun(Current, SlotIndex, RunStart, RunLength); SlotIndex = RunStart + RunLength)
+		{
+			if (RunLength >= Count && (BestHeap == InvalidIndex || RunLength < BestLength))
+			{
+				BestHeap = HeapIndex;
+				BestStart = RunStart;
+				BestLength = RunLength;
+
+				if (RunLength == Count)
+				{
+					break;
+				}
+			}
+		}
+
+		if (BestHeap != InvalidIndex && BestLength == Count)
+		{
+			break;
+		}
+	}
+
+	if (BestHeap == InvalidIndex)
+	{
+		return false;
+	}
+
+	SetSlotRange(BestHeap, BestStart, Count, false);
+	AllocatedSlotCount += Count;
+
+	OutFirstSlot.HeapIndex = BestHeap;
+	OutFirstSlot.SlotIndex = BestStart;
+
+	return true;
+}
+
+inline void XHeapSlotAllocatorCore::DeallocateRange(uint32_t HeapIndex, uint32_t FirstSlotIndex, uint32_t Count)
+{
+	assert(HeapIndex < Heaps.size() && Count > 0 && FirstSlotIndex + Count <= SlotsPerHeap);
+
+	SetSlotRange(HeapIndex, FirstSlotIndex, Count, true);
+	AllocatedSlotCount -= Count;
+}
+
+inline bool XHeapSlotAllocatorCore::FindFreeRun(const Heap& InHeap, uint32_t StartSlotIndex, uint32_t& OutRunStart, uint32_t& OutRunLength) const
+{
+	const uint32_t WordCount = (uint32_t)InHeap.FreeMasks.size();
+
+	uint32_t WordIndex = StartSlotIndex >> 6;
+	if (WordIndex >= WordCount)
+	{
+		return false;
+	}
+
+	// First free slot
+	uint64_t Mask = InHeap.FreeMasks[WordIndex] & (~0ull << (StartSlotIndex & 63));
+	while (Mask == 0)
+	{
+		if (++WordIndex == WordCount)
+		{
+			return false;
+		}
+
+		Mask = InHeap.FreeMasks[WordIndex];
+	}
+
+	const uint32_t RunStart = WordIndex * 64 + BitHelper::FindLowestSetBit(Mask);
+
+	// First used slot after it, the bits past SlotsPerHeap read as used
+	uint32_t RunEnd = SlotsPerHeap;
+	Mask = ~InHeap.FreeMasks[WordIndex] & (~0ull << (RunStart & 63));
+	while (Mask == 0 && ++WordIndex < WordCount)
+	{
+		Mask = ~InHeap.FreeMasks[WordIndex];
+	}
+
+	if (Mask != 0)
+	{
+		const uint32_t UsedSlot = WordIndex * 64 + BitHelper::FindLowestSetBit(Mask);
+		RunEnd = UsedSlot < SlotsPerHeap ? UsedSlot : SlotsPerHeap;
+	}
+
+	OutRunStart = RunStart;
+	OutRunLength = RunEnd - RunStart;
+
+	return true;
+}
+
+inline void XHeapSlotAllocatorCore::SetSlotRange(uint32_t HeapIndex, uint32_t FirstSlotIndex, uint32_t Count, bool bFree)
+{
+	Heap& Current = Heaps[HeapIndex];
+
+	if (bFree && Current.FreeSlotCount == 0)
+	{
+		PushAvailableHeap(HeapIndex);
+	}
+
+	const uint32_t EndSlotIndex = FirstSlotIndex + Count;
+	for (uint32_t SlotIndex = FirstSlotIndex; SlotIndex < EndSlotIndex;)
+	{
+		const uint32_t WordIndex = SlotIndex >> 6;
+		const uint32_t BitCount = (EndSlotIndex - SlotIndex) < (64 - (SlotIndex & 63)) ? (EndSlotIndex - SlotIndex) : (64 - (SlotIndex & 63));
+		const uint64_t Bits = (BitCount == 64 ? ~0ull : ((1ull << BitCount) - 1)) << (SlotIndex & 63);
+
+		uint64_t& FreeMask = Current.FreeMasks[WordIndex];
+		if (bFree)
+		{
+			assert((FreeMask & Bits) == 0);
+			FreeMask |= Bits;
+			Current.NonEmptyMasks[WordIndex >> 6] |= (1ull << (WordIndex & 63));
+		}
+		else
+		{
+			assert((FreeMask & Bits) == Bits);
+			FreeMask &= ~Bits;
+			if (FreeMask == 0)
+			{
+				Current.NonEmptyMasks[WordIndex >> 6] &= ~(1ull << (WordIndex & 63));
+			}
+		}
+
+		SlotIndex += BitCount;
+	}
+
+	if (bFree)
+	{
+		Current.FreeSlotCount += Count;
+	}
+	else
+	{
+		Current.FreeSlotCount -= Count;
+		if (Current.FreeSlotCount == 0)
+		{
+			RemoveAvailableHeap(HeapIndex);
+		}
+	}
+}
+
+inline void XHeapSlotAllocatorCore::PushAvailableHeap(uint32_t HeapIndex)
+{
+	Heap& Current = Heaps[HeapIndex];
+
+	Current.PrevAvailable = InvalidIndex;
+	Current.NextAvailable = AvailableHead;
+	if (AvailableHead != InvalidIndex)
+	{
+		Heaps[AvailableHead].PrevAvailable = HeapIndex;
+	}
+	AvailableHead = HeapIndex;
+}
+
+inline void XHeapSlotAllocatorCore::RemoveAvailableHeap(uint32_t HeapIndex)
+{
+	Heap& Current = Heaps[HeapIndex];
+
+	if (Current.PrevAvailable != InvalidIndex)
+	{
+		Heaps[Current.PrevAvailable].NextAvailable = Current.NextAvailable;
+	}
+	else
+	{
+		AvailableHead = Current.NextAvailable;
+	}
+
+	if (Current.NextAvailable != InvalidIndex)
+	{
+		Heaps[Current.NextAvailable].PrevAvailable = Current.PrevAvailable;
+	}
+
+	Current.PrevAvailable = InvalidIndex;
+	Current.NextAvailable = InvalidIndex;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Fence.h"
+#include <vector>
+
+// Device-independent bookkeeping of a ring of per-frame segments.
+// Each frame bumps a pointer through its own segment; a segment is reused once the fence
+// of the last frame that allocated from it has completed, so nothing is freed individually.
+class XLinearRingAllocatorCore
+{
+public:
+	static constexpr uint64_t InvalidOffset = 0xFFFFFFFFFFFFFFFFull;
+
+public:
+	XLinearRingAllocatorCore() {}
+
+	void Initialize(uint64_t InSegmentSize, uint32_t InSegmentCount, XFence* InFence);
+
+	// Returns the offset from the start of the ring, or InvalidOffset if the current segment
+	// is full or still used by the GPU. Callers are expected to fall back to a regular allocation.
+	uint64_t Allocate(uint64_t Size, uint32_t Alignment);
+
+	// Move to the next segment, called once per frame
+	void EndFrame();
+
+	uint64_t GetRingSize() const { return SegmentSize * Segments.size(); }
+
+	uint64_t GetSegmentSize() const { return SegmentSize; }
+
+	uint64_t GetCurrentSegmentUsedSize() const { return CurrentOffset; }
+
+private:
+	struct Segment
+	{
+		// Fence of the last frame that allocated from this segment
+		uint64_t FenceValue = 0;
+	};
+
+	uint64_t SegmentSize = 0;
+
+	std::vector<Segment> Segments;
+
+	XFence* Fence = nullptr;
+
+	uint32_t CurrentSegment = 0;
+
+	uint64_t CurrentOffset = 0;
+
+	bool bCurrentSegmentReady = false;
+};
+
+inline void XLinearRingAllocatorCore::Initialize(uint64_t InSegmentSize, uint32_t InSegmentCount, XFence* InFence)
+{
+	assert(InSegmentCount > 0 && InFence != nullptr);
+
+	SegmentSize = InSegmentSize;
+	Segments.assign(InSegmentCount, Segment());
+	Fence = InFence;
+
+	CurrentSegment = 0;
+	CurrentOffset = 0;
+	bCurrentSegmentReady = true;
+}
+
+inline uint64_t XLinearRingAllocatorCore::Allocate(uint64_t Size, uint32_t Alignment)
+{
+	Segment& Current = Segments[CurrentSegment];
+
+	if (!bCurrentSegmentReady)
+	{
+		// The segment was last used Segments.size() frames ago, the GPU may still be reading it
+		if (!Fence->IsFenceComplete(Current.FenceValue))
+		{
+			return InvalidOffset;
+		}
+
+		bCurrentSegmentReady = true;
+	}
+
+	// Align the offset from the ring start, segments are not necessarily a multiple of Alignment
+	const uint64_t SegmentBase = CurrentSegment * SegmentSize;
+	uint64_t AlignedOffset = SegmentBase + CurrentOffset;
+	if (Alignment != 0 && AlignedOffset % Alignment != 0)
+	{
+		AlignedOffset = ((AlignedOffset + Alignment - 1) / Alignment) * Alignment;
+	}
+	AlignedOffset -= SegmentBase;
+
+	if (Size > SegmentSize || AlignedOffset > SegmentSize - Size)
+	{
+		return InvalidOffset;
+	}
+
+	CurrentOffset = AlignedOffset + Size;
+	Current.FenceValue = Fence->GetCurrentValue();
+
+	return SegmentBase + AlignedOffset;
+}
+
+inline void XLinearRingAllocatorCore::EndFrame()
+{
+	CurrentSegment = (CurrentSegment + 1) % (uint32_t)Segments.size();
+	CurrentOffset = 0;
+	bCurrentSegmentReady = false;
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "HashHelper.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+// Builds the key of a pipeline state from its description, field by field.
+// Pointers must not be added, only what they point to: the key has to be the same in the next run.
+class XPipelineStateHasher
+{
+public:
+	void AddBytes(const void* Data, size_t Size)
+	{
+		Hash = HashHelper::Combine(Hash, HashHelper::HashBytes(Data, Size));
+	}
+
+	// Structures without padding only, e.g. D3D12_RASTERIZER_DESC
+	template<typename ValueType>
+	void AddValue(const ValueType& Value)
+	{
+		AddBytes(&Value, sizeof(Value));
+	}
+
+	void AddString(const char* Str)
+	{
+		AddBytes(Str, Str ? strlen(Str) : 0);
+	}
+
+	// A hash computed once, e.g. of the shader bytecode
+	void AddHash(uint64_t Value)
+	{
+		Hash = HashHelper::Combine(Hash, Value);
+	}
+
+	uint64_t GetHash() const { return Hash; }
+
+private:
+	uint64_t Hash = 0;
+};
+
+// Compiled pipeline blobs kept between runs, by key.
+// The blobs only load on the device and driver that compiled them: a file saved with another DeviceKey is dropped.
+class XPipelineCacheFile
+{
+public:
+	XPipelineCacheFile(uint64_t InDeviceKey = 0) : DeviceKey(InDeviceKey) {}
+
+	// nullptr if there is no blob for Key
+	const std::vector<uint8_t>* FindBlob(uint64_t Key) const
+	{
+		auto Iter = Blobs.find(Key);
+
+		return Iter != Blobs.end() ? &Iter->second : nullptr;
+	}
+
+	void SetBlob(uint64_t Key, std::vector<uint8_t> Blob)
+	{
+		Blobs[Key] = std::move(Blob);
+		bDirty = true;
+	}
+
+	void RemoveBlob(uint64_t Key)
+	{
+		bDirty |= Blobs.erase(Key) > 0;
+	}
+
+	size_t GetBlobCount() const { return Blobs.size(); }
+
+	// Blobs changed since the last load or save
+	bool IsDirty() const { return bDirty; }
+
+	void Serialize(std::vector<uint8_t>& OutData) const;
+
+	// Replaces the blobs. Returns false and keeps no blob if the data is not a cache of this device,
+	// entries whose checksum does not match are skipped.
+	bool Deserialize(const uint8_t* Data, size_t Size);
+
+	bool SaveToFile(const std::string& FileName);
+
+	bool LoadFromFile(const std::string& FileName);
+
+private:
+	static constexpr uint32_t FileMagic = 0x4f535058;  // "XPSO"
+
+	static constexpr uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+
+		uint32_t Version;
+
+		uint64_t DeviceKey;
+
+		uint64_t EntryCount;
+	};
+
+	// Followed by Size bytes of blob
+	struct EntryHeader
+	{
+		uint64_t Key;
+
+		uint64_t Size;
+
+		uint64_t Checksum;
+	};
+
+	uint64_t DeviceKey = 0;
+
+	std::unordered_map<uint64_t, std::vector<uint8_t>> Blobs;
+
+	bool bDirty = false;
+};
+
+inline void XPipelineCacheFile::Serialize(std::vector<uint8_t>& OutData) const
+{
+	size_t Size = sizeof(FileHeader);
+	for (const auto& Pair : Blobs)
+	{
+		Size += sizeof(EntryHeader) + Pair.second.size();
+	}
+
+	OutData.resize(Size);
+	uint8_t* Dest = OutData.data();
+
+	const FileHeader Header = { FileMagic, FileVersion, DeviceKey, (uint64_t)Blobs.size() };
+	memcpy(Dest, &Header, sizeof(Header));
+	Dest += sizeof(Header);
+
+	for (const auto& Pair : Blobs)
+	{
+		const EntryHeader Entry = { Pair.first, (uint64_t)Pair.second.size(), HashHelper::HashBytes(Pair.second.data(), Pair.second.size()) };
+		memcpy(Dest, &Entry, sizeof(Entry));
+		Dest += sizeof(Entry);
+
+		if (!Pair.second.empty())
+		{
+			memcpy(Dest, Pair.second.data(), Pair.second.size());
+			Dest += Pair.second.size();
+		}
+	}
+}
+
+inline bool XPipelineCacheFile::Deserialize(const uint8_t* Data, size_t Size)
+{
+	Blobs.clear();
+
+	// Rewritten on the next save if anything is wrong with it
+	bDirty = true;
+
+	FileHeader Header;
+	if (Size < sizeof(Header))
+	{
+		return false;
+	}
+
+	memcpy(&Header, Data, sizeof(Header));
+	if (Header.Magic != FileMagic || Header.Version != FileVersion || Header.DeviceKey != DeviceKey)
+	{
+		return false;
+	}
+
+	size_t Offset = sizeof(Header);
+	for (uint64_t i = 0; i < Header.EntryCount; i++)
+	{
+		EntryHeader Entry;
+		if (Size - Offset < sizeof(Entry))
+		{
+			Blobs.clear();
+
+			return false;
+		}
+
+		memcpy(&Entry, Data + Offset, sizeof(Entry));
+		Offset += sizeof(Entry);
+
+		// A truncated file, nothing after this can be trusted
+		if (Entry.Size > Size - Offset)
+		{
+			Blobs.clear();
+
+			return false;
+		}
+
+		const uint8_t* Blob = Data + Offset;
+		Offset += (size_t)Entry.Size;
+
+		if (HashHelper::HashBytes(Blob, (size_t)Entry.Size) == Entry.Checksum)
+		{
+			Blobs[Entry.Key].assign(Blob, Blob + Entry.Size);
+		}
+	}
+
+	bDirty = Blobs.size() != Header.EntryCount;
+
+	return true;
+}
+
+inline bool XPipelineCacheFile::SaveToFile(const std::string& FileName)
+{
+	std::vector<uint8_t> Data;
+	Serialize(Data);
+
+	std::ofstream File(FileName, std::ios::binary);
+	if (!File)
+	{
+		return false;
+	}
+
+	File.write((const char*)Data.data(), (std::streamsize)Data.size());
+	if (!File)
+	{
+		return false;
+	}
+
+	bDirty = false;
+
+	return true;
+}
+
+inline bool XPipelineCacheFile::LoadFromFile(const std::string& FileName)
+{
+	std::ifstream File(FileName, std::ios::binary | std::ios::ate);
+	if (!File)
+	{
+		Blobs.clear();
+
+		return false;
+	}
+
+	std::vector<uint8_t> Data((size_t)File.tellg());
+	File.seekg(0);
+	File.read((char*)Data.data(), (std::streamsize)Data.size());
+	if (!File)
+	{
+		Blobs.clear();
+
+		return false;
+	}
+
+	return Deserialize(Data.data(), Data.size());
+}
+
+// Pipeline states by key, created once per run and compiled once per device and driver.
+// PipelineType is a reference to the device object, e.g. ComPtr<ID3D12PipelineState>, empty when creation failed.
+// Thread safe, the pipelines are created outside of the lock.
+template<typename PipelineType>
+class XPipelineStateCache
+{
+public:
+	struct Stats
+	{
+		// Found among the pipelines created this run
+		uint64_t HitCount = 0;
+
+		// Created from a blob of the cache file
+		uint64_t BlobHitCount = 0;
+
+		// Compiled by the driver
+		uint64_t CompileCount = 0;
+
+		// Blobs the driver did not accept, e.g. after a driver update
+		uint64_t RejectedBlobCount = 0;
+	};
+
+public:
+	XPipelineStateCache(uint64_t DeviceKey = 0) : CacheFile(DeviceKey) {}
+
+	// Create(const std::vector<uint8_t>* CachedBlob, std::vector<uint8_t>& OutBlob) creates the pipeline from CachedBlob,
+	// or returns an empty one if the blob is rejected. Without CachedBlob it compiles the pipeline and fills OutBlob.
+	template<typename CreateFuncType>
+	PipelineType FindOrCreate(uint64_t Key, CreateFuncType&& Create);
+
+	bool LoadFromFile(const std::string& FileName)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		return CacheFile.LoadFromFile(FileName);
+	}
+
+	// Only writes the file if a pipeline was compiled since it was loaded
+	bool SaveToFile(const std::string& FileName)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		return !CacheFile.IsDirty() || CacheFile.SaveToFile(FileName);
+	}
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		return CacheStats;
+	}
+
+	size_t GetPipelineCount()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		return Pipelines.size();
+	}
+
+private:
+	std::mutex Mutex;
+
+	std::unordered_map<uint64_t, PipelineType> Pipelines;
+
+	XPipelineCacheFile CacheFile;
+
+	Stats CacheStats;
+};
+
+template<typename PipelineType>
+template<typename CreateFuncType>
+inline PipelineType XPipelineStateCache<PipelineType>::FindOrCreate(uint64_t Key, CreateFuncType&& Create)
+{
+	std::vector<uint8_t> CachedBlob;
+	bool bHasBlob = false;
+
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		auto Iter = Pipelines.find(Key);
+		if (Iter != Pipelines.end())
+		{
+			CacheStats.HitCount++;
+
+			return Iter->second;
+		}
+
+		// Copied, another thread may replace it meanwhile
+		if (const std::vector<uint8_t>* Blob = CacheFile.FindBlob(Key))
+		{
+			CachedBlob = *Blob;
+			bHasBlob = true;
+		}
+	}
+
+	std::vector<uint8_t> NewBlob;
+	PipelineType Pipeline = bHasBlob ? Create(&CachedBlob, NewBlob) : PipelineType();
+
+	const bool bRejected = bHasBlob && !Pipeline;
+	if (!Pipeline)
+	{
+		Pipeline = Create(nullptr, NewBlob);
+		if (!Pipeline)
+		{
+			return Pipeline;
+		}
+	}
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+
+	if (bHasBlob && !bRejected)
+	{
+		CacheStats.BlobHitCount++;
+	}
+	else
+	{
+		CacheStats.CompileCount++;
+		CacheStats.RejectedBlobCount += bRejected ? 1 : 0;
+
+		if (!NewBlob.empty())
+		{
+			CacheFile.SetBlob(Key, std::move(NewBlob));
+		}
+		else if (bRejected)
+		{
+			CacheFile.RemoveBlob(Key);
+		}
+	}
+
+	// Created by another thread meanwhile, keep the first one
+	return Pipelines.emplace(Key, Pipeline).first->second;
+}
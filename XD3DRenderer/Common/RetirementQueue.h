@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <deque>
+
+// FIFO of items that are released once the fence value they were retired with has completed.
+// Items must be enqueued with non-decreasing fence values, which holds when they are tagged with the current frame's fence.
+template<typename T>
+class XRetirementQueue
+{
+public:
+	void Enqueue(const T& Item, uint64_t FenceValue)
+	{
+		assert(Entries.empty() || Entries.back().FenceValue <= FenceValue);
+
+		Entries.push_back({ Item, FenceValue });
+	}
+
+	// Release the items whose fence value is <= CompletedFenceValue, returns the number of released items
+	template<typename ReleaseFuncType>
+	uint32_t Retire(uint64_t CompletedFenceValue, ReleaseFuncType&& ReleaseFunc)
+	{
+		uint32_t RetiredCount = 0;
+
+		while (!Entries.empty() && Entries.front().FenceValue <= CompletedFenceValue)
+		{
+			ReleaseFunc(Entries.front().Item);
+			Entries.pop_front();
+
+			RetiredCount++;
+		}
+
+		return RetiredCount;
+	}
+
+	// Release everything, only safe once the GPU is idle
+	template<typename ReleaseFuncType>
+	uint32_t RetireAll(ReleaseFuncType&& ReleaseFunc)
+	{
+		return Retire(UINT64_MAX, ReleaseFunc);
+	}
+
+	bool IsEmpty() const { return Entries.empty(); }
+
+	size_t GetSize() const { return Entries.size(); }
+
+	// Fence value the oldest pending item waits for
+	uint64_t GetOldestFenceValue() const
+	{
+		assert(!Entries.empty());
+
+		return Entries.front().FenceValue;
+	}
+
+private:
+	struct Entry
+	{
+		T Item;
+
+		uint64_t FenceValue;
+	};
+
+	std::deque<Entry> Entries;
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "HashHelper.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+
+// A resource bound by a shader, what D3DShader reads from the shader reflection
+struct XShaderBindingRecord
+{
+	std::string Name;
+
+	// D3D_SHADER_INPUT_TYPE
+	uint32_t Type = 0;
+
+	uint32_t BindPoint = 0;
+
+	uint32_t BindCount = 0;
+
+	uint32_t RegisterSpace = 0;
+
+	// Size in bytes of a cbuffer, 0 for the other types
+	uint32_t ConstantBufferSize = 0;
+
+	bool operator==(const XShaderBindingRecord& Other) const
+	{
+		return Name == Other.Name && Type == Other.Type && BindPoint == Other.BindPoint && BindCount == Other.BindCount
+			&& RegisterSpace == Other.RegisterSpace && ConstantBufferSize == Other.ConstantBufferSize;
+	}
+};
+
+// Compiled shader with its reflection, everything D3DShader needs without compiling or reflecting again
+struct XShaderCacheEntry
+{
+	std::vector<uint8_t> Bytecode;
+
+	std::vector<XShaderBindingRecord> Bindings;
+};
+
+// Content-addressed cache of compiled shaders on disk, one file per key in Directory.
+// The key is the hash of everything the compilation depends on, e.g. the preprocessed source, the entry point,
+// the target, the flags and the defines: an entry is never stale, changed shaders get new keys.
+// Thread safe.
+class XShaderCache
+{
+public:
+	struct Stats
+	{
+		uint64_t HitCount = 0;
+
+		uint64_t MissCount = 0;
+
+		// Files found but not readable, counted as misses too
+		uint64_t CorruptCount = 0;
+	};
+
+public:
+	XShaderCache(const std::string& InDirectory) : Directory(InDirectory) {}
+
+	// Returns false on a miss
+	bool Find(uint64_t Key, XShaderCacheEntry& OutEntry);
+
+	bool Store(uint64_t Key, const XShaderCacheEntry& Entry);
+
+	std::string GetFileName(uint64_t Key) const;
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+
+		return CacheStats;
+	}
+
+	// e.g. "Shader cache: 12 hits, 3 misses"
+	std::string GetStatsString();
+
+	static void Serialize(uint64_t Key, const XShaderCacheEntry& Entry, std::vector<uint8_t>& OutData);
+
+	// Returns false if the data is not a valid entry for Key
+	static bool Deserialize(uint64_t Key, const uint8_t* Data, size_t Size, XShaderCacheEntry& OutEntry);
+
+private:
+	static constexpr uint32_t FileMagic = 0x43485358;  // "XSHC"
+
+	static constexpr uint32_t FileVersion = 1;
+
+	// Followed by the bytecode then the bindings, each one the name length, the name and 5 uint32_t
+	struct FileHeader
+	{
+		uint32_t Magic;
+
+		uint32_t Version;
+
+		uint64_t Key;
+
+		// Of everything after the header
+		uint64_t Checksum;
+
+		uint64_t BytecodeSize;
+
+		uint32_t BindingCount;
+
+		uint32_t Padding;
+	};
+
+	std::string Directory;
+
+	std::mutex Mutex;
+
+	Stats CacheStats;
+};
+
+inline std::string XShaderCache::GetFileName(uint64_t Key) const
+{
+	char Name[32];
+	snprintf(Name, sizeof(Name), "%016llx.xshc", (unsigned long long)Key);
+
+	return Directory + "/" + Name;
+}
+
+inline bool XShaderCache::Find(uint64_t Key, XShaderCacheEntry& OutEntry)
+{
+	std::ifstream File(GetFileName(Key), std::ios::binary | std::ios::ate);
+
+	bool bFound = false;
+	bool bCorrupt = false;
+
+	if (File)
+	{
+		std::vector<uint8_t> Data((size_t)File.tellg());
+		File.seekg(0);
+		File.read((char*)Data.data(), (std::streamsize)Data.size());
+
+		bFound = File && Deserialize(Key, Data.data(), Data.size(), OutEntry);
+		bCorrupt = !bFound;
+	}
+
+	std::lock_guard<std::mutex> Lock(Mutex);
+	CacheStats.HitCount += bFound ? 1 : 0;
+	CacheStats.MissCount += bFound ? 0 : 1;
+	CacheStats.CorruptCount += bCorrupt ? 1 : 0;
+
+	return bFound;
+}
+
+inline bool XShaderCache::Store(uint64_t Key, const XShaderCacheEntry& Entry)
+{
+	std::vector<uint8_t> Data;
+	Serialize(Key, Entry, Data);
+
+	// Written aside then renamed, a reader never sees half a file
+	const std::string FileName = GetFileName(Key);
+	const std::string TempFileName = FileName + ".tmp";
+	{
+		std::ofstream File(TempFileName, std::ios::binary);
+		File.write((const char*)Data.data(), (std::streamsize)Data.size());
+		if (!File)
+		{
+			return false;
+		}
+	}
+
+	remove(FileName.c_str());
+
+	return rename(TempFileName.c_str(), FileName.c_str()) == 0;
+}
+
+inline std::string XShaderCache::GetStatsString()
+{
+	const Stats CurrentStats = GetStats();
+
+	char Text[128];
+	snprintf(Text, sizeof(Text), "Shader cache: %llu hits, %llu misses (%llu corrupt)", (unsigned long long)CurrentStats.HitCount,
+		(unsigned long long)CurrentStats.MissCount, (unsigned long long)CurrentStats.CorruptCount);
+
+	return Text;
+}
+
+inline void XShaderCache::Serialize(uint64_t Key, const XShaderCacheEntry& Entry, std::vector<uint8_t>& OutData)
+{
+	OutData.resize(sizeof(FileHeader));
+	OutData.insert(OutData.end(), Entry.Bytecode.begin(), Entry.Bytecode.end());
+
+	auto Append = [&OutData](const void* Value, size_t Size)
+	{
+		const uint8_t* Bytes = (const uint8_t*)Value;
+		OutData.insert(OutData.end(), Bytes, Bytes + Size);
+	};
+
+	for (const XShaderBindingRecord& Binding : Entry.Bindings)
+	{
+		const uint32_t NameLength = (uint32_t)Binding.Name.size();
+		const uint32_t Values[5] = { Binding.Type, Binding.BindPoint, Binding.BindCount, Binding.RegisterSpace, Binding.ConstantBufferSize };
+
+		Append(&NameLength, sizeof(NameLength));
+		Append(Binding.Name.data(), NameLength);
+		Append(Values, sizeof(Values));
+	}
+
+	FileHeader Header = {};
+	Header.Magic = FileMagic;
+	Header.Version = FileVersion;
+	Header.Key = Key;
+	Header.Checksum = HashHelper::HashBytes(OutData.data() + sizeof(FileHeader), OutData.size() - sizeof(FileHeader));
+	Header.BytecodeSize = Entry.Bytecode.size();
+	Header.BindingCount = (uint32_t)Entry.Bindings.size();
+	memcpy(OutData.data(), &Header, sizeof(Header));
+}
+
+inline bool XShaderCache::Deserialize(uint64_t Key, const uint8_t* Data, size_t Size, XShaderCacheEntry& OutEntry)
+{
+	FileHeader Header;
+	if (Size < sizeof(Header))
+	{
+		return false;
+	}
+
+	memcpy(&Header, Data, sizeof(Header));
+
+	const uint8_t* Body = Data + sizeof(Header);
+	const size_t BodySize = Size - sizeof(Header);
+
+	if (Header.Magic != FileMagic || Header.Version != FileVersion || Header.Key != Key
+		|| Header.BytecodeSize > BodySize || HashHelper::HashBytes(Body, BodySize) != Header.Checksum)
+	{
+		return false;
+	}
+
+	OutEntry.Bytecode.assign(Body, Body + Header.BytecodeSize);
+	OutEntry.Bindings.resize(Header.BindingCount);
+
+	size_t Offset = (size_t)Header.BytecodeSize;
+	for (XShaderBindingRecord& Binding : OutEntry.Bindings)
+	{
+		uint32_t NameLength = 0;
+		uint32_t Values[5];
+
+		if (BodySize - Offset < sizeof(NameLength))
+		{
+			return false;
+		}
+
+		memcpy(&NameLength, Body + Offset, sizeof(NameLength));
+		Offset += sizeof(NameLength);
+
+		if (BodySize - Offset < (size_t)NameLength + sizeof(Values))
+		{
+			return false;
+		}
+
+		Binding.Name.assign((const char*)Body + Offset, NameLength);
+		Offset += NameLength;
+
+		memcpy(Values, Body + Offset, sizeof(Values));
+		Offset += sizeof(Values);
+
+		Binding.Type = Values[0];
+		Binding.BindPoint = Values[1];
+		Binding.BindCount = Values[2];
+		Binding.RegisterSpace = Values[3];
+		Binding.ConstantBufferSize = Values[4];
+	}
+
+	return Offset == BodySize;
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "BitHelper.h"
+#include <vector>
+
+// Device-independent bookkeeping of size class slabs for small allocations.
+// Size classes are the powers of two from MinClassSize to MaxClassSize, each slab holds SlotCount slots
+// of one class and tracks them in a single bitmap word, so allocation and deallocation are a bit scan.
+// The slab memory itself is owned by the caller, typically one block of a buddy allocator per slab.
+class XSlabAllocatorCore
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	static constexpr uint32_t SlotCount = 64;
+
+	struct Allocation
+	{
+		uint32_t SlabIndex = InvalidIndex;
+
+		uint32_t SlotIndex = 0;
+
+		uint32_t OffsetInSlab = 0;
+	};
+
+public:
+	XSlabAllocatorCore() {}
+
+	XSlabAllocatorCore(uint32_t InMinClassSize, uint32_t InMaxClassSize)
+	{
+		Initialize(InMinClassSize, InMaxClassSize);
+	}
+
+	// Both sizes must be powers of two
+	void Initialize(uint32_t InMinClassSize, uint32_t InMaxClassSize);
+
+	// Smallest size class holding Size with Alignment, InvalidIndex if the request is too large.
+	// Slots are aligned to their class size as long as the slab memory is, so Alignment must be a power of two.
+	uint32_t GetSizeClass(uint64_t Size, uint32_t Alignment) const;
+
+	uint32_t GetSizeClassCount() const { return (uint32_t)PartialSlabHeads.size(); }
+
+	uint32_t GetClassSize(uint32_t SizeClass) const { return MinClassSize << SizeClass; }
+
+	uint32_t GetSlabSize(uint32_t SizeClass) const { return GetClassSize(SizeClass) * SlotCount; }
+
+	// Take a slot from a slab of SizeClass, returns false if all of its slabs are full
+	bool Allocate(uint32_t SizeClass, Allocation& OutAllocation);
+
+	// Returns true if the slab has no used slot left
+	bool Deallocate(uint32_t SlabIndex, uint32_t SlotIndex);
+
+	// Register the memory of a new slab of GetSlabSize(SizeClass) bytes, returns its index
+	uint32_t AddSlab(uint32_t SizeClass);
+
+	// The slab must be empty, its index may be reused by AddSlab
+	void RemoveSlab(uint32_t SlabIndex);
+
+	uint32_t GetSlabSizeClass(uint32_t SlabIndex) const { return Slabs[SlabIndex].SizeClass; }
+
+	uint32_t GetEmptySlabCount(uint32_t SizeClass) const { return EmptySlabCounts[SizeClass]; }
+
+private:
+	static constexpr uint64_t AllSlotsFree = ~0ull;
+
+	struct Slab
+	{
+		uint64_t FreeMask = AllSlotsFree;  // Bit N is set if slot N is free
+
+		uint32_t SizeClass = 0;
+
+		// Links of the per class list of slabs with at least one free slot
+		uint32_t PrevPartial = InvalidIndex;
+
+		uint32_t NextPartial = InvalidIndex;
+	};
+
+	void PushPartialSlab(uint32_t SlabIndex);
+
+	void RemovePartialSlab(uint32_t SlabIndex);
+
+private:
+	uint32_t MinClassSize = 256;
+
+	uint32_t MinClassSizeLog2 = 8;
+
+	uint32_t MaxClassSize = 65536;
+
+	std::vector<Slab> Slabs;
+
+	std::vector<uint32_t> UnusedSlabs;
+
+	std::vector<uint32_t> PartialSlabHeads;
+
+	std::vector<uint32_t> EmptySlabCounts;
+};
+
+inline void XSlabAllocatorCore::Initialize(uint32_t InMinClassSize, uint32_t InMaxClassSize)
+{
+	assert(BitHelper::IsPowerOfTwo(InMinClassSize) && BitHelper::IsPowerOfTwo(InMaxClassSize) && InMinClassSize <= InMaxClassSize);
+
+	MinClassSize = InMinClassSize;
+	MinClassSizeLog2 = BitHelper::FindHighestSetBit(MinClassSize);
+	MaxClassSize = InMaxClassSize;
+
+	const uint32_t ClassCount = BitHelper::FindHighestSetBit(MaxClassSize) - MinClassSizeLog2 + 1;
+	PartialSlabHeads.assign(ClassCount, InvalidIndex);
+	EmptySlabCounts.assign(ClassCount, 0);
+
+	Slabs.clear();
+	UnusedSlabs.clear();
+}
+
+inline uint32_t XSlabAllocatorCore::GetSizeClass(uint64_t Size, uint32_t Alignment) const
+{
+	if (Size == 0 || (Alignment != 0 && !BitHelper::IsPowerOfTwo(Alignment)))
+	{
+		return InvalidIndex;
+	}
+
+	uint64_t RequiredSize = Size > Alignment ? Size : Alignment;
+	RequiredSize = RequiredSize > MinClassSize ? RequiredSize : MinClassSize;
+	if (RequiredSize > MaxClassSize)
+	{
+		return InvalidIndex;
+	}
+
+	return BitHelper::CeilLog2(RequiredSize) - MinClassSizeLog2;
+}
+
+inline bool XSlabAllocatorCore::Allocate(uint32_t SizeClass, Allocation& OutAllocation)
+{
+	const uint32_t SlabIndex = PartialSlabHeads[SizeClass];
+	if (SlabIndex == InvalidIndex)
+	{
+		return false;
+	}
+
+	Slab& Current = Slabs[SlabIndex];
+	if (Current.FreeMask == AllSlotsFree)
+	{
+		EmptySlabCounts[SizeClass]--;
+	}
+
+	const uint32_t SlotIndex = BitHelper::FindLowestSetBit(Current.FreeMask);
+	Current.FreeMask &= ~(1ull << SlotIndex);
+
+	if (Current.FreeMask == 0)
+	{
+		RemovePartialSlab(SlabIndex);
+	}
+
+	OutAllocation.SlabIndex = SlabIndex;
+	OutAllocation.SlotIndex = SlotIndex;
+	OutAllocation.OffsetInSlab = SlotIndex * GetClassSize(SizeClass);
+
+	return true;
+}
+
+inline bool XSlabAllocatorCore::Deallocate(uint32_t SlabIndex, uint32_t SlotIndex)
+{
+	assert(SlabIndex < Slabs.size() && SlotIndex < SlotCount);
+
+	Slab& Current = Slabs[SlabIndex];
+	assert((Current.FreeMask & (1ull << SlotIndex)) == 0);
+
+	if (Current.FreeMask == 0)
+	{
+		PushPartialSlab(SlabIndex);
+	}
+
+	Current.FreeMask |= (1ull << SlotIndex);
+
+	if (Current.FreeMask == AllSlotsFree)
+	{
+		EmptySlabCounts[Current.SizeClass]++;
+
+		return true;
+	}
+
+	return false;
+}
+
+inline uint32_t XSlabAllocatorCore::AddSlab(uint32_t SizeClass)
+{
+	assert(SizeClass < GetSizeClassCount());
+
+	uint32_t SlabIndex;
+	if (!UnusedSlabs.empty())
+	{
+		SlabIndex = UnusedSlabs.back();
+		UnusedSlabs.pop_back();
+	}
+	else
+	{
+		SlabIndex = (uint32_t)Slabs.size();
+		Slabs.emplace_back();
+	}
+
+	Slabs[SlabIndex] = Slab();
+	Slabs[SlabIndex].SizeClass = SizeClass;
+
+	PushPartialSlab(SlabIndex);
+	EmptySlabCounts[SizeClass]++;
+
+	return SlabIndex;
+}
+
+inline void XSlabAllocatorCore::RemoveSlab(uint32_t SlabIndex)
+{
+	assert(Slabs[SlabIndex].FreeMask == AllSlotsFree);
+
+	RemovePartialSlab(SlabIndex);
+	EmptySlabCounts[Slabs[SlabIndex].SizeClass]--;
+
+	UnusedSlabs.push_back(SlabIndex);
+}
+
+inline void XSlabAllocatorCore::PushPartialSlab(uint32_t SlabIndex)
+{
+	Slab& Current = Slabs[SlabIndex];
+	const uint32_t Head = PartialSlabHeads[Current.SizeClass];
+
+	Current.PrevPartial = InvalidIndex;
+	Current.NextPartial = Head;
+	if (Head != InvalidIndex)
+	{
+		Slabs[Head].PrevPartial = SlabIndex;
+	}
+	PartialSlabHeads[Current.SizeClass] = SlabIndex;
+}
+
+inline void XSlabAllocatorCore::RemovePartialSlab(uint32_t SlabIndex)
+{
+	Slab& Current = Slabs[SlabIndex];
+
+	if (Current.PrevPartial != InvalidIndex)
+	{
+		Slabs[Current.PrevPartial].NextPartial = Current.NextPartial;
+	}
+	else
+	{
+		PartialSlabHeads[Current.SizeClass] = Current.NextPartial;
+	}
+
+	if (Current.NextPartial != InvalidIndex)
+	{
+		Slabs[Current.NextPartial].PrevPartial = Current.PrevPartial;
+	}
+
+	Current.PrevPartial = InvalidIndex;
+	Current.NextPartial = InvalidIndex;
+}
@@ -0,0 +1,490 @@
+#pragma once
+
+#include "BitHelper.h"
+#include "AllocatorStats.h"
+#include <vector>
+
+// Device-independent two-level segregated fit (TLSF) allocator bookkeeping.
+// Free blocks are binned by a first level (power of two) and a second level (SLIndexCount linear
+// subdivisions of it), both tracked with bitmaps, so allocation and deallocation are O(1).
+// Sizes are rounded to Granularity only, internal fragmentation is bounded by 1 / SLIndexCount of the block size.
+// Sizes and byte offsets are 64-bit, blocks are tracked in 32-bit Granularity units.
+class XTLSFAllocatorCore
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	struct Allocation
+	{
+		uint32_t BlockIndex = InvalidIndex;
+
+		uint64_t OffsetInBytes = 0;
+
+		uint64_t AlignedOffsetInBytes = 0;
+
+		uint64_t SizeInBytes = 0;
+	};
+
+public:
+	XTLSFAllocatorCore() {}
+
+	XTLSFAllocatorCore(uint64_t InPoolSize, uint32_t InGranularity)
+	{
+		Initialize(InPoolSize, InGranularity);
+	}
+
+	// PoolSize / Granularity must fit in 32 bits
+	void Initialize(uint64_t InPoolSize, uint32_t InGranularity);
+
+	bool Allocate(uint64_t Size, uint32_t Alignment, Allocation& OutAllocation);
+
+	void Deallocate(uint32_t BlockIndex, uint64_t RequestedSize);
+
+	bool CanAllocate(uint64_t SizeToAllocate) const;
+
+	uint64_t GetSizeToAllocate(uint64_t Size, uint32_t Alignment) const;
+
+	uint64_t GetPoolSize() const { return PoolSize; }
+
+	uint64_t GetTotalAllocSize() const { return (uint64_t)AllocatedUnitSize * Granularity; }
+
+	XAllocatorStats GetStats() const;
+
+private:
+	static constexpr uint32_t SLIndexCountLog2 = 5;
+
+	static constexpr uint32_t SLIndexCount = 1 << SLIndexCountLog2;
+
+	static constexpr uint32_t FLIndexCount = 32;
+
+	struct Block
+	{
+		uint32_t Offset = 0;  // In Granularity units
+
+		uint32_t Size = 0;  // In Granularity units
+
+		uint32_t PrevPhysical = InvalidIndex;
+
+		uint32_t NextPhysical = InvalidIndex;
+
+		uint32_t PrevFree = InvalidIndex;
+
+		uint32_t NextFree = InvalidIndex;
+
+		bool bFree = false;
+	};
+
+	void MappingInsert(uint32_t UnitSize, uint32_t& OutFL, uint32_t& OutSL) const;
+
+	// Like MappingInsert, but rounds up to the next list so that any block found there is large enough
+	bool MappingSearch(uint32_t UnitSize, uint32_t& OutFL, uint32_t& OutSL) const;
+
+	uint32_t FindSuitableBlock(uint32_t FL, uint32_t SL) const;
+
+	void InsertFreeBlock(uint32_t BlockIndex);
+
+	void RemoveFreeBlock(uint32_t BlockIndex);
+
+	uint32_t CreateBlock();
+
+	void ReleaseBlock(uint32_t BlockIndex);
+
+	// Size must not exceed the pool size
+	uint32_t SizeToUnitSize(uint64_t Size) const
+	{
+		return (uint32_t)((Size + (Granularity - 1)) / Granularity);
+	}
+
+private:
+	uint64_t PoolSize = 0;
+
+	uint32_t Granularity = 256;
+
+	uint32_t FLBitmap = 0;
+
+	uint32_t SLBitmaps[FLIndexCount] = {};
+
+	uint32_t FreeLists[FLIndexCount][SLIndexCount];
+
+	// Block headers can't live in GPU memory, they are kept in this pool and recycled through UnusedBlocks
+	std::vector<Block> Blocks;
+
+	std::vector<uint32_t> UnusedBlocks;
+
+	uint32_t AllocatedUnitSize = 0;
+
+	uint64_t RequestedSize = 0;
+
+	uint32_t AllocationCount = 0;
+
+	uint32_t FreeBlockCount = 0;
+
+	XAllocationCounters Counters;
+};
+
+inline void XTLSFAllocatorCore::Initialize(uint64_t InPoolSize, uint32_t InGranularity)
+{
+	PoolSize = InPoolSize;
+	Granularity = InGranularity;
+	assert(PoolSize % Granularity == 0 && PoolSize / Granularity <= UINT32_MAX);
+
+	FLBitmap = 0;
+	for (uint32_t FL = 0; FL < FLIndexCount; FL++)
+	{
+		SLBitmaps[FL] = 0;
+
+		for (uint32_t SL = 0; SL < SLIndexCount; SL++)
+		{
+			FreeLists[FL][SL] = InvalidIndex;
+		}
+	}
+
+	Blocks.clear();
+	Blocks.reserve(1024);
+	UnusedBlocks.clear();
+
+	AllocatedUnitSize = 0;
+	RequestedSize = 0;
+	AllocationCount = 0;
+	FreeBlockCount = 0;
+	Counters.Reset();
+
+	// One free block covering the whole pool
+	uint32_t BlockIndex = CreateBlock();
+	Blocks[BlockIndex].Offset = 0;
+	Blocks[BlockIndex].Size = (uint32_t)(PoolSize / Granularity);
+	InsertFreeBlock(BlockIndex);
+}
+
+inline uint64_t XTLSFAllocatorCore::GetSizeToAllocate(uint64_t Size, uint32_t Alignment) const
+{
+	uint64_t SizeToAllocate = Size;
+
+	// If the alignment doesn't match the block granularity
+	if (Alignment != 0 && Granularity % Alignment != 0)
+	{
+		SizeToAllocate = Size + Alignment;
+	}
+
+	return SizeToAllocate;
+}
+
+inline bool XTLSFAllocatorCore::CanAllocate(uint64_t SizeToAllocate) const
+{
+	if (SizeToAllocate == 0 || SizeToAllocate > PoolSize)
+	{
+		return false;
+	}
+
+	uint32_t FL, SL;
+	if (!MappingSearch(SizeToUnitSize(SizeToAllocate), FL, SL))
+	{
+		return false;
+	}
+
+	return FindSuitableBlock(FL, SL) != InvalidIndex;
+}
+
+inline bool XTLSFAllocatorCore::Allocate(uint64_t Size, uint32_t Alignment, Allocation& OutAllocation)
+{
+	const uint64_t SizeToAllocate = GetSizeToAllocate(Size, Alignment);
+	if (SizeToAllocate == 0 || SizeToAllocate > PoolSize)
+	{
+		return false;
+	}
+
+	const uint32_t UnitSize = SizeToUnitSize(SizeToAllocate);
+
+	uint32_t FL, SL;
+	if (!MappingSearch(UnitSize, FL, SL))
+	{
+		return false;
+	}
+
+	const uint32_t BlockIndex = FindSuitableBlock(FL, SL);
+	if (BlockIndex == InvalidIndex)
+	{
+		return false;
+	}
+
+	RemoveFreeBlock(BlockIndex);
+
+	// Split the remainder back into the free lists
+	if (Blocks[BlockIndex].Size > UnitSize)
+	{
+		const uint32_t RemainderIndex = CreateBlock();  // May reallocate Blocks
+
+		Block& Used = Blocks[BlockIndex];
+		Block& Remainder = Blocks[RemainderIndex];
+		Remainder.Offset = Used.Offset + UnitSize;
+		Remainder.Size = Used.Size - UnitSize;
+		Remainder.PrevPhysical = BlockIndex;
+		Remainder.NextPhysical = Used.NextPhysical;
+		if (Used.NextPhysical != InvalidIndex)
+		{
+			Blocks[Used.NextPhysical].PrevPhysical = RemainderIndex;
+		}
+		Used.NextPhysical = RemainderIndex;
+		Used.Size = UnitSize;
+
+		InsertFreeBlock(RemainderIndex);
+	}
+
+	Block& Used = Blocks[BlockIndex];
+	AllocatedUnitSize += Used.Size;
+	RequestedSize += Size;
+	AllocationCount++;
+	Counters.RecordAllocation(Size);
+	Counters.RecordUsage((uint64_t)AllocatedUnitSize * Granularity);
+
+	const uint64_t OffsetInBytes = (uint64_t)Used.Offset * Granularity;
+	uint64_t AlignedOffsetInBytes = OffsetInBytes;
+	if (Alignment != 0 && OffsetInBytes % Alignment != 0)
+	{
+		AlignedOffsetInBytes = ((OffsetInBytes + Alignment - 1) / Alignment) * Alignment;
+		assert(AlignedOffsetInBytes - OffsetInBytes + Size <= (uint64_t)Used.Size * Granularity);
+	}
+
+	OutAllocation.BlockIndex = BlockIndex;
+	OutAllocation.OffsetInBytes = OffsetInBytes;
+	OutAllocation.AlignedOffsetInBytes = AlignedOffsetInBytes;
+	OutAllocation.SizeInBytes = (uint64_t)Used.Size * Granularity;
+
+	return true;
+}
+
+inline void XTLSFAllocatorCore::Deallocate(uint32_t BlockIndex, uint64_t InRequestedSize)
+{
+	assert(BlockIndex < Blocks.size() && !Blocks[BlockIndex].bFree);
+
+	AllocatedUnitSize -= Blocks[BlockIndex].Size;
+	RequestedSize -= InRequestedSize;
+	AllocationCount--;
+
+	// Merge with the next physical block
+	const uint32_t NextIndex = Blocks[BlockIndex].NextPhysical;
+	if (NextIndex != InvalidIndex && Blocks[NextIndex].bFree)
+	{
+		RemoveFreeBlock(NextIndex);
+
+		Block& Current = Blocks[BlockIndex];
+		Current.Size += Blocks[NextIndex].Size;
+		Current.NextPhysical = Blocks[NextIndex].NextPhysical;
+		if (Current.NextPhysical != InvalidIndex)
+		{
+			Blocks[Current.NextPhysical].PrevPhysical = BlockIndex;
+		}
+
+		ReleaseBlock(NextIndex);
+	}
+
+	// Merge with the previous physical block
+	uint32_t MergedIndex = BlockIndex;
+	const uint32_t PrevIndex = Blocks[BlockIndex].PrevPhysical;
+	if (PrevIndex != InvalidIndex && Blocks[PrevIndex].bFree)
+	{
+		RemoveFreeBlock(PrevIndex);
+
+		Block& Prev = Blocks[PrevIndex];
+		Prev.Size += Blocks[BlockIndex].Size;
+		Prev.NextPhysical = Blocks[BlockIndex].NextPhysical;
+		if (Prev.NextPhysical != InvalidIndex)
+		{
+			Blocks[Prev.NextPhysical].PrevPhysical = PrevIndex;
+		}
+
+		ReleaseBlock(BlockIndex);
+		MergedIndex = PrevIndex;
+	}
+
+	InsertFreeBlock(MergedIndex);
+}
+
+inline XAllocatorStats XTLSFAllocatorCore::GetStats() const
+{
+	XAllocatorStats Stats;
+	Stats.PoolSize = PoolSize;
+	Stats.RequestedSize = RequestedSize;
+	Stats.AllocatedSize = (uint64_t)AllocatedUnitSize * Granularity;
+	Stats.FreeSize = PoolSize - Stats.AllocatedSize;
+	Stats.FreeBlockCount = FreeBlockCount;
+	Stats.AllocationCount = AllocationCount;
+
+	// The largest free block is in the highest non-empty list
+	if (FLBitmap != 0)
+	{
+		const uint32_t FL = BitHelper::FindHighestSetBit(FLBitmap);
+		const uint32_t SL = BitHelper::FindHighestSetBit(SLBitmaps[FL]);
+
+		uint32_t LargestUnitSize = 0;
+		for (uint32_t Index = FreeLists[FL][SL]; Index != InvalidIndex; Index = Blocks[Index].NextFree)
+		{
+			LargestUnitSize = Blocks[Index].Size > LargestUnitSize ? Blocks[Index].Size : LargestUnitSize;
+		}
+
+		Stats.LargestFreeBlock = (uint64_t)LargestUnitSize * Granularity;
+	}
+
+	Counters.CopyTo(Stats);
+
+	// Walk every free list, snapshots are not taken on the allocation path
+	for (uint32_t FLMap = FLBitmap; FLMap != 0; FLMap &= FLMap - 1)
+	{
+		const uint32_t FL = BitHelper::FindLowestSetBit(FLMap);
+
+		for (uint32_t SLMap = SLBitmaps[FL]; SLMap != 0; SLMap &= SLMap - 1)
+		{
+			const uint32_t SL = BitHelper::FindLowestSetBit(SLMap);
+
+			for (uint32_t Index = FreeLists[FL][SL]; Index != InvalidIndex; Index = Blocks[Index].NextFree)
+			{
+				Stats.FreeBlockHistogram[XAllocatorStats::GetFloorLog2Bucket((uint64_t)Blocks[Index].Size * Granularity)]++;
+			}
+		}
+	}
+
+	return Stats;
+}
+
+inline void XTLSFAllocatorCore::MappingInsert(uint32_t UnitSize, uint32_t& OutFL, uint32_t& OutSL) const
+{
+	if (UnitSize < SLIndexCount)
+	{
+		// Small blocks are all in the first level, one list per size
+		OutFL = 0;
+		OutSL = UnitSize;
+	}
+	else
+	{
+		const uint32_t HighestBit = BitHelper::FindHighestSetBit(UnitSize);
+		OutFL = HighestBit - SLIndexCountLog2 + 1;
+		OutSL = (UnitSize >> (HighestBit - SLIndexCountLog2)) - SLIndexCount;
+	}
+}
+
+inline bool XTLSFAllocatorCore::MappingSearch(uint32_t UnitSize, uint32_t& OutFL, uint32_t& OutSL) const
+{
+	uint64_t RoundedSize = UnitSize;
+	if (UnitSize >= SLIndexCount)
+	{
+		const uint32_t HighestBit = BitHelper::FindHighestSetBit(UnitSize);
+		RoundedSize += (1ull << (HighestBit - SLIndexCountLog2)) - 1;
+	}
+
+	if (RoundedSize > UINT32_MAX)
+	{
+		return false;
+	}
+
+	MappingInsert((uint32_t)RoundedSize, OutFL, OutSL);
+
+	return true;
+}
+
+inline uint32_t XTLSFAllocatorCore::FindSuitableBlock(uint32_t FL, uint32_t SL) const
+{
+	// First try the lists of the same first level, starting at SL
+	uint32_t SLMap = SLBitmaps[FL] & (~0u << SL);
+
+	if (SLMap == 0)
+	{
+		// Then the smallest non-empty higher first level
+		const uint32_t FLMap = (FL + 1 < FLIndexCount) ? (FLBitmap & (~0u << (FL + 1))) : 0;
+		if (FLMap == 0)
+		{
+			return InvalidIndex;
+		}
+
+		FL = BitHelper::FindLowestSetBit(FLMap);
+		SLMap = SLBitmaps[FL];
+	}
+
+	SL = BitHelper::FindLowestSetBit(SLMap);
+
+	return FreeLists[FL][SL];
+}
+
+inline void XTLSFAllocatorCore::InsertFreeBlock(uint32_t BlockIndex)
+{
+	Block& FreeBlock = Blocks[BlockIndex];
+
+	uint32_t FL, SL;
+	MappingInsert(FreeBlock.Size, FL, SL);
+
+	const uint32_t Head = FreeLists[FL][SL];
+	FreeBlock.bFree = true;
+	FreeBlock.PrevFree = InvalidIndex;
+	FreeBlock.NextFree = Head;
+	if (Head != InvalidIndex)
+	{
+		Blocks[Head].PrevFree = BlockIndex;
+	}
+	FreeLists[FL][SL] = BlockIndex;
+
+	FLBitmap |= (1u << FL);
+	SLBitmaps[FL] |= (1u << SL);
+
+	FreeBlockCount++;
+}
+
+inline void XTLSFAllocatorCore::RemoveFreeBlock(uint32_t BlockIndex)
+{
+	Block& FreeBlock = Blocks[BlockIndex];
+	assert(FreeBlock.bFree);
+
+	uint32_t FL, SL;
+	MappingInsert(FreeBlock.Size, FL, SL);
+
+	if (FreeBlock.PrevFree != InvalidIndex)
+	{
+		Blocks[FreeBlock.PrevFree].NextFree = FreeBlock.NextFree;
+	}
+	else
+	{
+		FreeLists[FL][SL] = FreeBlock.NextFree;
+	}
+
+	if (FreeBlock.NextFree != InvalidIndex)
+	{
+		Blocks[FreeBlock.NextFree].PrevFree = FreeBlock.PrevFree;
+	}
+
+	if (FreeLists[FL][SL] == InvalidIndex)
+	{
+		SLBitmaps[FL] &= ~(1u << SL);
+		if (SLBitmaps[FL] == 0)
+		{
+			FLBitmap &= ~(1u << FL);
+		}
+	}
+
+	FreeBlock.bFree = false;
+	FreeBlock.PrevFree = InvalidIndex;
+	FreeBlock.NextFree = InvalidIndex;
+
+	FreeBlockCount--;
+}
+
+inline uint32_t XTLSFAllocatorCore::CreateBlock()
+{
+	if (!UnusedBlocks.empty())
+	{
+		uint32_t BlockIndex = UnusedBlocks.back();
+		UnusedBlocks.pop_back();
+
+		Blocks[BlockIndex] = Block();
+
+		return BlockIndex;
+	}
+
+	Blocks.emplace_back();
+
+	return (uint32_t)(Blocks.size() - 1);
+}
+
+inline void XTLSFAllocatorCore::ReleaseBlock(uint32_t BlockIndex)
+{
+	Blocks[BlockIndex] = Block();
+
+	UnusedBlocks.push_back(BlockIndex);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Fixed set of worker threads running the iterations of a parallel loop.
+// The calling thread takes part in the loop and ParallelFor only returns once every iteration is done.
+class XTaskPool
+{
+public:
+	// 0 uses one worker per hardware thread besides the calling one
+	XTaskPool(uint32_t InWorkerCount = 0);
+
+	~XTaskPool();
+
+	// Calls Func(Index) for Index in [0, Count), in any order and on any thread. Not reentrant.
+	void ParallelFor(uint32_t Count, const std::function<void(uint32_t)>& Func);
+
+	uint32_t GetWorkerCount() const { return (uint32_t)Workers.size(); }
+
+private:
+	void WorkerMain();
+
+	void RunIterations();
+
+private:
+	std::vector<std::thread> Workers;
+
+	std::mutex Mutex;
+
+	std::condition_variable WorkAvailable;
+
+	std::condition_variable WorkDone;
+
+	// Incremented for every ParallelFor, wakes the workers up
+	uint64_t Generation = 0;
+
+	bool bExit = false;
+
+	const std::function<void(uint32_t)>* CurrentFunc = nullptr;
+
+	uint32_t CurrentCount = 0;
+
+	std::atomic<uint32_t> NextIndex{ 0 };
+
+	// Workers still running the current loop
+	uint32_t BusyWorkerCount = 0;
+};
+
+inline XTaskPool::XTaskPool(uint32_t InWorkerCount)
+{
+	if (InWorkerCount == 0)
+	{
+		const uint32_t HardwareThreadCount = std::thread::hardware_concurrency();
+		InWorkerCount = HardwareThreadCount > 1 ? HardwareThreadCount - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < InWorkerCount; i++)
+	{
+		Workers.emplace_back(&XTaskPool::WorkerMain, this);
+	}
+}
+
+inline XTaskPool::~XTaskPool()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		bExit = true;
+	}
+	WorkAvailable.notify_all();
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+inline void XTaskPool::ParallelFor(uint32_t Count, const std::function<void(uint32_t)>& Func)
+{
+	if (Count == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		assert(BusyWorkerCount == 0);
+
+		CurrentFunc = &Func;
+		CurrentCount = Count;
+		NextIndex = 0;
+		BusyWorkerCount = (uint32_t)Workers.size();
+		Generation++;
+	}
+	WorkAvailable.notify_all();
+
+	RunIterations();
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	WorkDone.wait(Lock, [this]() { return BusyWorkerCount == 0; });
+
+	CurrentFunc = nullptr;
+}
+
+inline void XTaskPool::WorkerMain()
+{
+	uint64_t SeenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			WorkAvailable.wait(Lock, [this, SeenGeneration]() { return bExit || Generation != SeenGeneration; });
+
+			if (bExit)
+			{
+				return;
+			}
+
+			SeenGeneration = Generation;
+		}
+
+		RunIterations();
+
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			BusyWorkerCount--;
+		}
+		WorkDone.notify_one();
+	}
+}
+
+inline void XTaskPool::RunIterations()
+{
+	while (true)
+	{
+		const uint32_t Index = NextIndex.fetch_add(1);
+		if (Index >= CurrentCount)
+		{
+			break;
+		}
+
+		(*CurrentFunc)(Index);
+	}
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "CommandQueue.h"
+#include <stddef.h>
+#include <vector>
+#include <deque>
+
+// Identifies one upload, 0 is never a valid token
+using XUploadToken = uint64_t;
+
+// Device-independent scheduling of uploads on a copy queue.
+// Uploads are submitted in the order they were enqueued, in batches of at most FrameBudget bytes per frame,
+// each batch followed by a signal of the queue. Tokens let the callers poll for completion, and the staging
+// memory of a request is released once its batch has completed.
+template<typename RequestType>
+class XUploadScheduler
+{
+public:
+	XUploadScheduler(XCommandQueue* InQueue, uint64_t InFrameBudget)
+		: Queue(InQueue), FrameBudget(InFrameBudget)
+	{
+		assert(Queue != nullptr && FrameBudget > 0);
+	}
+
+	XUploadToken Enqueue(RequestType&& Request, uint64_t Size);
+
+	// Submit the next batch within what is left of the frame budget, a batch holds at least one request so
+	// uploads larger than the budget still go through. RecordBatch(std::vector<RequestType*>&) records and
+	// executes the copies, the queue is signaled after it. Returns the signaled value, 0 if nothing was submitted.
+	template<typename RecordBatchFuncType>
+	uint64_t SubmitFrame(RecordBatchFuncType&& RecordBatch);
+
+	// Submit every request up to Token regardless of the budget, for an upload needed right now
+	template<typename RecordBatchFuncType>
+	uint64_t SubmitUntil(XUploadToken Token, RecordBatchFuncType&& RecordBatch);
+
+	// Release the requests of the completed batches with ReleaseFunc(RequestType&)
+	template<typename ReleaseFuncType>
+	void Retire(ReleaseFuncType&& ReleaseFunc);
+
+	bool IsSubmitted(XUploadToken Token) const { return Token < NextSubmitToken; }
+
+	bool IsComplete(XUploadToken Token);
+
+	// Fence value signaled after the upload, 0 if it was not submitted yet or was already retired
+	uint64_t GetFenceValue(XUploadToken Token) const;
+
+	XUploadToken GetLastToken() const { return NextToken - 1; }
+
+	uint64_t GetPendingSize() const { return PendingSize; }
+
+	uint32_t GetPendingCount() const { return (uint32_t)PendingUploads.size(); }
+
+	uint32_t GetInFlightCount() const { return (uint32_t)InFlightUploads.size(); }
+
+	uint64_t GetFrameBudget() const { return FrameBudget; }
+
+private:
+	template<typename RecordBatchFuncType>
+	uint64_t Submit(uint64_t Budget, XUploadToken LastToken, RecordBatchFuncType&& RecordBatch);
+
+private:
+	struct Upload
+	{
+		RequestType Request;
+
+		uint64_t Size = 0;
+
+		uint64_t FenceValue = 0;
+	};
+
+	XCommandQueue* Queue = nullptr;
+
+	uint64_t FrameBudget = 0;
+
+	// Bytes submitted since the last SubmitFrame, including the ones forced by SubmitUntil
+	uint64_t FrameSubmittedSize = 0;
+
+	// Tokens are consecutive: the in flight uploads come first, then the pending ones
+	std::deque<Upload> InFlightUploads;
+
+	std::deque<Upload> PendingUploads;
+
+	XUploadToken NextToken = 1;
+
+	XUploadToken NextSubmitToken = 1;
+
+	uint64_t PendingSize = 0;
+
+	std::vector<RequestType*> Batch;
+};
+
+template<typename RequestType>
+inline XUploadToken XUploadScheduler<RequestType>::Enqueue(RequestType&& Request, uint64_t Size)
+{
+	Upload NewUpload;
+	NewUpload.Request = std::move(Request);
+	NewUpload.Size = Size;
+	PendingUploads.push_back(std::move(NewUpload));
+
+	PendingSize += Size;
+
+	return NextToken++;
+}
+
+template<typename RequestType>
+template<typename RecordBatchFuncType>
+inline uint64_t XUploadScheduler<RequestType>::SubmitFrame(RecordBatchFuncType&& RecordBatch)
+{
+	const uint64_t Budget = FrameSubmittedSize < FrameBudget ? FrameBudget - FrameSubmittedSize : 0;
+
+	uint64_t FenceValue = 0;
+	if (Budget > 0)
+	{
+		FenceValue = Submit(Budget, GetLastToken(), RecordBatch);
+	}
+
+	FrameSubmittedSize = 0;
+
+	return FenceValue;
+}
+
+template<typename RequestType>
+template<typename RecordBatchFuncType>
+inline uint64_t XUploadScheduler<RequestType>::SubmitUntil(XUploadToken Token, RecordBatchFuncType&& RecordBatch)
+{
+	if (IsSubmitted(Token))
+	{
+		return GetFenceValue(Token);
+	}
+
+	return Submit(UINT64_MAX, Token, RecordBatch);
+}
+
+template<typename RequestType>
+template<typename RecordBatchFuncType>
+inline uint64_t XUploadScheduler<RequestType>::Submit(uint64_t Budget, XUploadToken LastToken, RecordBatchFuncType&& RecordBatch)
+{
+	// The first request always fits, so a request larger than the budget does not block the queue
+	uint64_t BatchSize = 0;
+	size_t BatchCount = 0;
+	while (BatchCount < PendingUploads.size() && NextSubmitToken + BatchCount <= LastToken)
+	{
+		const uint64_t Size = PendingUploads[BatchCount].Size;
+		if (BatchCount > 0 && BatchSize + Size > Budget)
+		{
+			break;
+		}
+
+		BatchSize += Size;
+		BatchCount++;
+	}
+
+	if (BatchCount == 0)
+	{
+		return 0;
+	}
+
+	Batch.clear();
+	for (size_t i = 0; i < BatchCount; i++)
+	{
+		Batch.push_back(&PendingUploads[i].Request);
+	}
+
+	RecordBatch(Batch);
+	const uint64_t FenceValue = Queue->Signal();
+
+	for (size_t i = 0; i < BatchCount; i++)
+	{
+		PendingUploads.front().FenceValue = FenceValue;
+		InFlightUploads.push_back(std::move(PendingUploads.front()));
+		PendingUploads.pop_front();
+	}
+
+	NextSubmitToken += BatchCount;
+	PendingSize -= BatchSize;
+	FrameSubmittedSize += BatchSize;
+
+	return FenceValue;
+}
+
+template<typename RequestType>
+template<typename ReleaseFuncType>
+inline void XUploadScheduler<RequestType>::Retire(ReleaseFuncType&& ReleaseFunc)
+{
+	const uint64_t CompletedValue = Queue->GetFence()->GetCompletedValue();
+
+	while (!InFlightUploads.empty() && InFlightUploads.front().FenceValue <= CompletedValue)
+	{
+		ReleaseFunc(InFlightUploads.front().Request);
+		InFlightUploads.pop_front();
+	}
+}
+
+template<typename RequestType>
+inline bool XUploadScheduler<RequestType>::IsComplete(XUploadToken Token)
+{
+	if (!IsSubmitted(Token))
+	{
+		return false;
+	}
+
+	// Already retired, or in a batch whose fence has completed
+	const uint64_t FenceValue = GetFenceValue(Token);
+
+	return FenceValue == 0 || Queue->GetFence()->IsFenceComplete(FenceValue);
+}
+
+template<typename RequestType>
+inline uint64_t XUploadScheduler<RequestType>::GetFenceValue(XUploadToken Token) const
+{
+	if (!IsSubmitted(Token))
+	{
+		return 0;
+	}
+
+	const XUploadToken FirstInFlightToken = NextSubmitToken - InFlightUploads.size();
+	if (Token < FirstInFlightToken)
+	{
+		// Retired, its fence has completed
+		return 0;
+	}
+
+	return InFlightUploads[(size_t)(Token - FirstInFlightToken)].FenceValue;
+}
@@ -81,6 +81,8 @@ void TTexture::CreateTexture(TD3D12RHI* D3D12RHI)
 	//Create D3DTexture
 	auto& TextureInfo = TextureResource.TextureInfo;
 	TextureInfo.Type = Type;
+	// Created in COMMON so the data is uploaded on the copy queue
+	TextureInfo.InitState = D3D12_RESOURCE_STATE_COMMON;
 	D3DTexture = D3D12RHI->CreateTexture(TextureInfo, TexCreate_SRV);
 
 	//Upload InitData
@@ -13,6 +13,18 @@ D3D12ConstantBufferRef D3D12RHI::CreateConstantBuffer(const void* Contents, uint
 	return ConstantBufferRef;
 }
 
+D3D12ConstantBufferRef D3D12RHI::CreateTransientConstantBuffer(const void* Contents, uint32_t Size)
+{
+	D3D12ConstantBufferRef ConstantBufferRef = std::make_shared<D3D12ConstantBuffer>();
+
+	auto UploadBufferAllocator = GetDevice()->GetUploadBufferAllocator();
+	void* MappedData = UploadBufferAllocator->AllocTransientUploadResource(Size, UPLOAD_RESOURCE_ALIGNMENT, ConstantBufferRef->ResourceLocation);
+
+	memcpy(MappedData, Contents, Size);
+
+	return ConstantBufferRef;
+}
+
 D3D12StructuredBufferRef D3D12RHI::CreateStructuredBuffer(const void* Contents, uint32_t ElementSize, uint32_t ElementCount)
 {
 	assert(Contents != nullptr && ElementSize > 0 && ElementCount > 0);
@@ -20,7 +32,7 @@ D3D12StructuredBufferRef D3D12RHI::CreateStructuredBuffer(const void* Contents,
 	D3D12StructuredBufferRef StructuredBufferRef = std::make_shared<D3D12StructuredBuffer>();
 
 	auto UploadBufferAllocator = GetDevice()->GetUploadBufferAllocator();
-	uint32_t DataSize = ElementSize * ElementCount;
+	uint64_t DataSize = (uint64_t)ElementSize * ElementCount;
 	// Align to ElementSize
 	void* MappedData = UploadBufferAllocator->AllocUploadResource(DataSize, ElementSize, StructuredBufferRef->ResourceLocation);
 
@@ -53,7 +65,7 @@ D3D12RWStructuredBufferRef D3D12RHI::CreateRWStructuredBuffer(uint32_t ElementSi
 {
 	D3D12RWStructuredBufferRef RWStructuredBufferRef = std::make_shared<D3D12RWStructuredBuffer>();
 
-	uint32_t DataSize = ElementSize * ElementCount;
+	uint64_t DataSize = (uint64_t)ElementSize * ElementCount;
 	// Align to ElementSize
 	CreateDefaultBuffer(DataSize, ElementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, RWStructuredBufferRef->ResourceLocation);
 
@@ -92,21 +104,26 @@ D3D12RWStructuredBufferRef D3D12RHI::CreateRWStructuredBuffer(uint32_t ElementSi
 	return RWStructuredBufferRef;
 }
 
-D3D12VertexBufferRef D3D12RHI::CreateVertexBuffer(const void* Contents, uint32_t Size)
+D3D12VertexBufferRef D3D12RHI::CreateVertexBuffer(const void* Contents, uint64_t Size)
 {
 	D3D12VertexBufferRef VertexBufferRef = std::make_shared<D3D12VertexBuffer>();
 
 	CreateAndInitDefaultBuffer(Contents, Size, DEFAULT_RESOURCE_ALIGNMENT, VertexBufferRef->ResourceLocation);
 
+	// Vertex buffer views are built from the location at bind time, nothing to update when it moves
+	GetDevice()->GetDefaultBufferAllocator()->RegisterRelocatable(VertexBufferRef->ResourceLocation, nullptr);
+
 	return VertexBufferRef;
 }
 
-D3D12IndexBufferRef D3D12RHI::CreateIndexBuffer(const void* Contents, uint32_t Size)
+D3D12IndexBufferRef D3D12RHI::CreateIndexBuffer(const void* Contents, uint64_t Size)
 {
 	D3D12IndexBufferRef IndexBufferRef = std::make_shared<D3D12IndexBuffer>();
 
 	CreateAndInitDefaultBuffer(Contents, Size, DEFAULT_RESOURCE_ALIGNMENT, IndexBufferRef->ResourceLocation);
 
+	GetDevice()->GetDefaultBufferAllocator()->RegisterRelocatable(IndexBufferRef->ResourceLocation, nullptr);
+
 	return IndexBufferRef;
 }
 
@@ -133,33 +150,60 @@ D3D12ReadBackBufferRef D3D12RHI::CreateReadBackBuffer(uint32_t Size)
 	return ReadBackBufferRef;
 }
 
-void D3D12RHI::CreateDefaultBuffer(uint32_t Size, uint32_t Alignment, D3D12_RESOURCE_FLAGS Flags, D3D12ResourceLocation& ResourceLocation)
+void D3D12RHI::CreateDefaultBuffer(uint64_t Size, uint32_t Alignment, D3D12_RESOURCE_FLAGS Flags, D3D12ResourceLocation& ResourceLocation)
 {
 	//Create default resource
 	D3D12_RESOURCE_DESC ResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(Size, Flags);
 	auto DefaultBufferAllocator = GetDevice()->GetDefaultBufferAllocator();
-	DefaultBufferAllocator->AllocDefaultResource(ResourceDesc, Alignment, ResourceLocation);
+	if (!DefaultBufferAllocator->AllocDefaultResource(ResourceDesc, Alignment, ResourceLocation))
+	{
+		// The default buffers are over their memory budget
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
 }
 
-void D3D12RHI::CreateAndInitDefaultBuffer(const void* Contents, uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+void D3D12RHI::CreateAndInitDefaultBuffer(const void* Contents, uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
 {
 	//Create default resource
 	CreateDefaultBuffer(Size, Alignment, D3D12_RESOURCE_FLAG_NONE, ResourceLocation);
 
-	//Create upload resource 
-	D3D12ResourceLocation UploadResourceLocation;
+	//Create upload resource, kept alive until the copy queue is done with it
+	auto UploadResourceLocation = std::make_shared<D3D12ResourceLocation>();
 	auto UploadBufferAllocator = GetDevice()->GetUploadBufferAllocator();
-	void* MappedData = UploadBufferAllocator->AllocUploadResource(Size, UPLOAD_RESOURCE_ALIGNMENT, UploadResourceLocation);
+	void* MappedData = UploadBufferAllocator->AllocUploadResource(Size, UPLOAD_RESOURCE_ALIGNMENT, *UploadResourceLocation);
 
 	//Copy contents to upload resource
 	memcpy(MappedData, Contents, Size);
 
 	//Copy data from upload resource to default resource
 	D3D12Resource* DefaultBuffer = ResourceLocation.UnderlyingResource;
-	D3D12Resource* UploadBuffer = UploadResourceLocation.UnderlyingResource;
+	Microsoft::WRL::ComPtr<ID3D12Resource> DstResource = DefaultBuffer->D3DResource;
+	ID3D12Resource* SrcResource = UploadResourceLocation->UnderlyingResource->D3DResource.Get();
+	const uint64_t DstOffset = ResourceLocation.OffsetFromBaseOfResource;
+	const uint64_t SrcOffset = UploadResourceLocation->OffsetFromBaseOfResource;
+	auto RecordCopy = [=](ID3D12GraphicsCommandList* CommandList)
+	{
+		CommandList->CopyBufferRegion(DstResource.Get(), DstOffset, SrcResource, SrcOffset, Size);
+	};
 
-	TransitionResource(DefaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
-	CopyBufferRegion(DefaultBuffer, ResourceLocation.OffsetFromBaseOfResource, UploadBuffer, UploadResourceLocation.OffsetFromBaseOfResource, Size);
+	// The copy queue only takes buffers in COMMON, see WaitForUpload. A pool buffer leaves COMMON for good once
+	// a range of it is bound on the direct queue, e.g. by SetVertexBuffer, the direct queue may then be reading it
+	if (DefaultBuffer->ResourceState.IsInState(D3D12_RESOURCE_STATE_COMMON))
+	{
+		GetDevice()->GetUploadManager()->Enqueue(DefaultBuffer, UploadResourceLocation, Size, RecordCopy);
+	}
+	else
+	{
+		// The upload resource is released with the frame, the other ranges keep the state they are bound in
+		const D3D12_RESOURCE_STATES StateBefore = (D3D12_RESOURCE_STATES)DefaultBuffer->ResourceState.GetSubresourceState(0);
+
+		TransitionResource(DefaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+		FlushResourceBarriers();
+
+		RecordCopy(GetDevice()->GetCommandList());
+
+		TransitionResource(DefaultBuffer, StateBefore);
+	}
 }
 
 
@@ -5,7 +5,10 @@ D3D12CommandContext::D3D12CommandContext(D3D12Device* InDevice)
 	:Device(InDevice)
 {
 	CreateCommandContext();
-	DescriptorCache = std::make_unique<D3D12DescriptorCache>(Device);
+	DescriptorCache = std::make_unique<D3D12DescriptorCache>(Device, Fence.get());
+
+	RecordingContextPool = std::make_unique<XCommandListPool<D3D12RecordingContext>>(Fence.get(), [this]() { return CreateRecordingContext(); });
+	RecordingTaskPool = std::make_unique<XTaskPool>();
 }
 
 D3D12CommandContext::~D3D12CommandContext()
@@ -16,60 +19,200 @@ D3D12CommandContext::~D3D12CommandContext()
 void D3D12CommandContext::CreateCommandContext() 
 {
 	//Χ
-	ThrowIfFailed(Device->GetD3DDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence)));
+	Fence = std::make_unique<D3D12Fence>(Device->GetD3DDevice());
 	//
 	D3D12_COMMAND_QUEUE_DESC QueueDesc = {};
 	QueueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
 	QueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(&CommandQueue)));
 	//
-	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CommandListAlloc.GetAddressOf())));
+	for (UINT i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		ThrowIfFailed(Device->GetD3DDevice()->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CommandListAllocs[i].GetAddressOf())));
+	}
 	//б
-	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, CommandListAlloc.Get(),
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, CommandListAllocs[0].Get(),
 		nullptr, IID_PPV_ARGS(CommandList.GetAddressOf())));
 	//ǵúCommandListر
 	ThrowIfFailed(CommandList->Close());
 
+	FrameRing.Initialize(FRAMES_IN_FLIGHT, this);
+}
+
+uint64_t D3D12CommandContext::Signal()
+{
+	bSubmittedSinceSignal = false;
+
+	return Fence->Signal(CommandQueue.Get());
+}
+
+void D3D12CommandContext::WaitForFence(uint64_t FenceValue)
+{
+	Fence->WaitForValue(FenceValue);
+}
+
+void D3D12CommandContext::WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue)
+{
+	// Every queue of the device signals a D3D12Fence
+	D3D12Fence* OtherFence = static_cast<D3D12Fence*>(OtherQueue->GetFence());
+
+	ThrowIfFailed(CommandQueue->Wait(OtherFence->GetD3DFence(), FenceValue));
+}
+
+void D3D12CommandContext::BeginFrame()
+{
+	FrameRing.BeginFrame();
 }
 
 void D3D12CommandContext::ResetCommandAllocator()
 {
-	ThrowIfFailed(CommandListAlloc->Reset());
+	ThrowIfFailed(CommandListAllocs[FrameRing.GetFrameIndex()]->Reset());
 }
 
 void D3D12CommandContext::ResetCommandList()
 {
-	ThrowIfFailed(CommandList->Reset(CommandListAlloc.Get(), nullptr));
+	ThrowIfFailed(CommandList->Reset(CommandListAllocs[FrameRing.GetFrameIndex()].Get(), nullptr));
 }
 
 void D3D12CommandContext::ExecuteCommandLists()
 {
+	// Split barriers cannot span command lists
+	BarrierBatcher.EndPendingTransitions();
+	FlushResourceBarriers();
 
 	ThrowIfFailed(CommandList->Close());
 
 	// Add the command list to the queue for execution.
 	ID3D12CommandList* cmdsLists[] = { CommandList.Get() };
 	CommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	bSubmittedSinceSignal = true;
 }
 
-void D3D12CommandContext::FlushCommandQueue()
+void D3D12CommandContext::TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource)
 {
-	CurrentFenceValue++;
+	BarrierBatcher.Transition(Resource->D3DResource.Get(), Resource->ResourceState, Subresource, StateAfter);
+}
 
-	ThrowIfFailed(CommandQueue->Signal(Fence.Get(), CurrentFenceValue));
+void D3D12CommandContext::BeginTransition(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource)
+{
+	BarrierBatcher.BeginTransition(Resource->D3DResource.Get(), Resource->ResourceState, Subresource, StateAfter);
+}
 
-	if (Fence->GetCompletedValue() < CurrentFenceValue)
+void D3D12CommandContext::EndTransition(D3D12Resource* Resource, uint32_t Subresource)
+{
+	BarrierBatcher.EndTransition(Resource->D3DResource.Get(), Subresource);
+}
+
+void D3D12CommandContext::FlushResourceBarriers()
+{
+	BarrierBatcher.Flush([this](const std::vector<XBarrierBatcher::XBarrier>& Barriers)
 	{
-		HANDLE eventHandle = CreateEvent(nullptr, false, false, nullptr);
- 
-		ThrowIfFailed(Fence->SetEventOnCompletion(CurrentFenceValue, eventHandle));
+		ResourceBarriers.clear();
+		for (const XBarrierBatcher::XBarrier& Barrier : Barriers)
+		{
+			ResourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition((ID3D12Resource*)Barrier.Resource,
+				(D3D12_RESOURCE_STATES)Barrier.StateBefore, (D3D12_RESOURCE_STATES)Barrier.StateAfter,
+				Barrier.Subresource, (D3D12_RESOURCE_BARRIER_FLAGS)Barrier.Flags));
+		}
 
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+		CommandList->ResourceBarrier((UINT)ResourceBarriers.size(), ResourceBarriers.data());
+	});
+}
+
+uint64_t D3D12CommandContext::SignalSubmittedWork()
+{
+	return bSubmittedSinceSignal ? Signal() : Fence->GetCurrentValue() - 1;
+}
+
+void D3D12CommandContext::FlushCommandQueue()
+{
+	Fence->WaitForValue(SignalSubmittedWork());
 }
 
 void D3D12CommandContext::EndFrame()
 {
 	DescriptorCache->Reset();
+
+	if (FrameRing.IsInFrame())
+	{
+		FrameRing.EndFrame();
+	}
+	else
+	{
+		// No frame context without BeginFrame, but the descriptor and upload rings tagged the frame with
+		// the current fence value, they would wait for it forever if it was not signaled
+		Signal();
+	}
+}
+
+D3D12RecordingContext* D3D12CommandContext::CreateRecordingContext()
+{
+	D3D12RecordingContext* Context = new D3D12RecordingContext();
+
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(Context->CommandAllocator.GetAddressOf())));
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, Context->CommandAllocator.Get(),
+		nullptr, IID_PPV_ARGS(Context->CommandList.GetAddressOf())));
+	ThrowIfFailed(Context->CommandList->Close());
+
+	return Context;
+}
+
+D3D12RecordingContext* D3D12CommandContext::AcquireRecordingContext()
+{
+	D3D12RecordingContext* Context = RecordingContextPool->Acquire();
+
+	ThrowIfFailed(Context->CommandAllocator->Reset());
+	ThrowIfFailed(Context->CommandList->Reset(Context->CommandAllocator.Get(), nullptr));
+
+	ID3D12DescriptorHeap* DescriptorHeaps[] = { DescriptorCache->GetCbvSrvUavDescriptorHeap().Get() };
+	Context->CommandList->SetDescriptorHeaps(_countof(DescriptorHeaps), DescriptorHeaps);
+
+	return Context;
+}
+
+void D3D12CommandContext::ExecuteRecordingContexts(const std::vector<D3D12RecordingContext*>& Contexts)
+{
+	std::vector<ID3D12CommandList*> CommandLists;
+	CommandLists.reserve(Contexts.size());
+
+	for (D3D12RecordingContext* Context : Contexts)
+	{
+		ThrowIfFailed(Context->CommandList->Close());
+		CommandLists.push_back(Context->CommandList.Get());
+	}
+
+	if (CommandLists.size() > 0)
+	{
+		CommandQueue->ExecuteCommandLists((UINT)CommandLists.size(), CommandLists.data());
+		bSubmittedSinceSignal = true;
+	}
+
+	// Reused once the current frame's fence has been reached
+	for (D3D12RecordingContext* Context : Contexts)
+	{
+		RecordingContextPool->Release(Context, Fence->GetCurrentValue());
+	}
+}
+
+void D3D12CommandContext::RecordParallel(uint32_t ItemCount, uint32_t SliceCount, const D3D12RecordSliceFunc& RecordSlice)
+{
+	if (SliceCount == 0)
+	{
+		SliceCount = RecordingTaskPool->GetWorkerCount() + 1;
+	}
+	SliceCount = (std::min)(SliceCount, ItemCount);
+
+	std::vector<D3D12RecordingContext*> Contexts(SliceCount);
+
+	RecordingTaskPool->ParallelFor(SliceCount, [&](uint32_t SliceIndex)
+	{
+		const uint32_t Begin = (uint32_t)((uint64_t)ItemCount * SliceIndex / SliceCount);
+		const uint32_t End = (uint32_t)((uint64_t)ItemCount * (SliceIndex + 1) / SliceCount);
+
+		Contexts[SliceIndex] = AcquireRecordingContext();
+		RecordSlice(Contexts[SliceIndex]->CommandList.Get(), Begin, End);
+	});
+
+	// Slice order, whatever thread recorded them
+	ExecuteRecordingContexts(Contexts);
 }
\ No newline at end of file
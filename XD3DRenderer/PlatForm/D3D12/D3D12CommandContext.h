@@ -2,10 +2,27 @@
 
 #include "D3D12Util.h"
 #include "D3D12DescriptorCache.h"
+#include "D3D12Fence.h"
+#include "../../Common/FrameRing.h"
+#include "../../Common/CommandListPool.h"
+#include "../../Common/TaskPool.h"
+#include "../../Common/BarrierBatcher.h"
 
 class D3D12Device;
+class D3D12Resource;
 
-class D3D12CommandContext
+// Command list a worker thread records into, with its own allocator
+struct D3D12RecordingContext
+{
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocator = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList = nullptr;
+};
+
+// Records Items [Begin, End) into CommandList
+using D3D12RecordSliceFunc = std::function<void(ID3D12GraphicsCommandList* CommandList, uint32_t Begin, uint32_t End)>;
+
+class D3D12CommandContext : public XCommandQueue
 {
 public:
 	D3D12CommandContext(D3D12Device* InDevice);
@@ -20,29 +37,91 @@ public:
 
 	D3D12DescriptorCache* GetDescriptorCache() { return DescriptorCache.get(); }
 
+	virtual D3D12Fence* GetFence() override { return Fence.get(); }
+
+	virtual uint64_t Signal() override;
+
+	virtual void WaitForFence(uint64_t FenceValue) override;
+
+	virtual void WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue) override;
+
+	// Wait until the GPU is done with the next frame context, only blocks when the CPU is FRAMES_IN_FLIGHT frames ahead
+	void BeginFrame();
+
+	uint32_t GetFrameIndex() const { return FrameRing.GetFrameIndex(); }
+
+	// Resets the command allocator of the current frame
 	void ResetCommandAllocator();
 
 	void ResetCommandList();
 
+	// Ends the pending split transitions and flushes the barriers first
 	void ExecuteCommandLists();
 
+	// Signal the work submitted since the last signal, returns the value covering everything submitted so far
+	uint64_t SignalSubmittedWork();
+
 	void FlushCommandQueue();
 
+	// Work put on the queue outside of this context, e.g. Present, signaled by the next flush
+	void NotifyQueueWork() { bSubmittedSinceSignal = true; }
+
+	// Signals the end of the frame, call after ExecuteCommandLists. Always signals, with or without BeginFrame
 	void EndFrame();
+
+	// Batched on the command list, Subresource is D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES for the whole resource
+	void TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource);
+
+	// Split barrier: begin a transition known ahead of time, end it right before the resource is used
+	void BeginTransition(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource);
+
+	void EndTransition(D3D12Resource* Resource, uint32_t Subresource);
+
+	// Record the batched barriers in one ResourceBarrier call, before any draw, dispatch or copy
+	void FlushResourceBarriers();
+
+	const XBarrierBatcher::Stats& GetBarrierStats() const { return BarrierBatcher.GetStats(); }
+
+	// Thread safe. A reset command list with the descriptor cache heap set, to record from any thread
+	D3D12RecordingContext* AcquireRecordingContext();
+
+	// Close the lists and submit them in this order in one ExecuteCommandLists, they are recycled after the frame
+	void ExecuteRecordingContexts(const std::vector<D3D12RecordingContext*>& Contexts);
+
+	// Split ItemCount items into SliceCount slices recorded by the worker threads, 0 uses one slice per thread.
+	// The slices are submitted in order after the work already executed, execute the main command list first.
+	void RecordParallel(uint32_t ItemCount, uint32_t SliceCount, const D3D12RecordSliceFunc& RecordSlice);
+
+private:
+	D3D12RecordingContext* CreateRecordingContext();
+
 private:
 	D3D12Device* Device = nullptr;
 
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue = nullptr;
 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandListAlloc = nullptr;
+	// One per frame context, reset once the GPU has finished the frame that used it
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandListAllocs[FRAMES_IN_FLIGHT];
+
+	XFrameRing FrameRing;
 
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList = nullptr;
 
 	std::unique_ptr<D3D12DescriptorCache> DescriptorCache = nullptr;
 
-	Microsoft::WRL::ComPtr<ID3D12Fence> Fence = nullptr;
+	// Transitions of CommandList not recorded yet
+	XBarrierBatcher BarrierBatcher;
+
+	std::vector<D3D12_RESOURCE_BARRIER> ResourceBarriers;
+
+	std::unique_ptr<D3D12Fence> Fence = nullptr;
+
+	// A flush with nothing new to wait for reuses the last signaled value
+	bool bSubmittedSinceSignal = false;
+
+	std::unique_ptr<XCommandListPool<D3D12RecordingContext>> RecordingContextPool = nullptr;
 
-	UINT64 CurrentFenceValue = 0;
+	std::unique_ptr<XTaskPool> RecordingTaskPool = nullptr;
 };
 
 	 
\ No newline at end of file
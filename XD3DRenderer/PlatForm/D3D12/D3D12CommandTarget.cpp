@@ -0,0 +1,114 @@
+#include "D3D12CommandTarget.h"
+
+void D3D12CommandTarget::SetPipelineState(void* PipelineState)
+{
+	CommandList->SetPipelineState((ID3D12PipelineState*)PipelineState);
+}
+
+void D3D12CommandTarget::SetRootSignature(void* RootSignature, bool bCompute)
+{
+	if (bCompute)
+	{
+		CommandList->SetComputeRootSignature((ID3D12RootSignature*)RootSignature);
+	}
+	else
+	{
+		CommandList->SetGraphicsRootSignature((ID3D12RootSignature*)RootSignature);
+	}
+}
+
+void D3D12CommandTarget::SetRootDescriptorTable(uint32_t Slot, uint64_t GpuDescriptorHandle, bool bCompute)
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE Handle;
+	Handle.ptr = GpuDescriptorHandle;
+
+	if (bCompute)
+	{
+		CommandList->SetComputeRootDescriptorTable(Slot, Handle);
+	}
+	else
+	{
+		CommandList->SetGraphicsRootDescriptorTable(Slot, Handle);
+	}
+}
+
+void D3D12CommandTarget::SetRootConstantBufferView(uint32_t Slot, uint64_t GpuVirtualAddress, bool bCompute)
+{
+	if (bCompute)
+	{
+		CommandList->SetComputeRootConstantBufferView(Slot, GpuVirtualAddress);
+	}
+	else
+	{
+		CommandList->SetGraphicsRootConstantBufferView(Slot, GpuVirtualAddress);
+	}
+}
+
+void D3D12CommandTarget::SetRootConstants(uint32_t Slot, uint32_t Count, const uint32_t* Constants, bool bCompute)
+{
+	if (bCompute)
+	{
+		CommandList->SetComputeRoot32BitConstants(Slot, Count, Constants, 0);
+	}
+	else
+	{
+		CommandList->SetGraphicsRoot32BitConstants(Slot, Count, Constants, 0);
+	}
+}
+
+void D3D12CommandTarget::SetVertexBuffer(uint32_t Slot, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride)
+{
+	D3D12_VERTEX_BUFFER_VIEW VBV;
+	VBV.BufferLocation = GpuVirtualAddress;
+	VBV.StrideInBytes = Stride;
+	VBV.SizeInBytes = Size;
+	CommandList->IASetVertexBuffers(Slot, 1, &VBV);
+}
+
+void D3D12CommandTarget::SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Format)
+{
+	D3D12_INDEX_BUFFER_VIEW IBV;
+	IBV.BufferLocation = GpuVirtualAddress;
+	IBV.Format = (DXGI_FORMAT)Format;
+	IBV.SizeInBytes = Size;
+	CommandList->IASetIndexBuffer(&IBV);
+}
+
+void D3D12CommandTarget::ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers)
+{
+	ResourceBarrierList.clear();
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const XBarrierBatcher::XBarrier& Barrier = Barriers[i];
+		ResourceBarrierList.push_back(CD3DX12_RESOURCE_BARRIER::Transition((ID3D12Resource*)Barrier.Resource,
+			(D3D12_RESOURCE_STATES)Barrier.StateBefore, (D3D12_RESOURCE_STATES)Barrier.StateAfter,
+			Barrier.Subresource, (D3D12_RESOURCE_BARRIER_FLAGS)Barrier.Flags));
+	}
+
+	CommandList->ResourceBarrier(Count, ResourceBarrierList.data());
+}
+
+void D3D12CommandTarget::Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance)
+{
+	CommandList->DrawInstanced(VertexCount, InstanceCount, StartVertex, StartInstance);
+}
+
+void D3D12CommandTarget::DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance)
+{
+	CommandList->DrawIndexedInstanced(IndexCount, InstanceCount, StartIndex, BaseVertex, StartInstance);
+}
+
+void D3D12CommandTarget::Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ)
+{
+	CommandList->Dispatch(GroupCountX, GroupCountY, GroupCountZ);
+}
+
+void D3D12CommandTarget::CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size)
+{
+	CommandList->CopyBufferRegion((ID3D12Resource*)DstResource, DstOffset, (ID3D12Resource*)SrcResource, SrcOffset, Size);
+}
+
+void D3D12CommandTarget::CopyResource(void* DstResource, void* SrcResource)
+{
+	CommandList->CopyResource((ID3D12Resource*)DstResource, (ID3D12Resource*)SrcResource);
+}
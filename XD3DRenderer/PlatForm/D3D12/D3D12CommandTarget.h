@@ -0,0 +1,44 @@
+#pragma once
+
+#include "D3D12Util.h"
+#include "../../Common/CommandStream.h"
+
+// Replays an XCommandStream, or any code written against XCommandTarget, into a D3D12 command list.
+// Handles are the D3D12 objects themselves: ID3D12PipelineState, ID3D12RootSignature and ID3D12Resource.
+// Barriers are emitted as recorded and bypass the state tracking of D3D12Resource, D3D12RHI::ReplayCommandStream does not.
+class D3D12CommandTarget : public XCommandTarget
+{
+public:
+	D3D12CommandTarget(ID3D12GraphicsCommandList* InCommandList) : CommandList(InCommandList) {}
+
+	virtual void SetPipelineState(void* PipelineState) override;
+
+	virtual void SetRootSignature(void* RootSignature, bool bCompute) override;
+
+	virtual void SetRootDescriptorTable(uint32_t Slot, uint64_t GpuDescriptorHandle, bool bCompute) override;
+
+	virtual void SetRootConstantBufferView(uint32_t Slot, uint64_t GpuVirtualAddress, bool bCompute) override;
+
+	virtual void SetRootConstants(uint32_t Slot, uint32_t Count, const uint32_t* Constants, bool bCompute) override;
+
+	virtual void SetVertexBuffer(uint32_t Slot, uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Stride) override;
+
+	virtual void SetIndexBuffer(uint64_t GpuVirtualAddress, uint32_t Size, uint32_t Format) override;
+
+	virtual void ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers) override;
+
+	virtual void Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance) override;
+
+	virtual void DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance) override;
+
+	virtual void Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ) override;
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override;
+
+	virtual void CopyResource(void* DstResource, void* SrcResource) override;
+
+private:
+	ID3D12GraphicsCommandList* CommandList = nullptr;
+
+	std::vector<D3D12_RESOURCE_BARRIER> ResourceBarrierList;
+};
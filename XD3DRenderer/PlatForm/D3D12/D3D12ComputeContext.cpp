@@ -0,0 +1,86 @@
+#include "D3D12ComputeContext.h"
+#include "D3D12Device.h"
+
+D3D12ComputeContext::D3D12ComputeContext(D3D12Device* InDevice, D3D12CommandContext* InGraphicsContext)
+	:Device(InDevice), GraphicsContext(InGraphicsContext)
+{
+	Fence = std::make_unique<D3D12Fence>(Device->GetD3DDevice());
+
+	D3D12_COMMAND_QUEUE_DESC QueueDesc = {};
+	QueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	QueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(&CommandQueue)));
+	SetDebugName(CommandQueue.Get(), L"AsyncComputeQueue");
+
+	for (UINT i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		ThrowIfFailed(Device->GetD3DDevice()->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(CommandListAllocs[i].GetAddressOf())));
+	}
+
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, CommandListAllocs[0].Get(),
+		nullptr, IID_PPV_ARGS(CommandList.GetAddressOf())));
+	ThrowIfFailed(CommandList->Close());
+}
+
+D3D12ComputeContext::~D3D12ComputeContext()
+{
+	FlushCommandQueue();
+}
+
+uint64_t D3D12ComputeContext::Signal()
+{
+	return Fence->Signal(CommandQueue.Get());
+}
+
+void D3D12ComputeContext::WaitForFence(uint64_t FenceValue)
+{
+	Fence->WaitForValue(FenceValue);
+}
+
+void D3D12ComputeContext::WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue)
+{
+	// Every queue of the device signals a D3D12Fence
+	D3D12Fence* OtherFence = static_cast<D3D12Fence*>(OtherQueue->GetFence());
+
+	ThrowIfFailed(CommandQueue->Wait(OtherFence->GetD3DFence(), FenceValue));
+}
+
+void D3D12ComputeContext::ResetCommandAllocator()
+{
+	// The graphics BeginFrame waited for the frame fence, which the compute work of the frame is joined to
+	ThrowIfFailed(CommandListAllocs[GraphicsContext->GetFrameIndex()]->Reset());
+}
+
+void D3D12ComputeContext::ResetCommandList()
+{
+	ThrowIfFailed(CommandList->Reset(CommandListAllocs[GraphicsContext->GetFrameIndex()].Get(), nullptr));
+
+	ID3D12DescriptorHeap* DescriptorHeaps[] = { GraphicsContext->GetDescriptorCache()->GetCbvSrvUavDescriptorHeap().Get() };
+	CommandList->SetDescriptorHeaps(_countof(DescriptorHeaps), DescriptorHeaps);
+}
+
+uint64_t D3D12ComputeContext::ExecuteCommandLists()
+{
+	ThrowIfFailed(CommandList->Close());
+
+	ID3D12CommandList* CommandLists[] = { CommandList.Get() };
+	CommandQueue->ExecuteCommandLists(_countof(CommandLists), CommandLists);
+
+	LastSubmitValue = Signal();
+
+	return LastSubmitValue;
+}
+
+void D3D12ComputeContext::FlushCommandQueue()
+{
+	Fence->WaitForValue(SignalSubmittedWork());
+}
+
+void D3D12ComputeContext::EndFrame()
+{
+	if (LastSubmitValue > JoinedValue)
+	{
+		GraphicsContext->WaitForQueue(this, LastSubmitValue);
+		JoinedValue = LastSubmitValue;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "D3D12Util.h"
+#include "D3D12Fence.h"
+#include "../../Common/CommandQueue.h"
+
+class D3D12Device;
+class D3D12CommandContext;
+
+// Set to 0 to record compute shaders on the direct queue only
+#define ASYNC_COMPUTE_ENABLED 1
+
+// Compute queue running next to the direct one, e.g. culling or post-processing overlapping rasterization.
+// It shares the descriptor cache and the frame contexts of the graphics context: EndFrame makes the direct queue
+// wait for the frame's compute work, so everything recycled with the frame fence also covers this queue.
+// Resource transitions are recorded on the direct command list, transition the resources before the compute pass.
+class D3D12ComputeContext : public XCommandQueue
+{
+public:
+	D3D12ComputeContext(D3D12Device* InDevice, D3D12CommandContext* InGraphicsContext);
+	~D3D12ComputeContext();
+
+	ID3D12CommandQueue* GetCommandQueue() { return CommandQueue.Get(); }
+
+	ID3D12GraphicsCommandList* GetCommandList() { return CommandList.Get(); }
+
+	virtual D3D12Fence* GetFence() override { return Fence.get(); }
+
+	virtual uint64_t Signal() override;
+
+	virtual void WaitForFence(uint64_t FenceValue) override;
+
+	virtual void WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue) override;
+
+	// Resets the command allocator of the current frame, call once per frame after the graphics BeginFrame
+	void ResetCommandAllocator();
+
+	// The descriptor cache heap is set on the list
+	void ResetCommandList();
+
+	// Submit the command list and signal the queue, returns the value to wait for with WaitForQueue
+	uint64_t ExecuteCommandLists();
+
+	// Every submission is signaled, returns the last signaled value
+	uint64_t SignalSubmittedWork() { return Fence->GetCurrentValue() - 1; }
+
+	void FlushCommandQueue();
+
+	// Make the direct queue wait for the compute work of the frame, call before the graphics EndFrame
+	void EndFrame();
+
+private:
+	D3D12Device* Device = nullptr;
+
+	D3D12CommandContext* GraphicsContext = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue = nullptr;
+
+	// Indexed by the graphics frame index
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandListAllocs[FRAMES_IN_FLIGHT];
+
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList = nullptr;
+
+	std::unique_ptr<D3D12Fence> Fence = nullptr;
+
+	// Last value signaled by ExecuteCommandLists, and the last one the direct queue waits for
+	uint64_t LastSubmitValue = 0;
+
+	uint64_t JoinedValue = 0;
+};
@@ -1,9 +1,11 @@
 #include "D3D12DescriptorCache.h"
 #include "D3D12Device.h"
+#include "D3D12Fence.h"
 
 
-D3D12DescriptorCache::D3D12DescriptorCache(D3D12Device* InDevice)
-	:Device(InDevice)
+D3D12DescriptorCache::D3D12DescriptorCache(D3D12Device* InDevice, D3D12Fence* InFence)
+	:Device(InDevice),
+	Fence(InFence)
 {
 	CreateCbvSrvUavDescriptorHeap();
 
@@ -18,7 +20,7 @@ D3D12DescriptorCache::~D3D12DescriptorCache()
 void D3D12DescriptorCache::CreateCbvSrvUavDescriptorHeap()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC CSUHeapDesc;
-	CSUHeapDesc.NumDescriptors = MaxCbvSrvUavDescripotrCount;
+	CSUHeapDesc.NumDescriptors = MaxBindlessDescriptorCount + MaxCbvSrvUavDescripotrCount;
 	CSUHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	CSUHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
@@ -26,14 +28,49 @@ void D3D12DescriptorCache::CreateCbvSrvUavDescriptorHeap()
 	SetDebugName(CbvSrvUavDescriptorHeap.Get(), L"D3D12DescriptorCache CbvSrvUavDescriptorHeap");
 
 	CbvSrvUavDescriptorSize = Device->GetD3DDevice()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	CbvSrvUavDescriptorRing.Initialize(MaxCbvSrvUavDescripotrCount, Fence);
+
+	BindlessIndexAllocator.Initialize(MaxBindlessDescriptorCount, Fence);
 }
 
 
-CD3DX12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorCache::AppendCbvSrvUavDescriptorHeap(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& SrcDescriptors)
+CD3DX12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorCache::AppendCbvSrvUavDescriptors(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& SrcDescriptors)
 {
+	std::lock_guard<std::mutex> Lock(CbvSrvUavMutex);
+
+	// Reuse the table if the same descriptors were already copied this frame
+	CbvSrvUavTableKey.resize(SrcDescriptors.size());
+	for (size_t i = 0; i < SrcDescriptors.size(); i++)
+	{
+		CbvSrvUavTableKey[i] = (uint64_t)SrcDescriptors[i].ptr;
+	}
+
+	uint64_t CachedTable = 0;
+	if (CbvSrvUavTableCache.Find(CbvSrvUavTableKey, CachedTable))
+	{
+		return CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_GPU_DESCRIPTOR_HANDLE{ CachedTable });
+	}
+
 	// Append to heap
 	uint32_t SlotsNeeded = (uint32_t)SrcDescriptors.size();
-	assert(CbvSrvUavDescriptorOffset + SlotsNeeded < MaxCbvSrvUavDescripotrCount);
+	uint32_t CbvSrvUavDescriptorOffset = CbvSrvUavDescriptorRing.Allocate(SlotsNeeded);
+
+	// The ring is full of frames still in flight, wait for the oldest one
+	while (CbvSrvUavDescriptorOffset == XDescriptorRingAllocatorCore::InvalidOffset)
+	{
+		if (!CbvSrvUavDescriptorRing.HasPendingFrames())
+		{
+			// The current frame alone used the whole heap, no fence can free a slot
+			ThrowIfFailed(E_OUTOFMEMORY);
+		}
+
+		Fence->WaitForValue(CbvSrvUavDescriptorRing.GetOldestPendingFenceValue());
+		CbvSrvUavDescriptorOffset = CbvSrvUavDescriptorRing.Allocate(SlotsNeeded);
+	}
+
+	// The ring is after the bindless table
+	CbvSrvUavDescriptorOffset += MaxBindlessDescriptorCount;
 
 	auto CpuDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(CbvSrvUavDescriptorHeap
 		->GetCPUDescriptorHandleForHeapStart(), CbvSrvUavDescriptorOffset, CbvSrvUavDescriptorSize);
@@ -44,15 +81,53 @@ CD3DX12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorCache::AppendCbvSrvUavDescriptorHea
 	auto GpuDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(CbvSrvUavDescriptorHeap
 		->GetGPUDescriptorHandleForHeapStart(), CbvSrvUavDescriptorOffset, CbvSrvUavDescriptorSize);
 
-	// Increase descriptor offset
-	CbvSrvUavDescriptorOffset += SlotsNeeded;
+	CbvSrvUavTableCache.Add(CbvSrvUavTableKey, GpuDescriptorHandle.ptr);
 
 	return GpuDescriptorHandle;
 }
 
+void D3D12DescriptorCache::InvalidateCbvSrvUavTables()
+{
+	std::lock_guard<std::mutex> Lock(CbvSrvUavMutex);
+
+	CbvSrvUavTableCache.Invalidate();
+}
+
+uint32_t D3D12DescriptorCache::AddBindlessDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptor)
+{
+	uint32_t Index = BindlessIndexAllocator.Allocate();
+	if (Index == XBindlessIndexAllocator::InvalidIndex)
+	{
+		// Every index is used or still pending, the view can only be bound through tables
+		return Index;
+	}
+
+	auto CpuDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(CbvSrvUavDescriptorHeap
+		->GetCPUDescriptorHandleForHeapStart(), Index, CbvSrvUavDescriptorSize);
+	Device->GetD3DDevice()->CopyDescriptorsSimple(1, CpuDescriptorHandle, SrcDescriptor, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	return Index;
+}
+
+void D3D12DescriptorCache::RemoveBindlessDescriptor(uint32_t Index)
+{
+	BindlessIndexAllocator.Free(Index);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE D3D12DescriptorCache::GetBindlessTableStart()
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(CbvSrvUavDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+}
+
 void D3D12DescriptorCache::ResetCbvSrvUavDescriptorHeap()
 {
-	CbvSrvUavDescriptorOffset = 0;
+	// The GPU may still read the tables of this frame, only close it
+	CbvSrvUavDescriptorRing.EndFrame();
+
+	// The next frame's tables go to new slots
+	CbvSrvUavTableCache.Reset();
+
+	BindlessIndexAllocator.Retire();
 }
 
 void D3D12DescriptorCache::CreateRtvDescriptorHeap()
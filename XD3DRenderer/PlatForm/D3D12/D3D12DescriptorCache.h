@@ -1,20 +1,40 @@
 #pragma once
 
 #include "D3D12Util.h"
+#include "../../Common/DescriptorRingAllocatorCore.h"
+#include "../../Common/DescriptorTableCache.h"
+#include "../../Common/BindlessIndexAllocator.h"
+#include <mutex>
 
 class D3D12Device;
+class D3D12Fence;
 
 //
 class D3D12DescriptorCache
 {
 public:
-	D3D12DescriptorCache(D3D12Device* InDevice);
+	// Tables copied to the shader-visible heap are reused once InFence has passed the frame that used them
+	D3D12DescriptorCache(D3D12Device* InDevice, D3D12Fence* InFence);
 	~D3D12DescriptorCache();
 
 	//سͼɫԴͼͼ
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetCbvSrvUavDescriptorHeap() { return CbvSrvUavDescriptorHeap; }
 	//ӳͼɫԴͼͼ
-	CD3DX12_GPU_DESCRIPTOR_HANDLE AppendCbvSrvUavDescriptorHeap(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& SrcDescriptors);
+	// A list already copied this frame returns the same table without copying again.
+	// Thread safe, command lists may be recorded in parallel
+	CD3DX12_GPU_DESCRIPTOR_HANDLE AppendCbvSrvUavDescriptors(const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& SrcDescriptors);
+	// Hits and misses of the CbvSrvUav table deduplication
+	const XDescriptorTableCache::Stats& GetTableCacheFrameStats() const { return CbvSrvUavTableCache.GetFrameStats(); }
+	const XDescriptorTableCache::Stats& GetTableCacheTotalStats() const { return CbvSrvUavTableCache.GetTotalStats(); }
+	// A CbvSrvUav source descriptor was freed or rewritten, tables copied from it this frame can't be reused
+	void InvalidateCbvSrvUavTables();
+	// Copy SrcDescriptor to a persistent slot of the bindless table, returns its index in the table
+	// or XBindlessIndexAllocator::InvalidIndex when the table is full
+	uint32_t AddBindlessDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptor);
+	// The index is reused once the frames in flight are done with it
+	void RemoveBindlessDescriptor(uint32_t Index);
+	// Start of the bindless table, at the beginning of the CbvSrvUav heap
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GetBindlessTableStart();
 	//ȾĿͼ
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetRtvDescriptorHeap() { return RtvDescriptorHeap; }
 	//ȾĿͼ
@@ -32,9 +52,17 @@ public:
 private:
 	D3D12Device* Device = nullptr;
 
+	D3D12Fence* Fence = nullptr;
+
 	UINT CbvSrvUavDescriptorSize;
-	static const int MaxCbvSrvUavDescripotrCount = 2048;
-	uint32_t CbvSrvUavDescriptorOffset = 0;
+	static const int MaxCbvSrvUavDescripotrCount = 65536;
+	// The heap holds the bindless table first, then the ring of per-draw tables
+	static const int MaxBindlessDescriptorCount = 16384;
+	XBindlessIndexAllocator BindlessIndexAllocator;
+	XDescriptorRingAllocatorCore CbvSrvUavDescriptorRing;
+	XDescriptorTableCache CbvSrvUavTableCache;
+	std::vector<uint64_t> CbvSrvUavTableKey;
+	std::mutex CbvSrvUavMutex;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CbvSrvUavDescriptorHeap = nullptr;
 
 
@@ -0,0 +1,107 @@
+#include "D3D12Device.h"
+#include "D3D12RHI.h"
+#include "../../Common/FileHelper.h"
+
+using Microsoft::WRL::ComPtr;
+
+D3D12Device::D3D12Device(D3D12RHI* InD3D12RHI)
+	:XD3D12RHI(InD3D12RHI)
+{
+	Initialize();
+}
+
+D3D12Device::~D3D12Device()
+{
+
+}
+
+void D3D12Device::Initialize()
+{
+	// Try to create hardware device.
+	HRESULT HardwareResult = D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&D3DDevice));
+
+	// Fallback to WARP device.
+	if (FAILED(HardwareResult))
+	{
+		ComPtr<IDXGIAdapter> WarpAdapter;
+		ThrowIfFailed(XD3D12RHI->GetDxgiFactory()->EnumWarpAdapter(IID_PPV_ARGS(&WarpAdapter)));
+
+		ThrowIfFailed(D3D12CreateDevice(WarpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&D3DDevice)));
+	}
+
+	// Create CommandContext
+	CommandContext = std::make_unique<D3D12CommandContext>(this);
+
+#if ASYNC_COMPUTE_ENABLED
+	ComputeContext = std::make_unique<D3D12ComputeContext>(this, CommandContext.get());
+#endif
+
+	// Create memory allocators, freed blocks are recycled once the frame fence has passed
+	D3D12Fence* FrameFence = CommandContext->GetFence();
+
+	UploadBufferAllocator = std::make_unique<D3D12UploadBufferAllocator>(D3DDevice.Get(), FrameFence, UPLOAD_POOL_SIZE);
+
+	DefaultBufferAllocator = std::make_unique<D3D12DefaultBufferAllocator>(D3DDevice.Get(), FrameFence, DEFAULT_BUFFER_POOL_SIZE);
+
+	TextureResourceAllocator = std::make_unique<D3D3TextureResourceAllocator>(D3DDevice.Get(), FrameFence, TEXTURE_POOL_SIZE);
+
+	AllocationTrace = std::make_unique<XAllocationTrace>();
+	UploadBufferAllocator->SetAllocationTrace(AllocationTrace.get());
+	DefaultBufferAllocator->SetAllocationTrace(AllocationTrace.get());
+	TextureResourceAllocator->SetAllocationTrace(AllocationTrace.get());
+
+	// Create the copy queue streaming the initial data of buffers and textures
+	UploadManager = std::make_unique<D3D12UploadManager>(this);
+
+	// Create heapSlot allocators
+	RTVHeapSlotAllocator = std::make_unique<D3D12HeapSlotAllocator>(D3DDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 200);
+
+	DSVHeapSlotAllocator = std::make_unique<D3D12HeapSlotAllocator>(D3DDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 200);
+
+	SRVHeapSlotAllocator = std::make_unique<D3D12HeapSlotAllocator>(D3DDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 200);
+
+	// Pipeline states compiled by the previous runs
+	PipelineStateCache = std::make_unique<D3D12PipelineStateCache>(this, XD3D12RHI->GetDxgiFactory(), TFileHelpers::EngineDir() + L"Cache/PipelineStateCache.bin");
+
+	// Shaders compiled by the previous runs, one file per shader
+	const std::wstring ShaderCacheDir = TFileHelpers::EngineDir() + L"Cache/Shaders";
+	CreateDirectory((TFileHelpers::EngineDir() + L"Cache").c_str(), nullptr);
+	CreateDirectory(ShaderCacheDir.c_str(), nullptr);
+	ShaderCache = std::make_unique<XShaderCache>(Convert::WStrToStr(ShaderCacheDir));
+}
+
+D3D12HeapSlotAllocator* D3D12Device::GetHeapSlotAllocator(D3D12_DESCRIPTOR_HEAP_TYPE HeapType)
+{
+	switch (HeapType)
+	{
+	case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+		return SRVHeapSlotAllocator.get();
+		break;
+
+	//case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+	//	break;
+
+	case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
+		return RTVHeapSlotAllocator.get();
+		break;
+
+	case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
+		return DSVHeapSlotAllocator.get();
+		break;
+
+	default:
+		return nullptr;
+	}
+}
+
+std::string D3D12Device::GetMemoryStatsJson() const
+{
+	std::string Json = "{";
+	Json += "\"Upload\":" + UploadBufferAllocator->GetStats().ToJson();
+	Json += ",\"Default\":" + DefaultBufferAllocator->GetStats().ToJson();
+	Json += ",\"Uav\":" + DefaultBufferAllocator->GetUavStats().ToJson();
+	Json += ",\"Texture\":" + TextureResourceAllocator->GetStats().ToJson();
+	Json += "}";
+
+	return Json;
+}
@@ -1,5 +1,12 @@
 #pragma once
 #include "D3D12Util.h"
+#include "D3D12CommandContext.h"
+#include "D3D12ComputeContext.h"
+#include "D3D12MemoryAllocator.h"
+#include "D3D12HeapSlotAllocator.h"
+#include "D3D12UploadManager.h"
+#include "D3D12PipelineStateCache.h"
+#include "../../Common/ShaderCache.h"
 
 
 class D3D12RHI;
@@ -18,30 +25,61 @@ public:
 
 	ID3D12GraphicsCommandList* GetCommandList() { return CommandContext->GetCommandList(); }
 
-	TD3D12UploadBufferAllocator* GetUploadBufferAllocator() { return UploadBufferAllocator.get(); }
+	// nullptr when ASYNC_COMPUTE_ENABLED is 0, compute shaders then run on the direct command list
+	D3D12ComputeContext* GetComputeContext() { return ComputeContext.get(); }
 
-	TD3D12DefaultBufferAllocator* GetDefaultBufferAllocator() { return DefaultBufferAllocator.get(); }
+	D3D12UploadBufferAllocator* GetUploadBufferAllocator() { return UploadBufferAllocator.get(); }
 
-	TD3D3TextureResourceAllocator* GetTextureResourceAllocator() { return TextureResourceAllocator.get(); }
+	D3D12DefaultBufferAllocator* GetDefaultBufferAllocator() { return DefaultBufferAllocator.get(); }
 
-	TD3D12HeapSlotAllocator* GetHeapSlotAllocator(D3D12_DESCRIPTOR_HEAP_TYPE HeapType);
+	D3D3TextureResourceAllocator* GetTextureResourceAllocator() { return TextureResourceAllocator.get(); }
+
+	D3D12UploadManager* GetUploadManager() { return UploadManager.get(); }
+
+	D3D12HeapSlotAllocator* GetHeapSlotAllocator(D3D12_DESCRIPTOR_HEAP_TYPE HeapType);
+
+	D3D12PipelineStateCache* GetPipelineStateCache() { return PipelineStateCache.get(); }
+
+	// Compiled shaders of the previous runs, used by D3DShader
+	XShaderCache* GetShaderCache() { return ShaderCache.get(); }
+
+	// Stats of the upload, default, UAV and texture allocators as one JSON object
+	std::string GetMemoryStatsJson() const;
+
+	// Shared by the memory allocators, call Start() to record, see Tools/AllocatorReplay
+	XAllocationTrace* GetAllocationTrace() { return AllocationTrace.get(); }
 
 private:
 
 	void Initialize();
 
+	D3D12RHI* XD3D12RHI = nullptr;
+
 	Microsoft::WRL::ComPtr<ID3D12Device> D3DDevice = nullptr;
 
-	std::unique_ptr<TD3D12CommandContext> CommandContext = nullptr;
-	std::unique_ptr<TD3D12UploadBufferAllocator> UploadBufferAllocator = nullptr;
+	// Destroyed after the allocators
+	std::unique_ptr<XAllocationTrace> AllocationTrace = nullptr;
+
+	std::unique_ptr<D3D12CommandContext> CommandContext = nullptr;
+
+	std::unique_ptr<D3D12ComputeContext> ComputeContext = nullptr;
+
+	std::unique_ptr<D3D12UploadBufferAllocator> UploadBufferAllocator = nullptr;
+
+	std::unique_ptr<D3D12DefaultBufferAllocator> DefaultBufferAllocator = nullptr;
+
+	std::unique_ptr<D3D3TextureResourceAllocator> TextureResourceAllocator = nullptr;
+
+	// Destroyed before the upload allocator its staging memory comes from
+	std::unique_ptr<D3D12UploadManager> UploadManager = nullptr;
 
-	std::unique_ptr<TD3D12DefaultBufferAllocator> DefaultBufferAllocator = nullptr;
+	std::unique_ptr<D3D12HeapSlotAllocator> RTVHeapSlotAllocator = nullptr;
 
-	std::unique_ptr<TD3D3TextureResourceAllocator> TextureResourceAllocator = nullptr;
+	std::unique_ptr<D3D12HeapSlotAllocator> DSVHeapSlotAllocator = nullptr;
 
-	std::unique_ptr<TD3D12HeapSlotAllocator> RTVHeapSlotAllocator = nullptr;
+	std::unique_ptr<D3D12HeapSlotAllocator> SRVHeapSlotAllocator = nullptr;
 
-	std::unique_ptr<TD3D12HeapSlotAllocator> DSVHeapSlotAllocator = nullptr;
+	std::unique_ptr<D3D12PipelineStateCache> PipelineStateCache = nullptr;
 
-	std::unique_ptr<TD3D12HeapSlotAllocator> SRVHeapSlotAllocator = nullptr;
-};
+	std::unique_ptr<XShaderCache> ShaderCache = nullptr;
+};
\ No newline at end of file
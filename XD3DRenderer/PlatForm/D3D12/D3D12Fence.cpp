@@ -0,0 +1,80 @@
+#include "D3D12Fence.h"
+
+D3D12Fence::D3D12Fence(ID3D12Device* InDevice)
+{
+	ThrowIfFailed(InDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence)));
+	SetDebugName(Fence.Get(), L"D3D12Fence");
+}
+
+D3D12Fence::~D3D12Fence()
+{
+
+}
+
+uint64_t D3D12Fence::GetCompletedValue()
+{
+	return Fence->GetCompletedValue();
+}
+
+uint64_t D3D12Fence::Signal(ID3D12CommandQueue* CommandQueue)
+{
+	const uint64_t SignaledValue = CurrentValue;
+
+	ThrowIfFailed(CommandQueue->Signal(Fence.Get(), SignaledValue));
+	CurrentValue++;
+
+	return SignaledValue;
+}
+
+void D3D12Fence::WaitForValue(uint64_t FenceValue)
+{
+	GetWaiter().Wait(this, FenceValue);
+}
+
+XFenceWaiter& D3D12Fence::GetWaiter()
+{
+	static D3D12WaitEventBackend Backend;
+	static XFenceWaiter Waiter(&Backend);
+
+	return Waiter;
+}
+
+void* D3D12WaitEventBackend::CreateWaitEvent()
+{
+	// Auto-reset, a satisfied wait resets it for the next one
+	HANDLE EventHandle = CreateEvent(nullptr, false, false, nullptr);
+	if (EventHandle == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	return EventHandle;
+}
+
+void D3D12WaitEventBackend::DestroyWaitEvent(void* Event)
+{
+	CloseHandle(Event);
+}
+
+void D3D12WaitEventBackend::SetEventOnCompletion(XFence* Fence, uint64_t FenceValue, void* Event)
+{
+	ThrowIfFailed(static_cast<D3D12Fence*>(Fence)->GetD3DFence()->SetEventOnCompletion(FenceValue, Event));
+}
+
+uint32_t D3D12WaitEventBackend::WaitForEvents(void* const* Events, uint32_t Count, bool bWaitAll, uint32_t TimeoutMs)
+{
+	assert(Count <= MAXIMUM_WAIT_OBJECTS);
+
+	const DWORD Result = WaitForMultipleObjects(Count, Events, bWaitAll, TimeoutMs);
+	if (Result == WAIT_TIMEOUT)
+	{
+		return WaitTimeout;
+	}
+
+	if (Result == WAIT_FAILED)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	return bWaitAll ? 0 : Result - WAIT_OBJECT_0;
+}
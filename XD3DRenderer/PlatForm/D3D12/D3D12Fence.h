@@ -0,0 +1,45 @@
+#pragma once
+
+#include "D3D12Util.h"
+#include "../../Common/FenceWaiter.h"
+
+// Win32 events signaled by ID3D12Fence::SetEventOnCompletion
+class D3D12WaitEventBackend : public XWaitEventBackend
+{
+public:
+	virtual void* CreateWaitEvent() override;
+
+	virtual void DestroyWaitEvent(void* Event) override;
+
+	virtual void SetEventOnCompletion(XFence* Fence, uint64_t FenceValue, void* Event) override;
+
+	virtual uint32_t WaitForEvents(void* const* Events, uint32_t Count, bool bWaitAll, uint32_t TimeoutMs) override;
+};
+
+class D3D12Fence : public XFence
+{
+public:
+	D3D12Fence(ID3D12Device* InDevice);
+
+	~D3D12Fence();
+
+	virtual uint64_t GetCompletedValue() override;
+
+	virtual uint64_t GetCurrentValue() const override { return CurrentValue; }
+
+	// Signal CurrentValue on the queue and advance it, returns the signaled value
+	uint64_t Signal(ID3D12CommandQueue* CommandQueue);
+
+	// Block the CPU until the GPU has reached FenceValue, without an event if the cached completed value covers it
+	void WaitForValue(uint64_t FenceValue);
+
+	// Shared by every fence of the process, to wait for any or all of several D3D12Fence values
+	static XFenceWaiter& GetWaiter();
+
+	ID3D12Fence* GetD3DFence() { return Fence.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Fence> Fence = nullptr;
+
+	uint64_t CurrentValue = 1;
+};
@@ -2,20 +2,21 @@
 #include <assert.h>
 
 
-TD3D12HeapSlotAllocator::TD3D12HeapSlotAllocator(ID3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t NumDescriptorsPerHeap)
+D3D12HeapSlotAllocator::D3D12HeapSlotAllocator(ID3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t NumDescriptorsPerHeap)
 	:D3DDevice(InDevice),
 	HeapDesc(CreateHeapDesc(Type, NumDescriptorsPerHeap)),
-	DescriptorSize(D3DDevice->GetDescriptorHandleIncrementSize(HeapDesc.Type))
+	DescriptorSize(D3DDevice->GetDescriptorHandleIncrementSize(HeapDesc.Type)),
+	SlotCore(NumDescriptorsPerHeap)
 {
 
 }
 
-TD3D12HeapSlotAllocator::~TD3D12HeapSlotAllocator()
+D3D12HeapSlotAllocator::~D3D12HeapSlotAllocator()
 {
 
 }
 
-D3D12_DESCRIPTOR_HEAP_DESC TD3D12HeapSlotAllocator::CreateHeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t NumDescriptorsPerHeap)
+D3D12_DESCRIPTOR_HEAP_DESC D3D12HeapSlotAllocator::CreateHeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t NumDescriptorsPerHeap)
 {
 	D3D12_DESCRIPTOR_HEAP_DESC Desc = {};
 	Desc.Type = Type;
@@ -26,106 +27,85 @@ D3D12_DESCRIPTOR_HEAP_DESC TD3D12HeapSlotAllocator::CreateHeapDesc(D3D12_DESCRIP
 	return Desc;
 }
 
-void TD3D12HeapSlotAllocator::AllocateHeap()
+void D3D12HeapSlotAllocator::AllocateHeap()
 {
 	// Create a new descriptorHeap
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Heap;
 	ThrowIfFailed(D3DDevice->CreateDescriptorHeap(&HeapDesc, IID_PPV_ARGS(&Heap)));
-	SetDebugName(Heap.Get(), L"TD3D12HeapSlotAllocator Descriptor Heap");
+	SetDebugName(Heap.Get(), L"D3D12HeapSlotAllocator Descriptor Heap");
 
-	// Add an entry covering the entire heap.
 	DescriptorHandle HeapBase = Heap->GetCPUDescriptorHandleForHeapStart();
 	assert(HeapBase.ptr != 0);
 
 	HeapEntry Entry;
 	Entry.Heap = Heap;
-	Entry.FreeList.push_back({ HeapBase.ptr, HeapBase.ptr + (SIZE_T)HeapDesc.NumDescriptors * DescriptorSize });
-	
-	// Add the entry to HeapMap
+	Entry.HeapBase = HeapBase.ptr;
+
+	// Add the entry to HeapMap, all of its slots are free
 	HeapMap.push_back(Entry);
+
+	const uint32_t HeapIndex = SlotCore.AddHeap();
+	assert(HeapIndex == HeapMap.size() - 1);
 }
 
-TD3D12HeapSlotAllocator::HeapSlot TD3D12HeapSlotAllocator::AllocateHeapSlot()
+D3D12HeapSlotAllocator::HeapSlot D3D12HeapSlotAllocator::AllocateHeapSlot()
 {
-	// Find the entry with free list
-	int EntryIndex = -1;
-	for (int i = 0; i < HeapMap.size(); i++)
-	{
-		if (HeapMap[i].FreeList.size() > 0)
-		{
-			EntryIndex = i;
-			break;
-		}
-	}
+	XHeapSlotAllocatorCore::Slot CoreSlot;
 
-	// If all entries are full, create a new one
-	if (EntryIndex == -1)
+	// If all heaps are full, create a new one
+	if (!SlotCore.Allocate(CoreSlot))
 	{
 		AllocateHeap();
 
-		EntryIndex = int(HeapMap.size() -1);
+		bool Result = SlotCore.Allocate(CoreSlot);
+		assert(Result);
 	}
 
-	HeapEntry& Entry = HeapMap[EntryIndex];
-	assert(Entry.FreeList.size() > 0 );
-
-	// Allocate  a slot
-	FreeRange& Range = Entry.FreeList.front();
-	HeapSlot Slot = { (uint32_t)EntryIndex, Range.Start };
-
-	// Remove this range if all slot has been allocated.
-	Range.Start += DescriptorSize;
-	if (Range.Start == Range.End)
-	{
-		Entry.FreeList.pop_front();
-	}
+	const HeapEntry& Entry = HeapMap[CoreSlot.HeapIndex];
+	HeapSlot Slot = { CoreSlot.HeapIndex, { Entry.HeapBase + (SIZE_T)CoreSlot.SlotIndex * DescriptorSize } };
 
 	return Slot;
 }
 
-void TD3D12HeapSlotAllocator::FreeHeapSlot(const HeapSlot& Slot)
+void D3D12HeapSlotAllocator::FreeHeapSlot(const HeapSlot& Slot)
 {
 	assert(Slot.HeapIndex < HeapMap.size());
-	HeapEntry& Entry = HeapMap[Slot.HeapIndex];
+	const HeapEntry& Entry = HeapMap[Slot.HeapIndex];
 
-	FreeRange NewRange =
-	{
-		Slot.Handle.ptr,
-		Slot.Handle.ptr + DescriptorSize
-	};
+	assert(Slot.Handle.ptr >= Entry.HeapBase && (Slot.Handle.ptr - Entry.HeapBase) % DescriptorSize == 0);
+	const uint32_t SlotIndex = (uint32_t)((Slot.Handle.ptr - Entry.HeapBase) / DescriptorSize);
 
-	bool bFound = false;
-	for (auto Node = Entry.FreeList.begin(); Node != Entry.FreeList.end() && !bFound; Node++ )
-	{
-		FreeRange& Range = *Node;
-		assert(Range.Start < Range.End);
-
-		if (Range.Start == NewRange.End) //Merge NewRange and Range
-		{
-			Range.Start = NewRange.Start;
-			bFound = true;
-		}
-		else if (Range.End == NewRange.Start) // Merge Range and NewRange
-		{
-			Range.End = NewRange.End;
-			bFound = true;
-		}
-		else
-		{
-			assert(Range.End < NewRange.Start || Range.Start > NewRange.Start);
-			if (Range.Start > NewRange.Start) // Insert NewRange before Range
-			{
-				Entry.FreeList.insert(Node, NewRange);
-				bFound = true;
-			}
-		}
-	}
+	SlotCore.Deallocate(Slot.HeapIndex, SlotIndex);
+}
 
-	if (!bFound)
+D3D12HeapSlotAllocator::HeapSlot D3D12HeapSlotAllocator::AllocateHeapSlots(uint32_t Count)
+{
+	assert(Count > 0 && Count <= HeapDesc.NumDescriptors);
+
+	XHeapSlotAllocatorCore::Slot CoreSlot;
+
+	// If no heap has a free run that long, create a new one
+	if (!SlotCore.AllocateRange(Count, CoreSlot))
 	{
-		// Add  NewRange to tail
-		Entry.FreeList.push_back(NewRange);
+		AllocateHeap();
+
+		bool Result = SlotCore.AllocateRange(Count, CoreSlot);
+		assert(Result);
 	}
+
+	const HeapEntry& Entry = HeapMap[CoreSlot.HeapIndex];
+	HeapSlot Slot = { CoreSlot.HeapIndex, { Entry.HeapBase + (SIZE_T)CoreSlot.SlotIndex * DescriptorSize } };
+
+	return Slot;
 }
 
+void D3D12HeapSlotAllocator::FreeHeapSlots(const HeapSlot& FirstSlot, uint32_t Count)
+{
+	assert(FirstSlot.HeapIndex < HeapMap.size());
+	const HeapEntry& Entry = HeapMap[FirstSlot.HeapIndex];
 
+	assert(FirstSlot.Handle.ptr >= Entry.HeapBase && (FirstSlot.Handle.ptr - Entry.HeapBase) % DescriptorSize == 0);
+	const uint32_t SlotIndex = (uint32_t)((FirstSlot.Handle.ptr - Entry.HeapBase) / DescriptorSize);
+
+	SlotCore.DeallocateRange(FirstSlot.HeapIndex, SlotIndex, Count);
+}
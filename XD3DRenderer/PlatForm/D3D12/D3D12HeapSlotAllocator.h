@@ -1,7 +1,7 @@
 #pragma once
 
 #include "D3D12Util.h"
-#include <list>
+#include "../../Common/HeapSlotAllocatorCore.h"
 
 class D3D12HeapSlotAllocator
 {
@@ -16,16 +16,10 @@ public:
 	};
 
 private:
-	struct FreeRange 
-	{ 
-		DescriptorHandleRaw Start;
-		DescriptorHandleRaw End;
-	};
-
 	struct HeapEntry
 	{
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Heap = nullptr;
-		std::list<D3D12HeapSlotAllocator::FreeRange> FreeList;
+		DescriptorHandleRaw HeapBase = 0;
 
 		HeapEntry() { }
 	};
@@ -39,6 +33,14 @@ public:
 
 	void FreeHeapSlot(const HeapSlot& Slot);
 
+	// Count contiguous slots of one heap, returns the first one, the others follow every GetDescriptorSize() bytes.
+	// Count must not exceed the descriptors per heap.
+	HeapSlot AllocateHeapSlots(uint32_t Count);
+
+	void FreeHeapSlots(const HeapSlot& FirstSlot, uint32_t Count);
+
+	uint32_t GetDescriptorSize() const { return DescriptorSize; }
+
 private:
 	D3D12_DESCRIPTOR_HEAP_DESC CreateHeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t NumDescriptorsPerHeap);
 
@@ -51,5 +53,8 @@ private:
 
 	const uint32_t DescriptorSize;
 
+	// Slot occupancy of all heaps, indexed like HeapMap
+	XHeapSlotAllocatorCore SlotCore;
+
 	std::vector<HeapEntry> HeapMap;
-};
\ No newline at end of file
+};
@@ -12,6 +12,9 @@ D3D12BuddyAllocator::D3D12BuddyAllocator(ID3D12Device* InDevice, const Allocator
 
 D3D12BuddyAllocator::~D3D12BuddyAllocator()
 {
+	// The GPU is idle when allocators are destroyed, release the blocks still waiting for their fence
+	DeferredDeletionQueue.RetireAll([this](const D3D12BuddyBlockData& Block) { DeallocateInternal(Block); });
+
 	if (BackingResource)
 	{
 		delete BackingResource;
@@ -30,7 +33,7 @@ void D3D12BuddyAllocator::Initialize()
 	{
 		CD3DX12_HEAP_PROPERTIES HeapProperties(InitData.HeapType);
 		D3D12_HEAP_DESC Desc = {};
-		Desc.SizeInBytes = DEFAULT_POOL_SIZE;
+		Desc.SizeInBytes = InitData.PoolSize;
 		Desc.Properties = HeapProperties;
 		Desc.Alignment = 0;
 		Desc.Flags = InitData.HeapFlags;
@@ -42,7 +45,7 @@ void D3D12BuddyAllocator::Initialize()
 
 		BackingHeap = Heap;
 	}
-	else //ManualSubAllocation
+	else //ManualSubAllocation or TLSFSubAllocation
 	{
 		CD3DX12_HEAP_PROPERTIES HeapProperties(InitData.HeapType);
 		D3D12_RESOURCE_STATES HeapResourceStates;
@@ -55,7 +58,7 @@ void D3D12BuddyAllocator::Initialize()
 			HeapResourceStates = D3D12_RESOURCE_STATE_COMMON;
 		}
 
-		CD3DX12_RESOURCE_DESC BufferDesc = CD3DX12_RESOURCE_DESC::Buffer(DEFAULT_POOL_SIZE, InitData.ResourceFlags);
+		CD3DX12_RESOURCE_DESC BufferDesc = CD3DX12_RESOURCE_DESC::Buffer(InitData.PoolSize, InitData.ResourceFlags);
 
 		// Create committed resource, we will allocate sub regions on it.
 		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
@@ -77,276 +80,669 @@ void D3D12BuddyAllocator::Initialize()
 		}
 	}
 
-	// Initialize free blocks, add the free block for MaxOrder
-	MaxOrder = UnitSizeToOrder(SizeToUnitSize(DEFAULT_POOL_SIZE));
-
-	for (uint32_t i = 0; i <= MaxOrder; i++)
+	if (InitData.AllocationStrategy == EAllocationStrategy::TLSFSubAllocation)
 	{
-		FreeBlocks.emplace_back(std::set<uint32_t>());
+		TLSFCore.Initialize(InitData.PoolSize, MinBlockSize);
+	}
+	else
+	{
+		BuddyCore.Initialize(InitData.PoolSize, MinBlockSize);
 	}
-
-	FreeBlocks[MaxOrder].insert((uint32_t)0);
 }
 
-bool D3D12BuddyAllocator::AllocResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+bool D3D12BuddyAllocator::AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
 {
-	uint32_t SizeToAllocate = GetSizeToAllocate(Size, Alignment);
+	uint64_t AlignedOffsetFromResourceBase = 0;
 
-	if (CanAllocate(SizeToAllocate))
+	if (InitData.AllocationStrategy == EAllocationStrategy::TLSFSubAllocation)
 	{
-		// Allocate block
-		const uint32_t UnitSize = SizeToUnitSize(SizeToAllocate);
-		const uint32_t Order = UnitSizeToOrder(UnitSize);
-		const uint32_t Offset = AllocateBlock(Order); // This is the offset in MinBlockSize units
-		const uint32_t AllocSize = UnitSize * MinBlockSize;
-		TotalAllocSize += AllocSize;
-
-		//Calculate AlignedOffsetFromResourceBase
-		const uint32_t OffsetFromBaseOfResource = GetAllocOffsetInBytes(Offset);
-		uint32_t AlignedOffsetFromResourceBase = OffsetFromBaseOfResource;
-		if (Alignment != 0 && OffsetFromBaseOfResource % Alignment != 0)
+		XTLSFAllocatorCore::Allocation Allocation;
+		if (!TLSFCore.Allocate(Size, Alignment, Allocation))
 		{
-			AlignedOffsetFromResourceBase = AlignArbitrary(OffsetFromBaseOfResource, Alignment);
-
-			uint32_t Padding = AlignedOffsetFromResourceBase - OffsetFromBaseOfResource;
-			assert((Padding + Size) <= AllocSize);
+			return false;
 		}
-		assert((AlignedOffsetFromResourceBase % Alignment) == 0);
-
-		// Save allocation info to ResourceLocation
-		ResourceLocation.SetType(D3D12ResourceLocation::EResourceLocationType::SubAllocation);
-		ResourceLocation.BlockData.Order = Order;
-		ResourceLocation.BlockData.Offset = Offset;
-		ResourceLocation.BlockData.ActualUsedSize = Size;
-		ResourceLocation.Allocator = this;
 
-		if (InitData.AllocationStrategy == EAllocationStrategy::ManualSubAllocation)
+		ResourceLocation.BlockData.BlockIndex = Allocation.BlockIndex;
+		AlignedOffsetFromResourceBase = Allocation.AlignedOffsetInBytes;
+	}
+	else
+	{
+		XBuddyAllocatorCore::Allocation Allocation;
+		if (!BuddyCore.Allocate(Size, Alignment, Allocation))
 		{
-			ResourceLocation.UnderlyingResource = BackingResource;
-			ResourceLocation.OffsetFromBaseOfResource = AlignedOffsetFromResourceBase;
-			ResourceLocation.GPUVirtualAddress = BackingResource->GPUVirtualAddress + AlignedOffsetFromResourceBase;
-
-			if (InitData.HeapType == D3D12_HEAP_TYPE_UPLOAD)
-			{
-				ResourceLocation.MappedAddress = ((uint8_t*)BackingResource->MappedBaseAddress + AlignedOffsetFromResourceBase);
-			}
+			return false;
 		}
-		else
-		{
-			ResourceLocation.OffsetFromBaseOfHeap = AlignedOffsetFromResourceBase;
 
-			// Place resource are initialized by caller
-		}
+		ResourceLocation.BlockData.Order = Allocation.Order;
+		ResourceLocation.BlockData.Offset = Allocation.Offset;
+		AlignedOffsetFromResourceBase = Allocation.AlignedOffsetInBytes;
+	}
 
-		return true;
+	// Save allocation info to ResourceLocation
+	ResourceLocation.SetType(D3D12ResourceLocation::EResourceLocationType::SubAllocation);
+	ResourceLocation.BlockData.ActualUsedSize = Size;
+	ResourceLocation.BlockData.Alignment = Alignment;
+	ResourceLocation.Allocator = this;
+
+	if (InitData.AllocationStrategy != EAllocationStrategy::PlacedResource)
+	{
+		ResourceLocation.UnderlyingResource = BackingResource;
+		ResourceLocation.OffsetFromBaseOfResource = AlignedOffsetFromResourceBase;
+		ResourceLocation.GPUVirtualAddress = BackingResource->GPUVirtualAddress + AlignedOffsetFromResourceBase;
+
+		if (InitData.HeapType == D3D12_HEAP_TYPE_UPLOAD)
+		{
+			ResourceLocation.MappedAddress = ((uint8_t*)BackingResource->MappedBaseAddress + AlignedOffsetFromResourceBase);
+		}
 	}
 	else
 	{
-		return false;
+		ResourceLocation.OffsetFromBaseOfHeap = AlignedOffsetFromResourceBase;
+
+		// Place resource are initialized by caller
+	}
+
+	return true;
+}
+
+void D3D12BuddyAllocator::Deallocate(D3D12ResourceLocation& ResourceLocation)
+{
+	if (ResourceLocation.RelocatableIndex != UINT32_MAX)
+	{
+		UnregisterRelocatable(ResourceLocation);
 	}
+
+	// The block may still be used by the frame being recorded, tag it with the fence value of this frame
+	const uint64_t FenceValue = InitData.Fence ? InitData.Fence->GetCurrentValue() : 0;
+
+	DeferredDeletionQueue.Enqueue(ResourceLocation.BlockData, FenceValue);
 }
 
-uint32_t D3D12BuddyAllocator::GetSizeToAllocate(uint32_t Size, uint32_t Alignment)
+void D3D12BuddyAllocator::CleanUpAllocations()
 {
-	uint32_t SizeToAllocate = Size;
+	// Only reclaim the blocks whose frame has been completed by the GPU
+	const uint64_t CompletedFenceValue = InitData.Fence ? InitData.Fence->GetCompletedValue() : UINT64_MAX;
 
-	// If the alignment doesn't match the block size
-	if (Alignment != 0 && MinBlockSize % Alignment != 0)
+	DeferredDeletionQueue.Retire(CompletedFenceValue, [this](const D3D12BuddyBlockData& Block) { DeallocateInternal(Block); });
+}
+
+void D3D12BuddyAllocator::DeallocateInternal(const D3D12BuddyBlockData& Block)
+{
+	if (InitData.AllocationStrategy == EAllocationStrategy::TLSFSubAllocation)
 	{
-		SizeToAllocate = Size + Alignment;
+		TLSFCore.Deallocate(Block.BlockIndex, Block.ActualUsedSize);
 	}
+	else
+	{
+		BuddyCore.Deallocate(Block.Offset, Block.Order, Block.ActualUsedSize);
+	}
+
+	if (InitData.AllocationStrategy == EAllocationStrategy::PlacedResource)
+	{
+		// Release place resource
+		assert(Block.PlacedResource != nullptr);
 
-	return SizeToAllocate;
+		delete Block.PlacedResource;
+	}
 }
 
-bool D3D12BuddyAllocator::CanAllocate(uint32_t SizeToAllocate)
+XAllocatorStats D3D12BuddyAllocator::GetStats() const
 {
-	if (TotalAllocSize == DEFAULT_POOL_SIZE)
+	if (InitData.AllocationStrategy == EAllocationStrategy::TLSFSubAllocation)
 	{
-		return false;
+		return TLSFCore.GetStats();
+	}
+	else
+	{
+		return BuddyCore.GetStats();
 	}
+}
+
+uint64_t D3D12BuddyAllocator::GetAllocatedSize() const
+{
+	if (InitData.AllocationStrategy == EAllocationStrategy::TLSFSubAllocation)
+	{
+		return TLSFCore.GetTotalAllocSize();
+	}
+	else
+	{
+		return BuddyCore.GetTotalAllocSize();
+	}
+}
+
+bool D3D12BuddyAllocator::IsEmpty() const
+{
+	return GetStats().AllocationCount == 0 && DeferredDeletionQueue.IsEmpty();
+}
+
+void D3D12BuddyAllocator::RegisterRelocatable(D3D12ResourceLocation& ResourceLocation, const std::function<void(D3D12ResourceLocation&)>& Callback)
+{
+	assert(InitData.AllocationStrategy != EAllocationStrategy::PlacedResource);
+	assert(ResourceLocation.Allocator == this && ResourceLocation.RelocatableIndex == UINT32_MAX);
+
+	ResourceLocation.RelocationCallback = Callback;
+	ResourceLocation.RelocatableIndex = (uint32_t)RelocatableLocations.size();
+	RelocatableLocations.push_back(&ResourceLocation);
+}
+
+void D3D12BuddyAllocator::UnregisterRelocatable(D3D12ResourceLocation& ResourceLocation)
+{
+	const uint32_t Index = ResourceLocation.RelocatableIndex;
+	assert(Index < RelocatableLocations.size() && RelocatableLocations[Index] == &ResourceLocation);
+
+	// Swap with the last one to keep the array packed
+	D3D12ResourceLocation* LastLocation = RelocatableLocations.back();
+	RelocatableLocations[Index] = LastLocation;
+	LastLocation->RelocatableIndex = Index;
+	RelocatableLocations.pop_back();
+
+	ResourceLocation.RelocatableIndex = UINT32_MAX;
+}
+
+D3D12MultiBuddyAllocator::D3D12MultiBuddyAllocator(ID3D12Device* InDevice, const D3D12BuddyAllocator::AllocatorInitData& InInitData)
+	:Device(InDevice), InitData(InInitData)
+{
+
+}
 
-	uint32_t BlockSize = DEFAULT_POOL_SIZE;
+D3D12MultiBuddyAllocator::~D3D12MultiBuddyAllocator()
+{
+
+}
 
-	for (int i = (int)FreeBlocks.size() - 1; i >= 0; i--)
+bool D3D12MultiBuddyAllocator::AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+{
+	for (auto& Pool : Pools) // Try to use existing allocators 
 	{
-		if (FreeBlocks[i].size() && BlockSize >= SizeToAllocate)
+		if (Pool.Allocator->AllocResource(Size, Alignment, ResourceLocation))
 		{
+			Pool.IdleFrameCount = 0;
+			Counters.RecordAllocation(Size);
+
 			return true;
 		}
+	}
+
+	// Allocations larger than a regular pool get a dedicated one, rounded up to a power of two
+	uint64_t PoolSize = InitData.PoolSize;
+	const uint64_t SizeToAllocate = Size + Alignment;
+	if (SizeToAllocate > PoolSize)
+	{
+		PoolSize = 1ull << BitHelper::CeilLog2(SizeToAllocate);
 
-		// Halve the block size;
-		BlockSize = BlockSize >> 1;
+		if (PoolSize > MAX_POOL_SIZE)
+		{
+			return false;
+		}
+	}
 
-		if (BlockSize < SizeToAllocate) return false;
+	if (!FitsInBudget(PoolSize))
+	{
+		return false;
 	}
-	return false;
+
+	// Create new allocator
+	D3D12BuddyAllocator::AllocatorInitData PoolInitData = InitData;
+	PoolInitData.PoolSize = PoolSize;
+
+	Pool NewPool;
+	NewPool.Allocator = std::make_shared<D3D12BuddyAllocator>(Device, PoolInitData);
+	Pools.push_back(NewPool);
+	TotalPoolSize += PoolSize;
+
+	bool Result = NewPool.Allocator->AllocResource(Size, Alignment, ResourceLocation);
+	assert(Result);
+
+	Counters.RecordAllocation(Size);
+
+	return true;
 }
 
-uint32_t D3D12BuddyAllocator::AllocateBlock(uint32_t Order)
+bool D3D12MultiBuddyAllocator::FitsInBudget(uint64_t Size)
 {
-	uint32_t Offset;
-
-	if (Order > MaxOrder)
+	if (InitData.MemoryBudget == 0 || GetTotalSize() + Size <= InitData.MemoryBudget)
 	{
-		assert(false);
+		return true;
 	}
 
-	if (FreeBlocks[Order].size() == 0)
+	// Give back the empty pools before refusing
+	ReleaseEmptyPools(0, false);
+
+	return GetTotalSize() + Size <= InitData.MemoryBudget;
+}
+
+bool D3D12MultiBuddyAllocator::AllocStandAloneResource(const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_RESOURCE_STATES ResourceState, D3D12ResourceLocation& ResourceLocation)
+{
+	// Committed resources take whole 64KB pages, or more for MSAA textures
+	const D3D12_RESOURCE_ALLOCATION_INFO Info = Device->GetResourceAllocationInfo(0, 1, &ResourceDesc);
+	if (!FitsInBudget(Info.SizeInBytes))
 	{
-		// No free nodes in the requested pool.  Try to find a higher-order block and split it.  
-		uint32_t Left = AllocateBlock(Order + 1);
+		return false;
+	}
+
+	CD3DX12_HEAP_PROPERTIES HeapProperties(InitData.HeapType);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&HeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&ResourceDesc,
+		ResourceState,
+		nullptr,
+		IID_PPV_ARGS(&Resource)));
+
+	D3D12Resource* NewResource = new D3D12Resource(Resource, ResourceState);
+	ResourceLocation.UnderlyingResource = NewResource;
+	ResourceLocation.SetType(D3D12ResourceLocation::EResourceLocationType::StandAlone);
+	ResourceLocation.OffsetFromBaseOfResource = 0;
+	ResourceLocation.GPUVirtualAddress = NewResource->GPUVirtualAddress;
+	ResourceLocation.StandAloneAllocator = this;
+	ResourceLocation.BlockData.ActualUsedSize = Info.SizeInBytes;
+
+	StandAloneSize += Info.SizeInBytes;
+	StandAloneCount++;
+	Counters.RecordAllocation(ResourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? ResourceDesc.Width : Info.SizeInBytes);
 
-		uint32_t UnitSize = OrderToUnitSize(Order);
+	return true;
+}
+
+void D3D12MultiBuddyAllocator::DeallocateStandAlone(D3D12ResourceLocation& ResourceLocation)
+{
+	assert(ResourceLocation.StandAloneAllocator == this && StandAloneCount > 0 && StandAloneSize >= ResourceLocation.BlockData.ActualUsedSize);
 
-		uint32_t Right = Left + UnitSize;
+	StandAloneSize -= ResourceLocation.BlockData.ActualUsedSize;
+	StandAloneCount--;
 
-		FreeBlocks[Order].insert(Right); // Add the right block to the free pool  
+	ResourceLocation.StandAloneAllocator = nullptr;
+}
 
-		Offset = Left; // Return the left block  
+void D3D12MultiBuddyAllocator::CleanUpAllocations()
+{
+	// Sampled before the retired blocks are given back
+	uint64_t AllocatedSize = 0;
+	for (const auto& Pool : Pools)
+	{
+		AllocatedSize += Pool.Allocator->GetAllocatedSize();
 	}
-	else
+	Counters.RecordUsage(AllocatedSize);
+
+	for (auto& Pool : Pools)
 	{
-		auto It = FreeBlocks[Order].cbegin();
-		Offset = *It;
+		Pool.Allocator->CleanUpAllocations();
 
-		// Remove the block from the free list
-		FreeBlocks[Order].erase(*It);
+		if (Pool.Allocator->IsEmpty())
+		{
+			Pool.IdleFrameCount++;
+		}
+		else
+		{
+			Pool.IdleFrameCount = 0;
+		}
 	}
 
-	return Offset;
+	if (InitData.PoolReleaseFrameCount != 0)
+	{
+		// Keep one regular pool so steady small allocations don't recreate it over and over
+		ReleaseEmptyPools(InitData.PoolReleaseFrameCount, true);
+	}
 }
 
-void D3D12BuddyAllocator::Deallocate(D3D12ResourceLocation& ResourceLocation)
+XAllocatorStats D3D12MultiBuddyAllocator::GetStats() const
 {
-	DeferredDeletionQueue.push_back(ResourceLocation.BlockData);
+	XAllocatorStats Stats;
+	for (const auto& Pool : Pools)
+	{
+		Stats.Accumulate(Pool.Allocator->GetStats());
+	}
+
+	XAllocationCounters LifetimeCounters = Counters;
+	LifetimeCounters.RecordUsage(Stats.AllocatedSize);
+	LifetimeCounters.CopyTo(Stats);
+
+	Stats.StandAloneSize = StandAloneSize;
+	Stats.StandAloneCount = StandAloneCount;
+
+	return Stats;
 }
 
-void D3D12BuddyAllocator::CleanUpAllocations()
+void D3D12MultiBuddyAllocator::ReleaseEmptyPools(uint32_t MinIdleFrameCount, bool bKeepRegularPool)
 {
-	for (int32_t i = 0; i < DeferredDeletionQueue.size(); i++)
+	uint32_t RegularPoolCount = 0;
+	for (const auto& Pool : Pools)
 	{
-		const D3D12BuddyBlockData& Block = DeferredDeletionQueue[i];
-
-		DeallocateInternal(Block);
+		if (Pool.Allocator->GetPoolSize() == InitData.PoolSize)
+		{
+			RegularPoolCount++;
+		}
 	}
 
-	// clear out all of the released blocks, don't allow the array to shrink
-	DeferredDeletionQueue.clear();
+	for (auto Iter = Pools.begin(); Iter != Pools.end();)
+	{
+		const bool bRegularPool = Iter->Allocator->GetPoolSize() == InitData.PoolSize;
+
+		if (!Iter->Allocator->IsEmpty() || Iter->IdleFrameCount < MinIdleFrameCount || (bKeepRegularPool && bRegularPool && RegularPoolCount == 1))
+		{
+			++Iter;
+			continue;
+		}
+
+		if (bRegularPool)
+		{
+			RegularPoolCount--;
+		}
+
+		TotalPoolSize -= Iter->Allocator->GetPoolSize();
+		Iter = Pools.erase(Iter);
+	}
 }
 
-void D3D12BuddyAllocator::DeallocateInternal(const D3D12BuddyBlockData& Block)
+uint64_t D3D12MultiBuddyAllocator::Defragment(XCopyQueue& CopyQueue, uint64_t MaxBytes)
 {
-	DeallocateBlock(Block.Offset, Block.Order);
-
-	uint32_t Size = OrderToUnitSize(Block.Order) * MinBlockSize;
-	TotalAllocSize -= Size;
+	// Placed resources can't be moved with buffer copies
+	if (InitData.AllocationStrategy == D3D12BuddyAllocator::EAllocationStrategy::PlacedResource)
+	{
+		return 0;
+	}
 
-	if (InitData.AllocationStrategy == EAllocationStrategy::PlacedResource)
+	std::vector<XDefragmenter::Pool> DefragPools(Pools.size());
+	std::vector<XDefragmenter::Candidate> Candidates;
+	for (uint32_t PoolIndex = 0; PoolIndex < (uint32_t)Pools.size(); PoolIndex++)
 	{
-		// Release place resource
-		assert(Block.PlacedResource != nullptr);
+		D3D12BuddyAllocator* Allocator = Pools[PoolIndex].Allocator.get();
 
-		delete Block.PlacedResource;
+		DefragPools[PoolIndex].Stats = Allocator->GetStats();
+		DefragPools[PoolIndex].Resource = Allocator->GetBackingResource();
+
+		for (D3D12ResourceLocation* Location : Allocator->GetRelocatableLocations())
+		{
+			XDefragmenter::Candidate Candidate;
+			Candidate.Handle = Location;
+			Candidate.PoolIndex = PoolIndex;
+			Candidate.Offset = Location->OffsetFromBaseOfResource;
+			Candidate.Size = Location->BlockData.ActualUsedSize;
+			Candidates.push_back(Candidate);
+		}
 	}
+
+	D3D12ResourceLocation NewLocation;
+
+	auto AllocateFunc = [this, &NewLocation](uint32_t DstPoolIndex, const XDefragmenter::Candidate& Candidate, uint64_t& OutOffset)
+	{
+		const D3D12ResourceLocation* Location = (const D3D12ResourceLocation*)Candidate.Handle;
+		if (!Pools[DstPoolIndex].Allocator->AllocResource(Location->BlockData.ActualUsedSize, Location->BlockData.Alignment, NewLocation))
+		{
+			return false;
+		}
+
+		Pools[DstPoolIndex].IdleFrameCount = 0;
+		OutOffset = NewLocation.OffsetFromBaseOfResource;
+
+		return true;
+	};
+
+	auto RelocateFunc = [&NewLocation](const XDefragmenter::Candidate& Candidate)
+	{
+		D3D12ResourceLocation* Location = (D3D12ResourceLocation*)Candidate.Handle;
+		const std::function<void(D3D12ResourceLocation&)> Callback = Location->RelocationCallback;
+
+		// The old block is reused once the GPU has finished the copy
+		Location->Allocator->Deallocate(*Location);
+
+		Location->Allocator = NewLocation.Allocator;
+		Location->BlockData = NewLocation.BlockData;
+		Location->UnderlyingResource = NewLocation.UnderlyingResource;
+		Location->OffsetFromBaseOfResource = NewLocation.OffsetFromBaseOfResource;
+		Location->GPUVirtualAddress = NewLocation.GPUVirtualAddress;
+		Location->MappedAddress = NewLocation.MappedAddress;
+
+		// The block now belongs to Location
+		NewLocation.SetType(D3D12ResourceLocation::EResourceLocationType::Undefined);
+		NewLocation.Allocator = nullptr;
+
+		Location->Allocator->RegisterRelocatable(*Location, Callback);
+
+		if (Callback)
+		{
+			Callback(*Location);
+		}
+	};
+
+	return Defragmenter.Step(DefragPools, Candidates, CopyQueue, MaxBytes, AllocateFunc, RelocateFunc);
 }
 
-void D3D12BuddyAllocator::DeallocateBlock(uint32_t Offset, uint32_t Order)
+D3D12SlabAllocator::D3D12SlabAllocator(D3D12MultiBuddyAllocator* InAllocator, XFence* InFence)
+	:Allocator(InAllocator), Fence(InFence)
 {
-	// Get buddy block
-	uint32_t Size = OrderToUnitSize(Order);
-	uint32_t Buddy = GetBuddyOffset(Offset, Size);
+	SlabCore.Initialize(SLAB_MIN_CLASS_SIZE, SLAB_MAX_CLASS_SIZE);
+}
 
-	auto It = FreeBlocks[Order].find(Buddy);
-	if (It != FreeBlocks[Order].end()) // If buddy block is free, merge it
+D3D12SlabAllocator::~D3D12SlabAllocator()
+{
+	// The GPU is idle when allocators are destroyed, the slabs themselves are released with Slabs
+	DeferredDeletionQueue.RetireAll([this](const XSlabAllocatorCore::Allocation& Slot) { SlabCore.Deallocate(Slot.SlabIndex, Slot.SlotIndex); });
+}
+
+bool D3D12SlabAllocator::AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+{
+	const uint32_t SizeClass = SlabCore.GetSizeClass(Size, Alignment);
+	if (SizeClass == XSlabAllocatorCore::InvalidIndex)
 	{
-		// Deallocate merged blocks
-		DeallocateBlock(min(Offset, Buddy), Order + 1);
+		return false;
+	}
+
+	XSlabAllocatorCore::Allocation Slot;
+	if (!SlabCore.Allocate(SizeClass, Slot))
+	{
+		// All slabs of this class are full, carve a new one from the buddy allocator.
+		// Aligning the slab to the class size aligns all of its slots.
+		const uint32_t SlabIndex = SlabCore.AddSlab(SizeClass);
+		if (SlabIndex >= Slabs.size())
+		{
+			Slabs.resize(SlabIndex + 1);
+		}
+
+		Slabs[SlabIndex] = std::make_unique<D3D12ResourceLocation>();
+		if (!Allocator->AllocResource(SlabCore.GetSlabSize(SizeClass), SlabCore.GetClassSize(SizeClass), *Slabs[SlabIndex]))
+		{
+			SlabCore.RemoveSlab(SlabIndex);
+			Slabs[SlabIndex].reset();
+
+			return false;
+		}
 
-		// Remove the buddy from the free list  
-		FreeBlocks[Order].erase(*It);
+		bool Result = SlabCore.Allocate(SizeClass, Slot);
+		assert(Result);
 	}
-	else
+
+	const D3D12ResourceLocation& SlabLocation = *Slabs[Slot.SlabIndex];
+
+	ResourceLocation.SetType(D3D12ResourceLocation::EResourceLocationType::SlabAllocation);
+	ResourceLocation.SlabAllocator = this;
+	ResourceLocation.BlockData.SlabIndex = Slot.SlabIndex;
+	ResourceLocation.BlockData.SlotIndex = Slot.SlotIndex;
+	ResourceLocation.BlockData.ActualUsedSize = Size;
+	ResourceLocation.BlockData.Alignment = Alignment;
+
+	ResourceLocation.UnderlyingResource = SlabLocation.UnderlyingResource;
+	ResourceLocation.OffsetFromBaseOfResource = SlabLocation.OffsetFromBaseOfResource + Slot.OffsetInSlab;
+	ResourceLocation.GPUVirtualAddress = SlabLocation.GPUVirtualAddress + Slot.OffsetInSlab;
+	if (SlabLocation.MappedAddress)
 	{
-		// Add the block to the free list
-		FreeBlocks[Order].insert(Offset);
+		ResourceLocation.MappedAddress = (uint8_t*)SlabLocation.MappedAddress + Slot.OffsetInSlab;
 	}
+
+	return true;
 }
 
-D3D12MultiBuddyAllocator::D3D12MultiBuddyAllocator(ID3D12Device* InDevice, const D3D12BuddyAllocator::AllocatorInitData& InInitData)
-	:Device(InDevice), InitData(InInitData)
+void D3D12SlabAllocator::Deallocate(D3D12ResourceLocation& ResourceLocation)
 {
+	XSlabAllocatorCore::Allocation Slot;
+	Slot.SlabIndex = ResourceLocation.BlockData.SlabIndex;
+	Slot.SlotIndex = ResourceLocation.BlockData.SlotIndex;
+
+	// Same as D3D12BuddyAllocator, the slot may still be used by the frame being recorded
+	const uint64_t FenceValue = Fence ? Fence->GetCurrentValue() : 0;
 
+	DeferredDeletionQueue.Enqueue(Slot, FenceValue);
 }
 
-D3D12MultiBuddyAllocator::~D3D12MultiBuddyAllocator()
+void D3D12SlabAllocator::CleanUpAllocations()
 {
+	const uint64_t CompletedFenceValue = Fence ? Fence->GetCompletedValue() : UINT64_MAX;
 
+	DeferredDeletionQueue.Retire(CompletedFenceValue, [this](const XSlabAllocatorCore::Allocation& Slot) { DeallocateInternal(Slot); });
 }
 
-bool D3D12MultiBuddyAllocator::AllocResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+void D3D12SlabAllocator::DeallocateInternal(const XSlabAllocatorCore::Allocation& Slot)
 {
-	for (auto& Allocator : Allocators) // Try to use existing allocators 
+	if (!SlabCore.Deallocate(Slot.SlabIndex, Slot.SlotIndex))
 	{
-		if (Allocator->AllocResource(Size, Alignment, ResourceLocation))
-		{
-			return true;
-		}
+		return;
 	}
 
-	// Create new allocator
-	auto Allocator = std::make_shared<D3D12BuddyAllocator>(Device, InitData);
-	Allocators.push_back(Allocator);
-
-	bool Result = Allocator->AllocResource(Size, Alignment, ResourceLocation);
-	assert(Result);
+	// Keep one empty slab per class so a steady flow of small buffers doesn't recreate it every frame
+	const uint32_t SizeClass = SlabCore.GetSlabSizeClass(Slot.SlabIndex);
+	if (SlabCore.GetEmptySlabCount(SizeClass) > 1)
+	{
+		SlabCore.RemoveSlab(Slot.SlabIndex);
 
-	return true;
+		// Goes through the deferred deletion of the buddy allocator
+		Slabs[Slot.SlabIndex].reset();
+	}
 }
 
-void D3D12MultiBuddyAllocator::CleanUpAllocations()
+// The location records its deallocation when released
+static void RecordAllocation(XAllocationTrace* Trace, EAllocationTraceChannel Channel, uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
 {
-	for (auto& Allocator : Allocators)
+	if (Trace && Trace->IsRecording())
 	{
-		Allocator->CleanUpAllocations();
+		ResourceLocation.Trace = Trace;
+		ResourceLocation.TraceId = Trace->RecordAllocate((uint8_t)Channel, Size, Alignment);
 	}
 }
 
-D3D12UploadBufferAllocator::D3D12UploadBufferAllocator(ID3D12Device* InDevice)
+D3D12UploadBufferAllocator::D3D12UploadBufferAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize, uint64_t InMemoryBudget)
 {
 	D3D12BuddyAllocator::AllocatorInitData InitData;
 	InitData.AllocationStrategy = D3D12BuddyAllocator::EAllocationStrategy::ManualSubAllocation;
 	InitData.HeapType = D3D12_HEAP_TYPE_UPLOAD;
 	InitData.ResourceFlags = D3D12_RESOURCE_FLAG_NONE;
+	InitData.Fence = InFence;
+	InitData.PoolSize = InPoolSize;
+	InitData.MemoryBudget = InMemoryBudget;
 
 	Allocator = std::make_unique<D3D12MultiBuddyAllocator>(InDevice, InitData);
 
+	SlabAllocator = std::make_unique<D3D12SlabAllocator>(Allocator.get(), InFence);
+
 	D3DDevice = InDevice;
+
+	// The ring relies on the frame fence to know when a segment can be overwritten
+	if (InFence)
+	{
+		CreateTransientRingBuffer();
+
+		TransientRing.Initialize(TRANSIENT_UPLOAD_SEGMENT_SIZE, TRANSIENT_UPLOAD_SEGMENT_COUNT, InFence);
+	}
+}
+
+D3D12UploadBufferAllocator::~D3D12UploadBufferAllocator()
+{
+	if (TransientRingBuffer)
+	{
+		delete TransientRingBuffer;
+	}
+}
+
+void D3D12UploadBufferAllocator::CreateTransientRingBuffer()
+{
+	CD3DX12_HEAP_PROPERTIES HeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC BufferDesc = CD3DX12_RESOURCE_DESC::Buffer(TRANSIENT_UPLOAD_SEGMENT_SIZE * TRANSIENT_UPLOAD_SEGMENT_COUNT);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+	ThrowIfFailed(D3DDevice->CreateCommittedResource(
+		&HeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&BufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&Resource)));
+
+	Resource->SetName(L"D3D12UploadBufferAllocator TransientRingBuffer");
+
+	TransientRingBuffer = new D3D12Resource(Resource, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Upload heaps can stay mapped for their whole lifetime
+	TransientRingBuffer->Map();
+}
+
+void* D3D12UploadBufferAllocator::AllocUploadResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+{
+	if (!SlabAllocator->AllocResource(Size, Alignment, ResourceLocation) && !Allocator->AllocResource(Size, Alignment, ResourceLocation))
+	{
+		return nullptr;
+	}
+
+	RecordAllocation(Trace, EAllocationTraceChannel::Upload, Size, Alignment, ResourceLocation);
+
+	return ResourceLocation.MappedAddress;
 }
 
-void* D3D12UploadBufferAllocator::AllocUploadResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+void* D3D12UploadBufferAllocator::AllocTransientUploadResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
 {
-	Allocator->AllocResource(Size, Alignment, ResourceLocation);
+	uint64_t Offset = TransientRingBuffer ? TransientRing.Allocate(Size, Alignment) : XLinearRingAllocatorCore::InvalidOffset;
+
+	if (Offset == XLinearRingAllocatorCore::InvalidOffset)
+	{
+		return AllocUploadResource(Size, Alignment, ResourceLocation);
+	}
+
+	ResourceLocation.SetType(D3D12ResourceLocation::EResourceLocationType::Transient);
+	ResourceLocation.UnderlyingResource = TransientRingBuffer;
+	ResourceLocation.OffsetFromBaseOfResource = Offset;
+	ResourceLocation.GPUVirtualAddress = TransientRingBuffer->GPUVirtualAddress + Offset;
+	ResourceLocation.MappedAddress = (uint8_t*)TransientRingBuffer->MappedBaseAddress + Offset;
 
 	return ResourceLocation.MappedAddress;
 }
 
 void D3D12UploadBufferAllocator::CleanUpAllocations()
 {
+	if (Trace)
+	{
+		Trace->RecordCleanUp((uint8_t)EAllocationTraceChannel::Upload);
+	}
+
+	// First, the slabs released here are then retired by the buddy allocator
+	SlabAllocator->CleanUpAllocations();
+
 	Allocator->CleanUpAllocations();
 }
 
+void D3D12UploadBufferAllocator::EndFrame()
+{
+	if (TransientRingBuffer)
+	{
+		TransientRing.EndFrame();
+	}
+}
 
 
-D3D12DefaultBufferAllocator::D3D12DefaultBufferAllocator(ID3D12Device* InDevice)
+
+D3D12DefaultBufferAllocator::D3D12DefaultBufferAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize, uint64_t InMemoryBudget)
 {
 	{
 		D3D12BuddyAllocator::AllocatorInitData InitData;
-		InitData.AllocationStrategy = D3D12BuddyAllocator::EAllocationStrategy::ManualSubAllocation;
+		InitData.AllocationStrategy = D3D12BuddyAllocator::EAllocationStrategy::TLSFSubAllocation;  // Mixed size vertex and index buffers
 		InitData.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 		InitData.ResourceFlags = D3D12_RESOURCE_FLAG_NONE;
+		InitData.Fence = InFence;
+		InitData.PoolSize = InPoolSize;
+		InitData.MemoryBudget = InMemoryBudget;
 
 		Allocator = std::make_unique<D3D12MultiBuddyAllocator>(InDevice, InitData);
+
+		SlabAllocator = std::make_unique<D3D12SlabAllocator>(Allocator.get(), InFence);
 	}
 
 	{
@@ -354,6 +750,9 @@ D3D12DefaultBufferAllocator::D3D12DefaultBufferAllocator(ID3D12Device* InDevice)
 		InitData.AllocationStrategy = D3D12BuddyAllocator::EAllocationStrategy::ManualSubAllocation;
 		InitData.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 		InitData.ResourceFlags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		InitData.Fence = InFence;
+		InitData.PoolSize = InPoolSize;
+		InitData.MemoryBudget = InMemoryBudget;
 
 		UavAllocator = std::make_unique<D3D12MultiBuddyAllocator>(InDevice, InitData);
 	}
@@ -361,44 +760,96 @@ D3D12DefaultBufferAllocator::D3D12DefaultBufferAllocator(ID3D12Device* InDevice)
 	D3DDevice = InDevice;
 }
 
-void D3D12DefaultBufferAllocator::AllocDefaultResource(const D3D12_RESOURCE_DESC& ResourceDesc, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
+bool D3D12DefaultBufferAllocator::AllocDefaultResource(const D3D12_RESOURCE_DESC& ResourceDesc, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation)
 {
-	if (ResourceDesc.Flags == D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+	const bool bUav = ResourceDesc.Flags == D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+	bool bAllocated = false;
+	if (bUav)
 	{
-		UavAllocator->AllocResource((uint32_t)ResourceDesc.Width, Alignment, ResourceLocation);
+		bAllocated = UavAllocator->AllocResource(ResourceDesc.Width, Alignment, ResourceLocation)
+			|| UavAllocator->AllocStandAloneResource(ResourceDesc, D3D12_RESOURCE_STATE_COMMON, ResourceLocation);
 	}
 	else
 	{
-		Allocator->AllocResource((uint32_t)ResourceDesc.Width, Alignment, ResourceLocation);
+		bAllocated = SlabAllocator->AllocResource(ResourceDesc.Width, Alignment, ResourceLocation)
+			|| Allocator->AllocResource(ResourceDesc.Width, Alignment, ResourceLocation)
+			|| Allocator->AllocStandAloneResource(ResourceDesc, D3D12_RESOURCE_STATE_COMMON, ResourceLocation);
+	}
+
+	if (!bAllocated)
+	{
+		return false;
+	}
+
+	RecordAllocation(Trace, bUav ? EAllocationTraceChannel::Uav : EAllocationTraceChannel::Default, ResourceDesc.Width, Alignment, ResourceLocation);
+
+	return true;
+}
+
+void D3D12DefaultBufferAllocator::RegisterRelocatable(D3D12ResourceLocation& ResourceLocation, const std::function<void(D3D12ResourceLocation&)>& Callback)
+{
+	if (ResourceLocation.ResourceLocationType == D3D12ResourceLocation::EResourceLocationType::SubAllocation)
+	{
+		ResourceLocation.Allocator->RegisterRelocatable(ResourceLocation, Callback);
 	}
 }
 
+uint64_t D3D12DefaultBufferAllocator::Defragment(XCopyQueue& CopyQueue, uint64_t MaxBytes)
+{
+	uint64_t MovedSize = Allocator->Defragment(CopyQueue, MaxBytes);
+
+	MovedSize += UavAllocator->Defragment(CopyQueue, MaxBytes - MovedSize);
+
+	return MovedSize;
+}
+
 void D3D12DefaultBufferAllocator::CleanUpAllocations()
 {
+	if (Trace)
+	{
+		Trace->RecordCleanUp((uint8_t)EAllocationTraceChannel::Default);
+		Trace->RecordCleanUp((uint8_t)EAllocationTraceChannel::Uav);
+	}
+
+	SlabAllocator->CleanUpAllocations();
+
 	Allocator->CleanUpAllocations();
+
+	UavAllocator->CleanUpAllocations();
 }
 
 
 
-D3D3TextureResourceAllocator::D3D3TextureResourceAllocator(ID3D12Device* InDevice)
+D3D3TextureResourceAllocator::D3D3TextureResourceAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize, uint64_t InMemoryBudget)
 {
 	D3D12BuddyAllocator::AllocatorInitData InitData;
 	InitData.AllocationStrategy = D3D12BuddyAllocator::EAllocationStrategy::PlacedResource;
 	InitData.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 	InitData.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	InitData.Fence = InFence;
+	InitData.PoolSize = InPoolSize;
+	InitData.MemoryBudget = InMemoryBudget;
 
 	Allocator = std::make_unique<D3D12MultiBuddyAllocator>(InDevice, InitData);
 
 	D3DDevice = InDevice;
 }
 
-void D3D3TextureResourceAllocator::AllocTextureResource(const D3D12_RESOURCE_STATES& ResourceState, const D3D12_RESOURCE_DESC& ResourceDesc, D3D12ResourceLocation& ResourceLocation)
+bool D3D3TextureResourceAllocator::AllocTextureResource(const D3D12_RESOURCE_STATES& ResourceState, const D3D12_RESOURCE_DESC& ResourceDesc, D3D12ResourceLocation& ResourceLocation)
 {
 	const D3D12_RESOURCE_ALLOCATION_INFO Info = D3DDevice->GetResourceAllocationInfo(0, 1, &ResourceDesc);
 
-	Allocator->AllocResource((uint32_t)Info.SizeInBytes, DEFAULT_RESOURCE_ALIGNMENT, ResourceLocation);
+	const bool bPlaced = Allocator->AllocResource(Info.SizeInBytes, DEFAULT_RESOURCE_ALIGNMENT, ResourceLocation);
+	if (!bPlaced && !Allocator->AllocStandAloneResource(ResourceDesc, ResourceState, ResourceLocation))
+	{
+		return false;
+	}
+
+	RecordAllocation(Trace, EAllocationTraceChannel::Texture, Info.SizeInBytes, DEFAULT_RESOURCE_ALIGNMENT, ResourceLocation);
 
 	// Create placed resource
+	if (bPlaced)
 	{
 		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
 		ID3D12Heap* BackingHeap = ResourceLocation.Allocator->GetBackingHeap();
@@ -409,9 +860,16 @@ void D3D3TextureResourceAllocator::AllocTextureResource(const D3D12_RESOURCE_STA
 		ResourceLocation.UnderlyingResource = NewResource;
 		ResourceLocation.BlockData.PlacedResource = NewResource;  // Will delete Resource when ResourceLocation was destroyed
 	}
+
+	return true;
 }
 
 void D3D3TextureResourceAllocator::CleanUpAllocations()
 {
+	if (Trace)
+	{
+		Trace->RecordCleanUp((uint8_t)EAllocationTraceChannel::Texture);
+	}
+
 	Allocator->CleanUpAllocations();
 }
\ No newline at end of file
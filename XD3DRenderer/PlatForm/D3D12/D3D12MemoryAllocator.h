@@ -1,21 +1,58 @@
 #pragma once
 
 #include "D3D12Resource.h"
+#include "../../Common/BuddyAllocatorCore.h"
+#include "../../Common/TLSFAllocatorCore.h"
+#include "../../Common/LinearRingAllocatorCore.h"
+#include "../../Common/SlabAllocatorCore.h"
+#include "../../Common/Fence.h"
+#include "../../Common/RetirementQueue.h"
+#include "../../Common/Defragmenter.h"
+#include "../../Common/AllocationTrace.h"
 #include <stdint.h>
-#include <set>
 
 #define DEFAULT_POOL_SIZE (512 * 1024 * 512)
 
+// Largest dedicated pool, 2^31 blocks of D3D12BuddyAllocator's MinBlockSize
+#define MAX_POOL_SIZE (256ull << 31)
+
+#define UPLOAD_POOL_SIZE (64 * 1024 * 1024)
+#define DEFAULT_BUFFER_POOL_SIZE DEFAULT_POOL_SIZE
+#define TEXTURE_POOL_SIZE DEFAULT_POOL_SIZE
+
+// Empty pools are released after this many frames without any allocation
+#define DEFAULT_POOL_RELEASE_FRAME_COUNT 120
+
 #define DEFAULT_RESOURCE_ALIGNMENT 4
 #define UPLOAD_RESOURCE_ALIGNMENT 256
 
+// Size classes of D3D12SlabAllocator, larger requests go to the buddy allocator
+#define SLAB_MIN_CLASS_SIZE 256
+#define SLAB_MAX_CLASS_SIZE (64 * 1024)
+
+// Bytes the defragmenter may copy each frame
+#define DEFRAG_MAX_BYTES_PER_FRAME (8 * 1024 * 1024)
+
+#define TRANSIENT_UPLOAD_SEGMENT_SIZE (4 * 1024 * 1024)
+#define TRANSIENT_UPLOAD_SEGMENT_COUNT FRAMES_IN_FLIGHT
+
+// Channel of the allocator wrappers in XAllocationTrace events
+enum class EAllocationTraceChannel : uint8_t
+{
+	Upload,
+	Default,
+	Uav,
+	Texture,
+};
+
 class D3D12BuddyAllocator
 {
 public:
 	enum class EAllocationStrategy
 	{
 		PlacedResource,
-		ManualSubAllocation
+		ManualSubAllocation,
+		TLSFSubAllocation  // Backed like ManualSubAllocation, but placed by a TLSF allocator to avoid power of two rounding
 	};
 
 	struct AllocatorInitData
@@ -26,7 +63,15 @@ public:
 
 		D3D12_HEAP_FLAGS HeapFlags = D3D12_HEAP_FLAG_NONE;  // Only for PlacedResource
 
-		D3D12_RESOURCE_FLAGS ResourceFlags = D3D12_RESOURCE_FLAG_NONE;  // Only for ManualSubAllocation
+		D3D12_RESOURCE_FLAGS ResourceFlags = D3D12_RESOURCE_FLAG_NONE;  // Only for ManualSubAllocation and TLSFSubAllocation
+
+		XFence* Fence = nullptr;  // Deallocated blocks are reused once the GPU has passed this fence, nullptr frees them at the next CleanUpAllocations
+
+		uint64_t PoolSize = DEFAULT_POOL_SIZE;  // MinBlockSize times a power of two, at most MAX_POOL_SIZE
+
+		uint32_t PoolReleaseFrameCount = DEFAULT_POOL_RELEASE_FRAME_COUNT;  // Only for D3D12MultiBuddyAllocator, 0 never releases pools
+
+		uint64_t MemoryBudget = 0;  // Only for D3D12MultiBuddyAllocator, total size of its pools and stand-alone resources, 0 means unlimited
 	};
 
 public:
@@ -34,7 +79,7 @@ public:
 
 	~D3D12BuddyAllocator();
 
-	bool AllocResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+	bool AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
 
 	void Deallocate(D3D12ResourceLocation& ResourceLocation);
 
@@ -42,57 +87,45 @@ public:
 
 	ID3D12Heap* GetBackingHeap() { return BackingHeap; }
 
-	EAllocationStrategy GetAllocationStrategy() { return InitData.AllocationStrategy; }
-
-private:
-	void Initialize();
+	D3D12Resource* GetBackingResource() { return BackingResource; }
 
-	uint32_t AllocateBlock(uint32_t Order);
+	EAllocationStrategy GetAllocationStrategy() { return InitData.AllocationStrategy; }
 
-	uint32_t GetSizeToAllocate(uint32_t Size, uint32_t Alignment);
+	XAllocatorStats GetStats() const;
 
-	bool CanAllocate(uint32_t SizeToAllocate);
+	// Cheaper than GetStats().AllocatedSize
+	uint64_t GetAllocatedSize() const;
 
-	uint32_t SizeToUnitSize(uint32_t Size) const
-	{
-		return (Size + (MinBlockSize - 1)) / MinBlockSize;
-	}
+	uint64_t GetPoolSize() const { return InitData.PoolSize; }
 
-	uint32_t UnitSizeToOrder(uint32_t Size) const
-	{
-		unsigned long Result;
-		_BitScanReverse(&Result, Size + Size - 1); // ceil(log2(size))
-		return Result;
-	}
+	// No live allocation and nothing waiting for a fence, the pool can be destroyed
+	bool IsEmpty() const;
 
-	uint32_t OrderToUnitSize(uint32_t Order) const
-	{
-		return ((uint32_t)1) << Order;
-	}
+	// Let the defragmenter move the location into another pool, not for PlacedResource.
+	// Callback is called after each move, so anything built on the old address (views...) can be recreated.
+	void RegisterRelocatable(D3D12ResourceLocation& ResourceLocation, const std::function<void(D3D12ResourceLocation&)>& Callback);
 
-	void DeallocateInternal(const D3D12BuddyBlockData& Block);
+	void UnregisterRelocatable(D3D12ResourceLocation& ResourceLocation);
 
-	void DeallocateBlock(uint32_t Offset, uint32_t Order);
+	const std::vector<D3D12ResourceLocation*>& GetRelocatableLocations() const { return RelocatableLocations; }
 
-	uint32_t GetBuddyOffset(const uint32_t& Offset, const uint32_t& Size)
-	{
-		return Offset ^ Size;
-	}
+private:
+	void Initialize();
 
-	uint32_t GetAllocOffsetInBytes(uint32_t Offset) const { return Offset * MinBlockSize; }
+	void DeallocateInternal(const D3D12BuddyBlockData& Block);
 
 private:
 	AllocatorInitData InitData;
 
 	const uint32_t MinBlockSize = 256;
 
-	uint32_t MaxOrder;
+	XBuddyAllocatorCore BuddyCore;
 
-	uint32_t TotalAllocSize = 0;
+	XTLSFAllocatorCore TLSFCore;  // Only for TLSFSubAllocation
 
-	std::vector<std::set<uint32_t>> FreeBlocks;
+	XRetirementQueue<D3D12BuddyBlockData> DeferredDeletionQueue;
 
-	std::vector<D3D12BuddyBlockData> DeferredDeletionQueue;
+	std::vector<D3D12ResourceLocation*> RelocatableLocations;
 
 	ID3D12Device* D3DDevice;
 
@@ -108,61 +141,190 @@ public:
 
 	~D3D12MultiBuddyAllocator();
 
-	bool AllocResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+	// Returns false if the allocation would exceed the memory budget
+	bool AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+
+	// Exact size committed resource for the requests the pools can't serve, counted against the same budget.
+	// Returns false if it would exceed the memory budget.
+	bool AllocStandAloneResource(const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_RESOURCE_STATES ResourceState, D3D12ResourceLocation& ResourceLocation);
 
+	void DeallocateStandAlone(D3D12ResourceLocation& ResourceLocation);
+
+	// Called once per frame, also releases the pools that stayed empty for PoolReleaseFrameCount frames
 	void CleanUpAllocations();
 
+	uint64_t GetTotalPoolSize() const { return TotalPoolSize; }
+
+	// Pools and stand-alone resources, what MemoryBudget bounds
+	uint64_t GetTotalSize() const { return TotalPoolSize + StandAloneSize; }
+
+	// Sum of the live pools. Peak usage and the size histogram cover the whole lifetime, released pools included.
+	XAllocatorStats GetStats() const;
+
+	// Move relocatable allocations out of the least used pools, at most MaxBytes.
+	// The copies are recorded on CopyQueue, returns the number of bytes moved.
+	uint64_t Defragment(XCopyQueue& CopyQueue, uint64_t MaxBytes);
+
 private:
-	std::vector<std::shared_ptr<D3D12BuddyAllocator>> Allocators;
+	void ReleaseEmptyPools(uint32_t MinIdleFrameCount, bool bKeepRegularPool);
+
+	// Releases the empty pools first if needed
+	bool FitsInBudget(uint64_t Size);
+
+private:
+	struct Pool
+	{
+		std::shared_ptr<D3D12BuddyAllocator> Allocator;
+
+		uint32_t IdleFrameCount = 0;
+	};
+
+	std::vector<Pool> Pools;
+
+	uint64_t TotalPoolSize = 0;
+
+	uint64_t StandAloneSize = 0;
+
+	uint32_t StandAloneCount = 0;
+
+	// Peak usage is sampled at each allocation and CleanUpAllocations
+	XAllocationCounters Counters;
+
+	XDefragmenter Defragmenter;
 
 	ID3D12Device* Device;
 
 	D3D12BuddyAllocator::AllocatorInitData InitData;
 };
 
+// Front end of a D3D12MultiBuddyAllocator for small requests.
+// Each slab is one block of the buddy allocator split into XSlabAllocatorCore::SlotCount slots of one size class.
+class D3D12SlabAllocator
+{
+public:
+	D3D12SlabAllocator(D3D12MultiBuddyAllocator* InAllocator, XFence* InFence);
+
+	~D3D12SlabAllocator();
+
+	// Returns false if the request doesn't fit a size class or no slab could be created, use the buddy allocator then
+	bool AllocResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+
+	void Deallocate(D3D12ResourceLocation& ResourceLocation);
+
+	// Also gives the empty slabs back to the buddy allocator, one empty slab is kept per size class
+	void CleanUpAllocations();
+
+private:
+	void DeallocateInternal(const XSlabAllocatorCore::Allocation& Slot);
+
+private:
+	XSlabAllocatorCore SlabCore;
+
+	// Backing block of each slab, indexed like the slabs of SlabCore
+	std::vector<std::unique_ptr<D3D12ResourceLocation>> Slabs;
+
+	XRetirementQueue<XSlabAllocatorCore::Allocation> DeferredDeletionQueue;
+
+	D3D12MultiBuddyAllocator* Allocator = nullptr;
+
+	XFence* Fence = nullptr;
+};
+
 class D3D12UploadBufferAllocator
 {
 public:
-	D3D12UploadBufferAllocator(ID3D12Device* InDevice);
+	D3D12UploadBufferAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize = UPLOAD_POOL_SIZE, uint64_t InMemoryBudget = 0);
+
+	~D3D12UploadBufferAllocator();
 
-	void* AllocUploadResource(uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+	// Returns nullptr if the allocation would exceed the memory budget
+	void* AllocUploadResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+
+	// Slice of the per-frame upload ring, only valid until the GPU has finished the current frame.
+	// Falls back to AllocUploadResource when the frame's segment is exhausted.
+	void* AllocTransientUploadResource(uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
 
 	void CleanUpAllocations();
 
+	void EndFrame();
+
+	// Pools only, the transient ring is not included
+	XAllocatorStats GetStats() const { return Allocator->GetStats(); }
+
+	// Transient allocations are not recorded, they never reach the pools
+	void SetAllocationTrace(XAllocationTrace* InTrace) { Trace = InTrace; }
+
+private:
+	void CreateTransientRingBuffer();
+
 private:
 	std::unique_ptr<D3D12MultiBuddyAllocator> Allocator = nullptr;
 
+	// Destroyed before Allocator, its slabs are blocks of it
+	std::unique_ptr<D3D12SlabAllocator> SlabAllocator = nullptr;
+
+	XLinearRingAllocatorCore TransientRing;
+
+	// Persistently mapped, split into TRANSIENT_UPLOAD_SEGMENT_COUNT per-frame segments
+	D3D12Resource* TransientRingBuffer = nullptr;
+
+	XAllocationTrace* Trace = nullptr;
+
 	ID3D12Device* D3DDevice = nullptr;
 };
 
 class D3D12DefaultBufferAllocator
 {
 public:
-	D3D12DefaultBufferAllocator(ID3D12Device* InDevice);
+	D3D12DefaultBufferAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize = DEFAULT_BUFFER_POOL_SIZE, uint64_t InMemoryBudget = 0);
 
-	void AllocDefaultResource(const D3D12_RESOURCE_DESC& ResourceDesc, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+	// Falls back to a committed resource if the pools can't serve the allocation, returns false if that exceeds the memory budget too
+	bool AllocDefaultResource(const D3D12_RESOURCE_DESC& ResourceDesc, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+
+	// Ignored for the committed fallback resources, they are never moved
+	void RegisterRelocatable(D3D12ResourceLocation& ResourceLocation, const std::function<void(D3D12ResourceLocation&)>& Callback);
+
+	uint64_t Defragment(XCopyQueue& CopyQueue, uint64_t MaxBytes);
 
 	void CleanUpAllocations();
 
+	XAllocatorStats GetStats() const { return Allocator->GetStats(); }
+
+	XAllocatorStats GetUavStats() const { return UavAllocator->GetStats(); }
+
+	void SetAllocationTrace(XAllocationTrace* InTrace) { Trace = InTrace; }
+
 private:
 	std::unique_ptr<D3D12MultiBuddyAllocator> Allocator = nullptr;
 
 	std::unique_ptr<D3D12MultiBuddyAllocator> UavAllocator = nullptr;
 
+	// Small non UAV buffers, destroyed before Allocator
+	std::unique_ptr<D3D12SlabAllocator> SlabAllocator = nullptr;
+
+	XAllocationTrace* Trace = nullptr;
+
 	ID3D12Device* D3DDevice = nullptr;
 };
 
 class D3D3TextureResourceAllocator
 {
 public:
-	D3D3TextureResourceAllocator(ID3D12Device* InDevice);
+	D3D3TextureResourceAllocator(ID3D12Device* InDevice, XFence* InFence, uint64_t InPoolSize = TEXTURE_POOL_SIZE, uint64_t InMemoryBudget = 0);
 
-	void AllocTextureResource(const D3D12_RESOURCE_STATES& ResourceState, const D3D12_RESOURCE_DESC& ResourceDesc, D3D12ResourceLocation& ResourceLocation);
+	// Falls back to a committed resource if the pools can't serve the allocation, returns false if that exceeds the memory budget too
+	bool AllocTextureResource(const D3D12_RESOURCE_STATES& ResourceState, const D3D12_RESOURCE_DESC& ResourceDesc, D3D12ResourceLocation& ResourceLocation);
 
 	void CleanUpAllocations();
 
+	XAllocatorStats GetStats() const { return Allocator->GetStats(); }
+
+	void SetAllocationTrace(XAllocationTrace* InTrace) { Trace = InTrace; }
+
 private:
 	std::unique_ptr<D3D12MultiBuddyAllocator> Allocator = nullptr;
 
+	XAllocationTrace* Trace = nullptr;
+
 	ID3D12Device* D3DDevice = nullptr;
 };
\ No newline at end of file
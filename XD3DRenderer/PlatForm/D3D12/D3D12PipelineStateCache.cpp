@@ -0,0 +1,227 @@
+#include "D3D12PipelineStateCache.h"
+#include "D3D12Device.h"
+
+using Microsoft::WRL::ComPtr;
+
+D3D12PipelineStateCache::D3D12PipelineStateCache(D3D12Device* InDevice, IDXGIFactory4* DxgiFactory, const std::wstring& InFileName)
+	:Device(InDevice), FileName(Convert::WStrToStr(InFileName))
+{
+	Cache = std::make_unique<XPipelineStateCache<ComPtr<ID3D12PipelineState>>>(GetDeviceKey(Device->GetD3DDevice(), DxgiFactory));
+
+	// Missing on the first run
+	Cache->LoadFromFile(FileName);
+}
+
+D3D12PipelineStateCache::~D3D12PipelineStateCache()
+{
+	Save();
+}
+
+bool D3D12PipelineStateCache::Save()
+{
+	// The directory may not exist yet
+	const size_t Separator = FileName.find_last_of("/\\");
+	if (Separator != std::string::npos)
+	{
+		CreateDirectoryA(FileName.substr(0, Separator).c_str(), nullptr);
+	}
+
+	return Cache->SaveToFile(FileName);
+}
+
+uint64_t D3D12PipelineStateCache::GetDeviceKey(ID3D12Device* D3DDevice, IDXGIFactory4* DxgiFactory)
+{
+	XPipelineStateHasher Hasher;
+
+	ComPtr<IDXGIAdapter1> Adapter;
+	if (SUCCEEDED(DxgiFactory->EnumAdapterByLuid(D3DDevice->GetAdapterLuid(), IID_PPV_ARGS(&Adapter))))
+	{
+		DXGI_ADAPTER_DESC1 AdapterDesc;
+		ThrowIfFailed(Adapter->GetDesc1(&AdapterDesc));
+
+		Hasher.AddValue(AdapterDesc.VendorId);
+		Hasher.AddValue(AdapterDesc.DeviceId);
+		Hasher.AddValue(AdapterDesc.SubSysId);
+		Hasher.AddValue(AdapterDesc.Revision);
+
+		LARGE_INTEGER DriverVersion = {};
+		if (SUCCEEDED(Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion)))
+		{
+			Hasher.AddValue(DriverVersion.QuadPart);
+		}
+	}
+
+	return Hasher.GetHash();
+}
+
+uint64_t D3D12PipelineStateCache::HashBytecode(const D3D12_SHADER_BYTECODE& Bytecode)
+{
+	return Bytecode.BytecodeLength > 0 ? HashHelper::HashBytes(Bytecode.pShaderBytecode, Bytecode.BytecodeLength) : 0;
+}
+
+uint64_t D3D12PipelineStateCache::HashGraphicsDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash)
+{
+	XPipelineStateHasher Hasher;
+
+	if (ShaderHash == 0)
+	{
+		Hasher.AddHash(HashBytecode(Desc.VS));
+		Hasher.AddHash(HashBytecode(Desc.PS));
+		Hasher.AddHash(HashBytecode(Desc.DS));
+		Hasher.AddHash(HashBytecode(Desc.HS));
+		Hasher.AddHash(HashBytecode(Desc.GS));
+	}
+	else
+	{
+		Hasher.AddHash(ShaderHash);
+	}
+
+	for (UINT i = 0; i < Desc.StreamOutput.NumEntries; i++)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& Entry = Desc.StreamOutput.pSODeclaration[i];
+		Hasher.AddValue(Entry.Stream);
+		Hasher.AddString(Entry.SemanticName);
+		Hasher.AddValue(Entry.SemanticIndex);
+		Hasher.AddValue(Entry.StartComponent);
+		Hasher.AddValue(Entry.ComponentCount);
+		Hasher.AddValue(Entry.OutputSlot);
+	}
+
+	for (UINT i = 0; i < Desc.StreamOutput.NumStrides; i++)
+	{
+		Hasher.AddValue(Desc.StreamOutput.pBufferStrides[i]);
+	}
+
+	Hasher.AddValue(Desc.StreamOutput.RasterizedStream);
+
+	// The blend and depth stencil descs have padding, hashed field by field
+	Hasher.AddValue(Desc.BlendState.AlphaToCoverageEnable);
+	Hasher.AddValue(Desc.BlendState.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& Blend : Desc.BlendState.RenderTarget)
+	{
+		Hasher.AddValue(Blend.BlendEnable);
+		Hasher.AddValue(Blend.LogicOpEnable);
+		Hasher.AddValue(Blend.SrcBlend);
+		Hasher.AddValue(Blend.DestBlend);
+		Hasher.AddValue(Blend.BlendOp);
+		Hasher.AddValue(Blend.SrcBlendAlpha);
+		Hasher.AddValue(Blend.DestBlendAlpha);
+		Hasher.AddValue(Blend.BlendOpAlpha);
+		Hasher.AddValue(Blend.LogicOp);
+		Hasher.AddValue(Blend.RenderTargetWriteMask);
+	}
+
+	Hasher.AddValue(Desc.SampleMask);
+	Hasher.AddValue(Desc.RasterizerState);
+
+	const D3D12_DEPTH_STENCIL_DESC& DepthStencil = Desc.DepthStencilState;
+	Hasher.AddValue(DepthStencil.DepthEnable);
+	Hasher.AddValue(DepthStencil.DepthWriteMask);
+	Hasher.AddValue(DepthStencil.DepthFunc);
+	Hasher.AddValue(DepthStencil.StencilEnable);
+	Hasher.AddValue(DepthStencil.StencilReadMask);
+	Hasher.AddValue(DepthStencil.StencilWriteMask);
+	Hasher.AddValue(DepthStencil.FrontFace);
+	Hasher.AddValue(DepthStencil.BackFace);
+
+	for (UINT i = 0; i < Desc.InputLayout.NumElements; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& Element = Desc.InputLayout.pInputElementDescs[i];
+		Hasher.AddString(Element.SemanticName);
+		Hasher.AddValue(Element.SemanticIndex);
+		Hasher.AddValue(Element.Format);
+		Hasher.AddValue(Element.InputSlot);
+		Hasher.AddValue(Element.AlignedByteOffset);
+		Hasher.AddValue(Element.InputSlotClass);
+		Hasher.AddValue(Element.InstanceDataStepRate);
+	}
+
+	Hasher.AddValue(Desc.IBStripCutValue);
+	Hasher.AddValue(Desc.PrimitiveTopologyType);
+	Hasher.AddValue(Desc.NumRenderTargets);
+	Hasher.AddValue(Desc.RTVFormats);
+	Hasher.AddValue(Desc.DSVFormat);
+	Hasher.AddValue(Desc.SampleDesc);
+	Hasher.AddValue(Desc.NodeMask);
+	Hasher.AddValue(Desc.Flags);
+
+	return Hasher.GetHash();
+}
+
+uint64_t D3D12PipelineStateCache::HashComputeDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash)
+{
+	XPipelineStateHasher Hasher;
+
+	// Not the hash of a graphics pipeline with the same bytecode
+	Hasher.AddString("Compute");
+	Hasher.AddHash(ShaderHash != 0 ? ShaderHash : HashBytecode(Desc.CS));
+	Hasher.AddValue(Desc.NodeMask);
+	Hasher.AddValue(Desc.Flags);
+
+	return Hasher.GetHash();
+}
+
+template<typename DescType, typename CreateFuncType>
+ComPtr<ID3D12PipelineState> D3D12PipelineStateCache::CreatePipelineState(const DescType& Desc, const std::vector<uint8_t>* CachedBlob,
+	std::vector<uint8_t>& OutBlob, CreateFuncType&& CreateFunc)
+{
+	ComPtr<ID3D12PipelineState> PipelineState;
+
+	if (CachedBlob)
+	{
+		DescType CachedDesc = Desc;
+		CachedDesc.CachedPSO.pCachedBlob = CachedBlob->data();
+		CachedDesc.CachedPSO.CachedBlobSizeInBytes = CachedBlob->size();
+
+		// D3D12_ERROR_ADAPTER_NOT_FOUND or D3D12_ERROR_DRIVER_VERSION_MISMATCH, compiled again by the caller
+		if (FAILED(CreateFunc(CachedDesc, PipelineState)))
+		{
+			return nullptr;
+		}
+
+		return PipelineState;
+	}
+
+	DescType CompileDesc = Desc;
+	CompileDesc.CachedPSO = {};
+	ThrowIfFailed(CreateFunc(CompileDesc, PipelineState));
+
+	ComPtr<ID3DBlob> Blob;
+	if (SUCCEEDED(PipelineState->GetCachedBlob(&Blob)))
+	{
+		const uint8_t* BlobData = (const uint8_t*)Blob->GetBufferPointer();
+		OutBlob.assign(BlobData, BlobData + Blob->GetBufferSize());
+	}
+
+	return PipelineState;
+}
+
+ID3D12PipelineState* D3D12PipelineStateCache::GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash)
+{
+	ID3D12Device* D3DDevice = Device->GetD3DDevice();
+
+	const uint64_t Key = HashGraphicsDesc(Desc, ShaderHash);
+
+	return Cache->FindOrCreate(Key, [&](const std::vector<uint8_t>* CachedBlob, std::vector<uint8_t>& OutBlob)
+	{
+		return CreatePipelineState(Desc, CachedBlob, OutBlob, [D3DDevice](const D3D12_GRAPHICS_PIPELINE_STATE_DESC& CreateDesc, ComPtr<ID3D12PipelineState>& OutPipelineState)
+		{
+			return D3DDevice->CreateGraphicsPipelineState(&CreateDesc, IID_PPV_ARGS(&OutPipelineState));
+		});
+	}).Get();
+}
+
+ID3D12PipelineState* D3D12PipelineStateCache::GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash)
+{
+	ID3D12Device* D3DDevice = Device->GetD3DDevice();
+
+	const uint64_t Key = HashComputeDesc(Desc, ShaderHash);
+
+	return Cache->FindOrCreate(Key, [&](const std::vector<uint8_t>* CachedBlob, std::vector<uint8_t>& OutBlob)
+	{
+		return CreatePipelineState(Desc, CachedBlob, OutBlob, [D3DDevice](const D3D12_COMPUTE_PIPELINE_STATE_DESC& CreateDesc, ComPtr<ID3D12PipelineState>& OutPipelineState)
+		{
+			return D3DDevice->CreateComputePipelineState(&CreateDesc, IID_PPV_ARGS(&OutPipelineState));
+		});
+	}).Get();
+}
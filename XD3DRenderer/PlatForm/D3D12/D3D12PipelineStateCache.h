@@ -0,0 +1,54 @@
+#pragma once
+
+#include "D3D12Util.h"
+#include "../../Common/PipelineStateCache.h"
+
+class D3D12Device;
+
+// Pipeline states keyed by a hash of their full description, with the compiled blobs saved to disk between runs.
+// Shaders are keyed by the hash of their bytecode, pass D3DShader::GetShaderHash() to skip hashing the bytecode
+// on every lookup. The root signature is not part of the key, it is built from the shader reflection.
+// Thread safe.
+class D3D12PipelineStateCache
+{
+public:
+	using Stats = XPipelineStateCache<Microsoft::WRL::ComPtr<ID3D12PipelineState>>::Stats;
+
+public:
+	// Loads the blobs saved by the previous run on this adapter and driver
+	D3D12PipelineStateCache(D3D12Device* InDevice, IDXGIFactory4* DxgiFactory, const std::wstring& InFileName);
+
+	// Saves the blobs compiled during this run
+	~D3D12PipelineStateCache();
+
+	// ShaderHash 0 hashes the bytecode of the shaders in Desc
+	ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash = 0);
+
+	ID3D12PipelineState* GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash = 0);
+
+	bool Save();
+
+	Stats GetStats() { return Cache->GetStats(); }
+
+	static uint64_t HashGraphicsDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash);
+
+	static uint64_t HashComputeDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, uint64_t ShaderHash);
+
+	static uint64_t HashBytecode(const D3D12_SHADER_BYTECODE& Bytecode);
+
+private:
+	// Blobs of another adapter or driver version are dropped on load
+	static uint64_t GetDeviceKey(ID3D12Device* D3DDevice, IDXGIFactory4* DxgiFactory);
+
+	// Fills OutBlob when compiling, returns nullptr if CachedBlob was rejected by the driver
+	template<typename DescType, typename CreateFuncType>
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> CreatePipelineState(const DescType& Desc, const std::vector<uint8_t>* CachedBlob,
+		std::vector<uint8_t>& OutBlob, CreateFuncType&& CreateFunc);
+
+private:
+	D3D12Device* Device = nullptr;
+
+	std::string FileName;
+
+	std::unique_ptr<XPipelineStateCache<Microsoft::WRL::ComPtr<ID3D12PipelineState>>> Cache = nullptr;
+};
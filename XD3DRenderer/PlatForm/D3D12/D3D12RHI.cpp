@@ -64,8 +64,14 @@ void D3D12RHI::Destroy()
 {
 	EndFrame();
 
+	// Frames may still be in flight
+	FlushCommandQueue();
+
 	Viewport.reset();
 
+	const std::string ShaderCacheStats = GetDevice()->GetShaderCache()->GetStatsString() + "\n";
+	OutputDebugStringA(ShaderCacheStats.c_str());
+
 	Device.reset();
 
 }
@@ -180,7 +186,19 @@ UINT D3D12RHI::GetSupportMSAAQuality(DXGI_FORMAT BackBufferFormat)
 
 void D3D12RHI::FlushCommandQueue()
 {
-	GetDevice()->GetCommandContext()->FlushCommandQueue();
+	GetDevice()->GetUploadManager()->Flush();
+
+	// One CPU wait for both queues
+	D3D12CommandContext* CommandContext = GetDevice()->GetCommandContext();
+	XFenceWait Waits[2] = { { CommandContext->GetFence(), CommandContext->SignalSubmittedWork() } };
+	uint32_t WaitCount = 1;
+
+	if (D3D12ComputeContext* ComputeContext = GetDevice()->GetComputeContext())
+	{
+		Waits[WaitCount++] = { ComputeContext->GetFence(), ComputeContext->SignalSubmittedWork() };
+	}
+
+	D3D12Fence::GetWaiter().WaitForAll(Waits, WaitCount);
 }
 
 void D3D12RHI::ExecuteCommandLists()
@@ -203,35 +221,66 @@ void D3D12RHI::Present()
 	GetViewport()->Present();
 }
 
+void D3D12RHI::BeginFrame()
+{
+	GetDevice()->GetCommandContext()->BeginFrame();
+}
+
 void D3D12RHI::ResizeViewport(int NewWidth, int NewHeight)
 {
 	GetViewport()->OnResize(NewWidth, NewHeight);
 }
 
-void D3D12RHI::TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter)
+void D3D12RHI::TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource)
 {
-	D3D12_RESOURCE_STATES StateBefore = Resource->CurrentState;
+	WaitForUpload(Resource);
 
-	if (StateBefore != StateAfter)
-	{
-		GetDevice()->GetCommandList()->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(Resource->D3DResource.Get(), StateBefore, StateAfter));
+	GetDevice()->GetCommandContext()->TransitionResource(Resource, StateAfter, Subresource);
+}
 
-		Resource->CurrentState = StateAfter;
+void D3D12RHI::BeginTransition(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource)
+{
+	WaitForUpload(Resource);
+
+	GetDevice()->GetCommandContext()->BeginTransition(Resource, StateAfter, Subresource);
+}
+
+void D3D12RHI::EndTransition(D3D12Resource* Resource, uint32_t Subresource)
+{
+	GetDevice()->GetCommandContext()->EndTransition(Resource, Subresource);
+}
+
+void D3D12RHI::FlushResourceBarriers()
+{
+	GetDevice()->GetCommandContext()->FlushResourceBarriers();
+}
+
+void D3D12RHI::WaitForUpload(D3D12Resource* Resource)
+{
+	if (Resource->UploadToken != 0)
+	{
+		GetDevice()->GetUploadManager()->WaitForUpload(Resource, GetDevice()->GetCommandQueue());
 	}
 }
 
 void D3D12RHI::CopyResource(D3D12Resource* DstResource, D3D12Resource* SrcResource)
 {
+	FlushResourceBarriers();
+
 	GetDevice()->GetCommandList()->CopyResource(DstResource->D3DResource.Get(), SrcResource->D3DResource.Get());
 }
 
 void D3D12RHI::CopyBufferRegion(D3D12Resource* DstResource, UINT64 DstOffset, D3D12Resource* SrcResource, UINT64 SrcOffset, UINT64 Size)
 {
+	FlushResourceBarriers();
+
 	GetDevice()->GetCommandList()->CopyBufferRegion(DstResource->D3DResource.Get(), DstOffset, SrcResource->D3DResource.Get(), SrcOffset, Size);
 }
 
 void D3D12RHI::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* Dst, UINT DstX, UINT DstY, UINT DstZ, const D3D12_TEXTURE_COPY_LOCATION* Src, const D3D12_BOX* SrcBox)
 {
+	FlushResourceBarriers();
+
 	GetDevice()->GetCommandList()->CopyTextureRegion(Dst, DstX, DstY, DstZ, Src, SrcBox);
 }
 
@@ -265,15 +314,181 @@ void D3D12RHI::SetIndexBuffer(const D3D12IndexBufferRef& IndexBuffer, UINT Offse
 	GetDevice()->GetCommandList()->IASetIndexBuffer(&IBV);
 }
 
+void D3D12RHI::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
+{
+	FlushResourceBarriers();
+
+	GetDevice()->GetCommandList()->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+}
+
+void D3D12RHI::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+{
+	FlushResourceBarriers();
+
+	GetDevice()->GetCommandList()->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void D3D12RHI::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+{
+	FlushResourceBarriers();
+
+	GetDevice()->GetCommandList()->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+}
+
+// Replays into the direct command list through the RHI: resource handles are D3D12Resource, barriers go through
+// the barrier batcher so the tracked states follow the stream, the StateBefore recorded in the stream is not used
+class D3D12RHICommandTarget : public D3D12CommandTarget
+{
+public:
+	D3D12RHICommandTarget(D3D12RHI* InD3D12RHI, ID3D12GraphicsCommandList* InCommandList)
+		: D3D12CommandTarget(InCommandList), XD3D12RHI(InD3D12RHI) {}
+
+	virtual void ResourceBarriers(uint32_t Count, const XBarrierBatcher::XBarrier* Barriers) override
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			const XBarrierBatcher::XBarrier& Barrier = Barriers[i];
+			D3D12Resource* Resource = (D3D12Resource*)Barrier.Resource;
+
+			if (Barrier.Flags == XBarrierBatcher::BarrierFlagBeginOnly)
+			{
+				XD3D12RHI->BeginTransition(Resource, (D3D12_RESOURCE_STATES)Barrier.StateAfter, Barrier.Subresource);
+			}
+			else if (Barrier.Flags == XBarrierBatcher::BarrierFlagEndOnly)
+			{
+				XD3D12RHI->EndTransition(Resource, Barrier.Subresource);
+			}
+			else
+			{
+				XD3D12RHI->TransitionResource(Resource, (D3D12_RESOURCE_STATES)Barrier.StateAfter, Barrier.Subresource);
+			}
+		}
+	}
+
+	virtual void Draw(uint32_t VertexCount, uint32_t InstanceCount, uint32_t StartVertex, uint32_t StartInstance) override
+	{
+		XD3D12RHI->FlushResourceBarriers();
+
+		D3D12CommandTarget::Draw(VertexCount, InstanceCount, StartVertex, StartInstance);
+	}
+
+	virtual void DrawIndexed(uint32_t IndexCount, uint32_t InstanceCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t StartInstance) override
+	{
+		XD3D12RHI->FlushResourceBarriers();
+
+		D3D12CommandTarget::DrawIndexed(IndexCount, InstanceCount, StartIndex, BaseVertex, StartInstance);
+	}
+
+	virtual void Dispatch(uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ) override
+	{
+		XD3D12RHI->FlushResourceBarriers();
+
+		D3D12CommandTarget::Dispatch(GroupCountX, GroupCountY, GroupCountZ);
+	}
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override
+	{
+		XD3D12RHI->CopyBufferRegion((D3D12Resource*)DstResource, DstOffset, (D3D12Resource*)SrcResource, SrcOffset, Size);
+	}
+
+	virtual void CopyResource(void* DstResource, void* SrcResource) override
+	{
+		XD3D12RHI->CopyResource((D3D12Resource*)DstResource, (D3D12Resource*)SrcResource);
+	}
+
+private:
+	D3D12RHI* XD3D12RHI = nullptr;
+};
+
+void D3D12RHI::ReplayCommandStream(const XCommandStream& Stream)
+{
+	D3D12RHICommandTarget Target(this, GetDevice()->GetCommandList());
+	Stream.Replay(Target);
+}
+
+// Records the defragmentation copies on the direct command list
+class D3D12DefragCopyQueue : public XCopyQueue
+{
+public:
+	D3D12DefragCopyQueue(D3D12RHI* InD3D12RHI) : XD3D12RHI(InD3D12RHI) {}
+
+	virtual void CopyBufferRegion(void* DstResource, uint64_t DstOffset, void* SrcResource, uint64_t SrcOffset, uint64_t Size) override
+	{
+		D3D12Resource* DstBuffer = (D3D12Resource*)DstResource;
+		D3D12Resource* SrcBuffer = (D3D12Resource*)SrcResource;
+
+		SaveState(SrcBuffer);
+		SaveState(DstBuffer);
+
+		XD3D12RHI->TransitionResource(SrcBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		XD3D12RHI->TransitionResource(DstBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
+		XD3D12RHI->CopyBufferRegion(DstBuffer, DstOffset, SrcBuffer, SrcOffset, Size);
+	}
+
+	// The command list may still be drawing from the pools, put their buffers back in the states they had before the copies
+	void RestoreStates()
+	{
+		for (const auto& Saved : SavedStates)
+		{
+			XD3D12RHI->TransitionResource(Saved.first, Saved.second);
+		}
+
+		SavedStates.clear();
+	}
+
+private:
+	void SaveState(D3D12Resource* Buffer)
+	{
+		for (const auto& Saved : SavedStates)
+		{
+			if (Saved.first == Buffer)
+			{
+				return;
+			}
+		}
+
+		// Buffers have a single subresource
+		SavedStates.push_back(std::make_pair(Buffer, (D3D12_RESOURCE_STATES)Buffer->ResourceState.GetSubresourceState(0)));
+	}
+
+private:
+	D3D12RHI* XD3D12RHI = nullptr;
+
+	// A few pools at most, in the order they were first copied
+	std::vector<std::pair<D3D12Resource*, D3D12_RESOURCE_STATES>> SavedStates;
+};
+
+uint64_t D3D12RHI::DefragmentBuffers(uint64_t MaxBytes)
+{
+	D3D12DefragCopyQueue CopyQueue(this);
+
+	const uint64_t MovedSize = GetDevice()->GetDefaultBufferAllocator()->Defragment(CopyQueue, MaxBytes);
+
+	CopyQueue.RestoreStates();
+
+	return MovedSize;
+}
+
 void D3D12RHI::EndFrame()
 {
 	// Clean memory allocations
 	GetDevice()->GetUploadBufferAllocator()->CleanUpAllocations();
 
+	GetDevice()->GetUploadBufferAllocator()->EndFrame();
+
 	GetDevice()->GetDefaultBufferAllocator()->CleanUpAllocations();
 
 	GetDevice()->GetTextureResourceAllocator()->CleanUpAllocations();
 
+	// Next batch of uploads on the copy queue
+	GetDevice()->GetUploadManager()->EndFrame();
+
+	// The frame fence signaled by the CommandContext also covers the compute work
+	if (GetDevice()->GetComputeContext())
+	{
+		GetDevice()->GetComputeContext()->EndFrame();
+	}
+
 	// CommandContext
 	GetDevice()->GetCommandContext()->EndFrame();
 }
\ No newline at end of file
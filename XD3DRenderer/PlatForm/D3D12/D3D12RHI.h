@@ -4,6 +4,7 @@
 #include "D3D12Viewport.h"
 #include "D3D12Texture.h"
 #include "D3D12Buffer.h"
+#include "D3D12CommandTarget.h"
 
 
 class D3D12RHI
@@ -38,9 +39,26 @@ public:
 
 	void Present();
 
+	// Start recording a frame, waits only if FRAMES_IN_FLIGHT frames are still on the GPU.
+	// Replaces the FlushCommandQueue at the end of every frame, EndFrame signals the frame instead.
+	void BeginFrame();
+
 	void ResizeViewport(int NewWidth, int NewHeight);
 
-	void TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter);
+	// Batched until the next draw, dispatch, copy or FlushResourceBarriers. Subresources are tracked one by one.
+	void TransitionResource(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	// Split barrier, for a transition known ahead of time: the GPU overlaps it with the work until EndTransition
+	void BeginTransition(D3D12Resource* Resource, D3D12_RESOURCE_STATES StateAfter, uint32_t Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	void EndTransition(D3D12Resource* Resource, uint32_t Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	// Call before recording on GetCommandList() directly, the RHI draws, dispatches and copies already do
+	void FlushResourceBarriers();
+
+	// Make the direct queue wait for the copy queue upload of Resource, if any. TransitionResource already does it,
+	// call it before the first use of a resource that is not transitioned, e.g. a texture sampled in COMMON.
+	void WaitForUpload(D3D12Resource* Resource);
 
 	void CopyResource(D3D12Resource* DstResource, D3D12Resource* SrcResource);
 
@@ -50,13 +68,16 @@ public:
 
 	D3D12ConstantBufferRef CreateConstantBuffer(const void* Contents, uint32_t Size);
 
+	// Lives in the per-frame upload ring, overwritten FRAMES_IN_FLIGHT frames later: recreate it every frame
+	D3D12ConstantBufferRef CreateTransientConstantBuffer(const void* Contents, uint32_t Size);
+
 	D3D12StructuredBufferRef CreateStructuredBuffer(const void* Contents, uint32_t ElementSize, uint32_t ElementCount);
 
 	D3D12RWStructuredBufferRef CreateRWStructuredBuffer(uint32_t ElementSize, uint32_t ElementCount);
 
-	D3D12VertexBufferRef CreateVertexBuffer(const void* Contents, uint32_t Size);
+	D3D12VertexBufferRef CreateVertexBuffer(const void* Contents, uint64_t Size);
 
-	D3D12IndexBufferRef CreateIndexBuffer(const void* Contents, uint32_t Size);
+	D3D12IndexBufferRef CreateIndexBuffer(const void* Contents, uint64_t Size);
 
 	D3D12ReadBackBufferRef CreateReadBackBuffer(uint32_t Size);
 
@@ -65,20 +86,36 @@ public:
 	// Use D3DResource to create texture, texture will manage this D3DResource
 	D3D12TextureRef CreateTexture(Microsoft::WRL::ComPtr<ID3D12Resource> D3DResource, TTextureInfo& TextureInfo, uint32_t CreateFlags);
 
+	// Uploads on the copy queue when the texture is in COMMON, on the direct command list otherwise
 	void UploadTextureData(D3D12TextureRef Texture, const std::vector<D3D12_SUBRESOURCE_DATA>& InitData);
 
 	void SetVertexBuffer(const D3D12VertexBufferRef& VertexBuffer, UINT Offset, UINT Stride, UINT Size);
 
 	void SetIndexBuffer(const D3D12IndexBufferRef& IndexBuffer, UINT Offset, DXGI_FORMAT Format, UINT Size);
 
+	void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation);
+
+	void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation);
+
+	void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ);
+
+	// Replay a stream recorded without the device into the command list, see XNullCommandTarget to run it headless.
+	// Resource handles of the stream are D3D12Resource: its barriers update their tracked states like TransitionResource
+	void ReplayCommandStream(const XCommandStream& Stream);
+
+	// Compact the default buffer pools, call at most once per frame while the command list is open.
+	// The pool buffers go back to their previous states after the copies, later draws can keep reading them.
+	// Returns the number of bytes moved.
+	uint64_t DefragmentBuffers(uint64_t MaxBytes = DEFRAG_MAX_BYTES_PER_FRAME);
+
 	void EndFrame();
 
 	//-----------------------------------------------------------------------
 
 private:
-	void CreateDefaultBuffer(uint32_t Size, uint32_t Alignment, D3D12_RESOURCE_FLAGS Flags, D3D12ResourceLocation& ResourceLocation);
+	void CreateDefaultBuffer(uint64_t Size, uint32_t Alignment, D3D12_RESOURCE_FLAGS Flags, D3D12ResourceLocation& ResourceLocation);
 
-	void CreateAndInitDefaultBuffer(const void* Contents, uint32_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
+	void CreateAndInitDefaultBuffer(const void* Contents, uint64_t Size, uint32_t Alignment, D3D12ResourceLocation& ResourceLocation);
 
 	D3D12TextureRef CreateTextureResource(const TTextureInfo& TextureInfo, uint32_t CreateFlags, TVector4 RTVClearValue);
 
@@ -4,9 +4,11 @@
 using namespace Microsoft::WRL;
 
 D3D12Resource::D3D12Resource(Microsoft::WRL::ComPtr<ID3D12Resource> InD3DResource, D3D12_RESOURCE_STATES InitState)
-	:D3DResource(InD3DResource), CurrentState(InitState)
+	:D3DResource(InD3DResource)
 {
-	if (D3DResource->GetDesc().Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	D3D12_RESOURCE_DESC Desc = D3DResource->GetDesc();
+
+	if (Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
 	{
 		GPUVirtualAddress = D3DResource->GetGPUVirtualAddress();
 	}
@@ -14,6 +16,19 @@ D3D12Resource::D3D12Resource(Microsoft::WRL::ComPtr<ID3D12Resource> InD3DResourc
 	{
 		// GetGPUVirtualAddress() returns NULL for non-buffer resources.
 	}
+
+	// Mips times array slices, the planes of depth stencil formats are transitioned together
+	uint32_t SubresourceCount = 1;
+	if (Desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+	{
+		SubresourceCount = Desc.MipLevels;
+	}
+	else if (Desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		SubresourceCount = (uint32_t)Desc.MipLevels * Desc.DepthOrArraySize;
+	}
+
+	ResourceState.Initialize(SubresourceCount, InitState);
 }
 
 void D3D12Resource::Map()
@@ -33,10 +48,21 @@ D3D12ResourceLocation::~D3D12ResourceLocation()
 
 void D3D12ResourceLocation::ReleaseResource()
 {
+	if (Trace)
+	{
+		Trace->RecordDeallocate(TraceId);
+		Trace = nullptr;
+	}
+
 	switch (ResourceLocationType)
 	{
 	case D3D12ResourceLocation::EResourceLocationType::StandAlone:
 	{
+		if (StandAloneAllocator)
+		{
+			StandAloneAllocator->DeallocateStandAlone(*this);
+		}
+
 		delete UnderlyingResource;
 
 		break;
@@ -50,6 +76,15 @@ void D3D12ResourceLocation::ReleaseResource()
 
 		break;
 	}
+	case D3D12ResourceLocation::EResourceLocationType::SlabAllocation:
+	{
+		if (SlabAllocator)
+		{
+			SlabAllocator->Deallocate(*this);
+		}
+
+		break;
+	}
 
 	default:
 		break;
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "D3D12Util.h"
+#include "../../Common/UploadScheduler.h"
+#include "../../Common/BarrierBatcher.h"
+#include <functional>
 
 class D3D12BuddyAllocator;
+class D3D12MultiBuddyAllocator;
+class D3D12SlabAllocator;
+class XAllocationTrace;
 
 
 class D3D12Resource
@@ -17,17 +23,28 @@ public:
 
 	D3D12_GPU_VIRTUAL_ADDRESS GPUVirtualAddress = 0;
 
-	D3D12_RESOURCE_STATES CurrentState;
+	// Per subresource, transitioned through the barrier batcher of the command context
+	XResourceState ResourceState;
 
 	// For upload buffer
 	void* MappedBaseAddress = nullptr;
+
+	// Last upload into the resource still to be waited for, see D3D12UploadManager
+	XUploadToken UploadToken = 0;
 };
 
 struct D3D12BuddyBlockData
 {
 	uint32_t Offset = 0;
 	uint32_t Order = 0;
-	uint32_t ActualUsedSize = 0;
+	uint64_t ActualUsedSize = 0;
+	uint32_t Alignment = 0;
+
+	uint32_t BlockIndex = 0;  // Only for TLSFSubAllocation
+
+	// Only for SlabAllocation
+	uint32_t SlabIndex = 0;
+	uint32_t SlotIndex = 0;
 
 	D3D12Resource* PlacedResource = nullptr;
 };
@@ -40,6 +57,8 @@ public:
 		Undefined,
 		StandAlone,
 		SubAllocation,
+		Transient,  // Slice of the per-frame upload ring, reclaimed with its frame
+		SlabAllocation,  // Slot of a D3D12SlabAllocator slab
 	};
 
 public:
@@ -57,8 +76,24 @@ public:
 	// SubAllocation 
 	D3D12BuddyAllocator* Allocator = nullptr;
 
+	// SlabAllocation
+	D3D12SlabAllocator* SlabAllocator = nullptr;
+
+	// StandAlone resource counted against the budget of this allocator, its size is BlockData.ActualUsedSize
+	D3D12MultiBuddyAllocator* StandAloneAllocator = nullptr;
+
 	TD3D12BuddyBlockData BlockData;
 
+	// Relocatable SubAllocation, see D3D12BuddyAllocator::RegisterRelocatable
+	std::function<void(D3D12ResourceLocation&)> RelocationCallback;
+
+	uint32_t RelocatableIndex = UINT32_MAX;
+
+	// Set when the allocation was recorded, see D3D12Device::GetAllocationTrace
+	XAllocationTrace* Trace = nullptr;
+
+	uint32_t TraceId = 0;
+
 	// StandAlone resource 
 	D3D12Resource* UnderlyingResource = nullptr;
 
@@ -70,7 +70,11 @@ D3D12TextureRef D3D12RHI::CreateTextureResource(const TTextureInfo& TextureInfo,
 	if (bReadOnlyTexture)
 	{
 		auto TextureResourceAllocator = GetDevice()->GetTextureResourceAllocator();
-		TextureResourceAllocator->AllocTextureResource(ResourceState, TexDesc, TextureRef->ResourceLocation);
+		if (!TextureResourceAllocator->AllocTextureResource(ResourceState, TexDesc, TextureRef->ResourceLocation))
+		{
+			// The textures are over their memory budget
+			ThrowIfFailed(E_OUTOFMEMORY);
+		}
 
 		auto TextureResource = TextureRef->GetD3DResource();
 		assert(TextureResource);
@@ -176,9 +180,11 @@ void  D3D12RHI::CreateTextureViews(D3D12TextureRef TextureRef, const TTextureInf
 	}
 	else if (CreateFlags & TexCreate_CubeRTV)
 	{
+		// One view over 6 contiguous descriptors, face i is GetRTV()->GetDescriptorHandle(i)
+		std::vector<D3D12_RENDER_TARGET_VIEW_DESC> RtvDescs(6);
 		for (size_t i = 0; i < 6; i++)
 		{
-			D3D12_RENDER_TARGET_VIEW_DESC RtvDesc = {};
+			D3D12_RENDER_TARGET_VIEW_DESC& RtvDesc = RtvDescs[i];
 			RtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DARRAY;
 			RtvDesc.Texture2DArray.MipSlice = 0;
 			RtvDesc.Texture2DArray.PlaneSlice = 0;
@@ -193,9 +199,9 @@ void  D3D12RHI::CreateTextureViews(D3D12TextureRef TextureRef, const TTextureInf
 			{
 				RtvDesc.Format = TextureInfo.RTVFormat;
 			}
-
-			TextureRef->AddRTV(std::make_unique<D3D12RenderTargetView>(GetDevice(), RtvDesc, TextureResource));
 		}
+
+		TextureRef->AddRTV(std::make_unique<D3D12RenderTargetView>(GetDevice(), RtvDescs, TextureResource));
 	}
 
 	// Create DSV
@@ -219,9 +225,11 @@ void  D3D12RHI::CreateTextureViews(D3D12TextureRef TextureRef, const TTextureInf
 	}
 	else if (CreateFlags & TexCreate_CubeDSV)
 	{
+		// One view over 6 contiguous descriptors, face i is GetDSV()->GetDescriptorHandle(i)
+		std::vector<D3D12_DEPTH_STENCIL_VIEW_DESC> DSVDescs(6);
 		for (size_t i = 0; i < 6; i++)
 		{
-			D3D12_DEPTH_STENCIL_VIEW_DESC DSVDesc = {};
+			D3D12_DEPTH_STENCIL_VIEW_DESC& DSVDesc = DSVDescs[i];
 			DSVDesc.Flags = D3D12_DSV_FLAG_NONE;
 			DSVDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
 			DSVDesc.Texture2DArray.MipSlice = 0;
@@ -236,9 +244,9 @@ void  D3D12RHI::CreateTextureViews(D3D12TextureRef TextureRef, const TTextureInf
 			{
 				DSVDesc.Format = TextureInfo.DSVFormat;
 			}
-
-			TextureRef->AddDSV(std::make_unique<D3D12DepthStencilView>(GetDevice(), DSVDesc, TextureResource));
 		}
+
+		TextureRef->AddDSV(std::make_unique<D3D12DepthStencilView>(GetDevice(), DSVDescs, TextureResource));
 	}
 
 	// Create UAV
@@ -275,11 +283,11 @@ void D3D12RHI::UploadTextureData(D3D12TextureRef Texture, const std::vector<D3D1
 	uint64_t RequiredSize = 0;
 	Device->GetD3DDevice()->GetCopyableFootprints(&TexDesc, 0, NumSubresources, 0, &Layouts[0], &NumRows[0], &RowSizesInBytes[0], &RequiredSize);
 
-	//Create upload resource
-	D3D12ResourceLocation UploadResourceLocation;
+	//Create upload resource, kept alive until the copy is done
+	auto UploadResourceLocation = std::make_shared<D3D12ResourceLocation>();
 	auto UploadBufferAllocator = GetDevice()->GetUploadBufferAllocator();
-	void* MappedData = UploadBufferAllocator->AllocUploadResource((uint32_t)RequiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, UploadResourceLocation);
-	ID3D12Resource* UploadBuffer = UploadResourceLocation.UnderlyingResource->D3DResource.Get();
+	void* MappedData = UploadBufferAllocator->AllocUploadResource(RequiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, *UploadResourceLocation);
+	ID3D12Resource* UploadBuffer = UploadResourceLocation->UnderlyingResource->D3DResource.Get();
 
 	//Copy contents to upload resource
 	for (uint32_t i = 0; i < NumSubresources; ++i)
@@ -290,27 +298,43 @@ void D3D12RHI::UploadTextureData(D3D12TextureRef Texture, const std::vector<D3D1
 		}
 		D3D12_MEMCPY_DEST DestData = { (BYTE*)MappedData + Layouts[i].Offset, Layouts[i].Footprint.RowPitch, SIZE_T(Layouts[i].Footprint.RowPitch) * SIZE_T(NumRows[i]) };
 		MemcpySubresource(&DestData, &(InitData[i]), static_cast<SIZE_T>(RowSizesInBytes[i]), NumRows[i], Layouts[i].Footprint.Depth);
+
+		Layouts[i].Offset += UploadResourceLocation->OffsetFromBaseOfResource;
 	}
 
 	//Copy data from upload resource to default resource
-	TransitionResource(TextureResource, D3D12_RESOURCE_STATE_COPY_DEST);
-
-	for (UINT i = 0; i < NumSubresources; ++i)
+	Microsoft::WRL::ComPtr<ID3D12Resource> DstResource = TextureResource->D3DResource;
+	auto RecordCopy = [=](ID3D12GraphicsCommandList* CommandList)
 	{
-		Layouts[i].Offset += UploadResourceLocation.OffsetFromBaseOfResource;
+		for (UINT i = 0; i < NumSubresources; ++i)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION Src;
+			Src.pResource = UploadBuffer;
+			Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			Src.PlacedFootprint = Layouts[i];
 
-		CD3DX12_TEXTURE_COPY_LOCATION Src;
-		Src.pResource = UploadBuffer;
-		Src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-		Src.PlacedFootprint = Layouts[i];
+			CD3DX12_TEXTURE_COPY_LOCATION Dst;
+			Dst.pResource = DstResource.Get();
+			Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			Dst.SubresourceIndex = i;
 
-		CD3DX12_TEXTURE_COPY_LOCATION Dst;
-		Dst.pResource = TextureResource->D3DResource.Get();
-		Dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		Dst.SubresourceIndex = i;
+			CommandList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+		}
+	};
 
-		CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+	// The copy queue only takes textures in COMMON, they decay back to it after the copy, see WaitForUpload
+	if (TextureResource->ResourceState.IsInState(D3D12_RESOURCE_STATE_COMMON))
+	{
+		GetDevice()->GetUploadManager()->Enqueue(TextureResource, UploadResourceLocation, RequiredSize, RecordCopy);
 	}
+	else
+	{
+		// The upload resource is released with the frame
+		TransitionResource(TextureResource, D3D12_RESOURCE_STATE_COPY_DEST);
+		FlushResourceBarriers();
+
+		RecordCopy(GetDevice()->GetCommandList());
 
-	TransitionResource(TextureResource, D3D12_RESOURCE_STATE_COMMON);
+		TransitionResource(TextureResource, D3D12_RESOURCE_STATE_COMMON);
+	}
 }
\ No newline at end of file
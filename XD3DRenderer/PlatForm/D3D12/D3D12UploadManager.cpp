@@ -0,0 +1,136 @@
+#include "D3D12UploadManager.h"
+#include "D3D12Device.h"
+
+D3D12UploadManager::D3D12UploadManager(D3D12Device* InDevice)
+	:Device(InDevice)
+{
+	CopyFence = std::make_unique<D3D12Fence>(Device->GetD3DDevice());
+
+	D3D12_COMMAND_QUEUE_DESC QueueDesc = {};
+	QueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	QueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(&CopyQueue)));
+	SetDebugName(CopyQueue.Get(), L"UploadCopyQueue");
+
+	CopyContextPool = std::make_unique<XCommandListPool<D3D12RecordingContext>>(CopyFence.get(), [this]() { return CreateCopyContext(); });
+
+	Scheduler = std::make_unique<XUploadScheduler<D3D12UploadRequest>>(this, UPLOAD_BUDGET_PER_FRAME);
+}
+
+D3D12UploadManager::~D3D12UploadManager()
+{
+	Flush();
+}
+
+D3D12RecordingContext* D3D12UploadManager::CreateCopyContext()
+{
+	D3D12RecordingContext* Context = new D3D12RecordingContext();
+
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(Context->CommandAllocator.GetAddressOf())));
+	ThrowIfFailed(Device->GetD3DDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, Context->CommandAllocator.Get(),
+		nullptr, IID_PPV_ARGS(Context->CommandList.GetAddressOf())));
+	ThrowIfFailed(Context->CommandList->Close());
+
+	return Context;
+}
+
+uint64_t D3D12UploadManager::Signal()
+{
+	return CopyFence->Signal(CopyQueue.Get());
+}
+
+void D3D12UploadManager::WaitForFence(uint64_t FenceValue)
+{
+	CopyFence->WaitForValue(FenceValue);
+}
+
+void D3D12UploadManager::WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue)
+{
+	D3D12Fence* OtherFence = static_cast<D3D12Fence*>(OtherQueue->GetFence());
+
+	ThrowIfFailed(CopyQueue->Wait(OtherFence->GetD3DFence(), FenceValue));
+}
+
+XUploadToken D3D12UploadManager::Enqueue(D3D12Resource* Destination, std::shared_ptr<D3D12ResourceLocation> StagingLocation, uint64_t Size, D3D12RecordCopyFunc RecordCopy)
+{
+	// Other states can't be used on the copy queue, the callers record those copies on the direct list
+	assert(Destination->ResourceState.IsInState(D3D12_RESOURCE_STATE_COMMON));
+
+	D3D12UploadRequest Request;
+	Request.StagingLocation = StagingLocation;
+	Request.RecordCopy = RecordCopy;
+
+	// Tokens only grow, the last upload into a shared pool buffer covers the previous ones
+	XUploadToken Token = Scheduler->Enqueue(std::move(Request), Size);
+	Destination->UploadToken = Token;
+
+	return Token;
+}
+
+void D3D12UploadManager::ExecuteBatch(std::vector<D3D12UploadRequest*>& Batch)
+{
+	D3D12RecordingContext* Context = CopyContextPool->Acquire();
+
+	ThrowIfFailed(Context->CommandAllocator->Reset());
+	ThrowIfFailed(Context->CommandList->Reset(Context->CommandAllocator.Get(), nullptr));
+
+	// No barriers: the callers only enqueue destinations in COMMON, they are promoted to COPY_DEST
+	// on the copy queue and decay back to COMMON once the batch has completed
+	for (D3D12UploadRequest* Request : Batch)
+	{
+		Request->RecordCopy(Context->CommandList.Get());
+	}
+
+	ThrowIfFailed(Context->CommandList->Close());
+
+	ID3D12CommandList* CommandLists[] = { Context->CommandList.Get() };
+	CopyQueue->ExecuteCommandLists(_countof(CommandLists), CommandLists);
+
+	// The scheduler signals right after the batch
+	CopyContextPool->Release(Context, CopyFence->GetCurrentValue());
+}
+
+void D3D12UploadManager::WaitForUpload(D3D12Resource* Resource, ID3D12CommandQueue* GraphicsQueue)
+{
+	const XUploadToken Token = Resource->UploadToken;
+	if (Token == 0)
+	{
+		return;
+	}
+
+	if (!Scheduler->IsComplete(Token))
+	{
+		const uint64_t FenceValue = Scheduler->SubmitUntil(Token, [this](std::vector<D3D12UploadRequest*>& Batch) { ExecuteBatch(Batch); });
+
+		// GPU side wait, the CPU keeps recording
+		if (FenceValue > GraphicsWaitValue)
+		{
+			ThrowIfFailed(GraphicsQueue->Wait(CopyFence->GetD3DFence(), FenceValue));
+			GraphicsWaitValue = FenceValue;
+		}
+	}
+
+	Resource->UploadToken = 0;
+}
+
+void D3D12UploadManager::EndFrame()
+{
+	Scheduler->SubmitFrame([this](std::vector<D3D12UploadRequest*>& Batch) { ExecuteBatch(Batch); });
+
+	Scheduler->Retire([](D3D12UploadRequest& Request) { Request.StagingLocation = nullptr; });
+}
+
+void D3D12UploadManager::Flush()
+{
+	const XUploadToken LastToken = Scheduler->GetLastToken();
+	if (LastToken != 0)
+	{
+		const uint64_t FenceValue = Scheduler->SubmitUntil(LastToken, [this](std::vector<D3D12UploadRequest*>& Batch) { ExecuteBatch(Batch); });
+		if (FenceValue != 0)
+		{
+			WaitForFence(FenceValue);
+		}
+	}
+
+	Scheduler->Retire([](D3D12UploadRequest& Request) { Request.StagingLocation = nullptr; });
+}
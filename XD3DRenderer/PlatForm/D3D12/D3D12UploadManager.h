@@ -0,0 +1,80 @@
+#pragma once
+
+#include "D3D12Util.h"
+#include "D3D12Fence.h"
+#include "D3D12CommandContext.h"
+#include "../../Common/UploadScheduler.h"
+
+class D3D12Device;
+class D3D12Resource;
+class D3D12ResourceLocation;
+
+// Bytes of staging copies submitted to the copy queue each frame
+#define UPLOAD_BUDGET_PER_FRAME (16 * 1024 * 1024)
+
+// Records the copies of one upload into a copy command list
+using D3D12RecordCopyFunc = std::function<void(ID3D12GraphicsCommandList* CommandList)>;
+
+struct D3D12UploadRequest
+{
+	// Freed once the copy queue is done with it
+	std::shared_ptr<D3D12ResourceLocation> StagingLocation = nullptr;
+
+	D3D12RecordCopyFunc RecordCopy;
+};
+
+// Streams the initial data of buffers and textures on a dedicated copy queue.
+// The staging copies are batched under a per-frame byte budget; the graphics queue waits on the copy fence
+// before the first use of a destination. Not thread safe, use it from the thread that submits the frames.
+class D3D12UploadManager : public XCommandQueue
+{
+public:
+	D3D12UploadManager(D3D12Device* InDevice);
+	~D3D12UploadManager();
+
+	// Queue the copy from StagingLocation into Destination, RecordCopy must hold a reference to the destination.
+	// Destination must be in COMMON, the copy queue can't transition it
+	XUploadToken Enqueue(D3D12Resource* Destination, std::shared_ptr<D3D12ResourceLocation> StagingLocation, uint64_t Size, D3D12RecordCopyFunc RecordCopy);
+
+	bool IsComplete(XUploadToken Token) { return Scheduler->IsComplete(Token); }
+
+	// Make GraphicsQueue wait for the pending upload of Resource, if any. The upload is submitted now if needed.
+	void WaitForUpload(D3D12Resource* Resource, ID3D12CommandQueue* GraphicsQueue);
+
+	// Submit the next batch within the frame budget and free the staging memory of the completed ones
+	void EndFrame();
+
+	// Submit every pending upload and wait for the copy queue, e.g. after loading a scene
+	void Flush();
+
+	ID3D12CommandQueue* GetCopyQueue() { return CopyQueue.Get(); }
+
+	virtual D3D12Fence* GetFence() override { return CopyFence.get(); }
+
+	virtual uint64_t Signal() override;
+
+	virtual void WaitForFence(uint64_t FenceValue) override;
+
+	virtual void WaitForQueue(XCommandQueue* OtherQueue, uint64_t FenceValue) override;
+
+	uint64_t GetPendingSize() const { return Scheduler->GetPendingSize(); }
+
+private:
+	void ExecuteBatch(std::vector<D3D12UploadRequest*>& Batch);
+
+	D3D12RecordingContext* CreateCopyContext();
+
+private:
+	D3D12Device* Device = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CopyQueue = nullptr;
+
+	std::unique_ptr<D3D12Fence> CopyFence = nullptr;
+
+	std::unique_ptr<XCommandListPool<D3D12RecordingContext>> CopyContextPool = nullptr;
+
+	std::unique_ptr<XUploadScheduler<D3D12UploadRequest>> Scheduler = nullptr;
+
+	// Copy fence value the graphics queue already waits for
+	uint64_t GraphicsWaitValue = 0;
+};
@@ -54,6 +54,9 @@ inline void SetDebugName(_In_ ID3D12DeviceChild* resource, _In_z_ const wchar_t(
 }
 
 
+// Frames the CPU may record ahead of the GPU, each one has its own command allocator and upload segment
+#define FRAMES_IN_FLIGHT 3
+
 // Aligns a value to the nearest higher multiple of 'Alignment'.
 inline uint32_t AlignArbitrary(uint32_t Val, uint32_t Alignment)
 {
@@ -17,6 +17,23 @@ D3D12View::D3D12View(D3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE InType, I
 	}
 }
 
+D3D12View::D3D12View(D3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE InType, ID3D12Resource* InResource, uint32_t InSlotCount)
+	:Device(InDevice),
+	Type(InType),
+	Resource(InResource),
+	SlotCount(InSlotCount)
+{
+	assert(SlotCount > 0);
+
+	HeapSlotAllocator = Device->GetHeapSlotAllocator(Type);
+
+	if (HeapSlotAllocator)
+	{
+		HeapSlot = HeapSlotAllocator->AllocateHeapSlots(SlotCount);
+		assert(HeapSlot.Handle.ptr != 0);
+	}
+}
+
 D3D12View::~D3D12View()
 {
 	Destroy();
@@ -26,8 +43,39 @@ void D3D12View::Destroy()
 {
 	if (HeapSlotAllocator)
 	{
-		HeapSlotAllocator->FreeHeapSlot(HeapSlot);
+		// The slot is handed out again right away, possibly within this frame
+		InvalidateDescriptorTables();
+
+		if (SlotCount == 1)
+		{
+			HeapSlotAllocator->FreeHeapSlot(HeapSlot);
+		}
+		else
+		{
+			HeapSlotAllocator->FreeHeapSlots(HeapSlot, SlotCount);
+		}
+	}
+}
+
+void D3D12View::InvalidateDescriptorTables()
+{
+	if (Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+	{
+		Device->GetCommandContext()->GetDescriptorCache()->InvalidateCbvSrvUavTables();
+	}
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12View::GetDescriptorHandle(uint32_t Index) const
+{
+	assert(Index < SlotCount);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE Handle = HeapSlot.Handle;
+	if (Index > 0)
+	{
+		Handle.ptr += (SIZE_T)Index * HeapSlotAllocator->GetDescriptorSize();
 	}
+
+	return Handle;
 }
 
 D3D12ShaderResourceView::D3D12ShaderResourceView(D3D12Device* InDevice, const D3D12_SHADER_RESOURCE_VIEW_DESC& Desc, ID3D12Resource* InResource)
@@ -38,12 +86,19 @@ D3D12ShaderResourceView::D3D12ShaderResourceView(D3D12Device* InDevice, const D3
 
 D3D12ShaderResourceView::~D3D12ShaderResourceView()
 {
-
+	if (BindlessIndex != XBindlessIndexAllocator::InvalidIndex)
+	{
+		Device->GetCommandContext()->GetDescriptorCache()->RemoveBindlessDescriptor(BindlessIndex);
+	}
 }
 
 void D3D12ShaderResourceView::CreateShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC& Desc)
 {
+	 InvalidateDescriptorTables();
 	 Device->GetD3DDevice()->CreateShaderResourceView(Resource, &Desc, HeapSlot.Handle);
+
+	 // Also publish it in the bindless table, shaders then only need its index
+	 BindlessIndex = Device->GetCommandContext()->GetDescriptorCache()->AddBindlessDescriptor(HeapSlot.Handle);
 }
 
 
@@ -53,14 +108,23 @@ D3D12RenderTargetView::D3D12RenderTargetView(D3D12Device* InDevice, const D3D12_
 	CreateRenderTargetView(Desc);
 }
 
+D3D12RenderTargetView::D3D12RenderTargetView(D3D12Device* InDevice, const std::vector<D3D12_RENDER_TARGET_VIEW_DESC>& Descs, ID3D12Resource* InResource)
+	:D3D12View(InDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, InResource, (uint32_t)Descs.size())
+{
+	for (uint32_t i = 0; i < (uint32_t)Descs.size(); i++)
+	{
+		CreateRenderTargetView(Descs[i], i);
+	}
+}
+
 D3D12RenderTargetView::~D3D12RenderTargetView()
 {
 
 }
 
-void D3D12RenderTargetView::CreateRenderTargetView(const D3D12_RENDER_TARGET_VIEW_DESC& Desc)
+void D3D12RenderTargetView::CreateRenderTargetView(const D3D12_RENDER_TARGET_VIEW_DESC& Desc, uint32_t Index)
 {
-	Device->GetD3DDevice()->CreateRenderTargetView(Resource, &Desc, HeapSlot.Handle);
+	Device->GetD3DDevice()->CreateRenderTargetView(Resource, &Desc, GetDescriptorHandle(Index));
 }
 
 
@@ -70,14 +134,23 @@ D3D12DepthStencilView::D3D12DepthStencilView(D3D12Device* InDevice, const D3D12_
 	CreateDepthStencilView(Desc);
 }
 
+D3D12DepthStencilView::D3D12DepthStencilView(D3D12Device* InDevice, const std::vector<D3D12_DEPTH_STENCIL_VIEW_DESC>& Descs, ID3D12Resource* InResource)
+	:D3D12View(InDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, InResource, (uint32_t)Descs.size())
+{
+	for (uint32_t i = 0; i < (uint32_t)Descs.size(); i++)
+	{
+		CreateDepthStencilView(Descs[i], i);
+	}
+}
+
 D3D12DepthStencilView::~D3D12DepthStencilView()
 {
 
 }
 
-void D3D12DepthStencilView::CreateDepthStencilView(const D3D12_DEPTH_STENCIL_VIEW_DESC& Desc)
+void D3D12DepthStencilView::CreateDepthStencilView(const D3D12_DEPTH_STENCIL_VIEW_DESC& Desc, uint32_t Index)
 {
-	Device->GetD3DDevice()->CreateDepthStencilView(Resource, &Desc, HeapSlot.Handle);
+	Device->GetD3DDevice()->CreateDepthStencilView(Resource, &Desc, GetDescriptorHandle(Index));
 }
 
 
@@ -94,5 +167,6 @@ D3D12UnorderedAccessView::~D3D12UnorderedAccessView()
 
 void D3D12UnorderedAccessView::CreateUnorderedAccessView(const D3D12_UNORDERED_ACCESS_VIEW_DESC& Desc)
 {
+	InvalidateDescriptorTables();
 	Device->GetD3DDevice()->CreateUnorderedAccessView(Resource, nullptr, &Desc, HeapSlot.Handle);
 }
\ No newline at end of file
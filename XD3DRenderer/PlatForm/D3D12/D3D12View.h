@@ -1,6 +1,8 @@
 #pragma once
 
 #include "D3D12HeapSlotAllocator.h"
+#include "../../Common/BindlessIndexAllocator.h"
+#include <vector>
 
 class D3D12Device;
 
@@ -9,14 +11,22 @@ class D3D12View
 public:
 	D3D12View(D3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE InType, ID3D12Resource* InResource);
 
+	// Owns InSlotCount contiguous descriptors, e.g. one per face of a cube map
+	D3D12View(D3D12Device* InDevice, D3D12_DESCRIPTOR_HEAP_TYPE InType, ID3D12Resource* InResource, uint32_t InSlotCount);
+
 	virtual ~D3D12View();
 
-	D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorHandle() const { return HeapSlot.Handle; }
+	D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorHandle(uint32_t Index = 0) const;
+
+	uint32_t GetSlotCount() const { return SlotCount; }
 
 private:
 	void Destroy();
 
 protected:
+	// The descriptor at HeapSlot changes, the tables the descriptor cache copied from it are stale
+	void InvalidateDescriptorTables();
+
 	D3D12Device* Device = nullptr;
 
 	D3D12HeapSlotAllocator* HeapSlotAllocator = nullptr;
@@ -25,6 +35,8 @@ protected:
 
 	D3D12HeapSlotAllocator::HeapSlot HeapSlot;
 
+	uint32_t SlotCount = 1;
+
 	D3D12_DESCRIPTOR_HEAP_TYPE Type;
 };
 
@@ -35,8 +47,13 @@ public:
 
 	virtual ~D3D12ShaderResourceView();
 
+	// Stable index of the view in the bindless table of the descriptor cache, InvalidIndex if the table was full
+	uint32_t GetBindlessIndex() const { return BindlessIndex; }
+
 protected:
 	void CreateShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC& Desc);
+
+	uint32_t BindlessIndex = XBindlessIndexAllocator::InvalidIndex;
 };
 
 class D3D12RenderTargetView : public D3D12View
@@ -44,10 +61,13 @@ class D3D12RenderTargetView : public D3D12View
 public:
 	D3D12RenderTargetView(D3D12Device* InDevice, const D3D12_RENDER_TARGET_VIEW_DESC& Desc, ID3D12Resource* InResource);
 
+	// One descriptor per desc, in a contiguous range
+	D3D12RenderTargetView(D3D12Device* InDevice, const std::vector<D3D12_RENDER_TARGET_VIEW_DESC>& Descs, ID3D12Resource* InResource);
+
 	virtual ~D3D12RenderTargetView();
 
 protected:
-	void CreateRenderTargetView(const D3D12_RENDER_TARGET_VIEW_DESC& Desc);
+	void CreateRenderTargetView(const D3D12_RENDER_TARGET_VIEW_DESC& Desc, uint32_t Index = 0);
 };
 
 
@@ -56,10 +76,13 @@ class D3D12DepthStencilView : public D3D12View
 public:
 	D3D12DepthStencilView(D3D12Device* InDevice, const D3D12_DEPTH_STENCIL_VIEW_DESC& Desc, ID3D12Resource* InResource);
 
+	// One descriptor per desc, in a contiguous range
+	D3D12DepthStencilView(D3D12Device* InDevice, const std::vector<D3D12_DEPTH_STENCIL_VIEW_DESC>& Descs, ID3D12Resource* InResource);
+
 	virtual ~D3D12DepthStencilView();
 
 protected:
-	void CreateDepthStencilView(const D3D12_DEPTH_STENCIL_VIEW_DESC& Desc);
+	void CreateDepthStencilView(const D3D12_DEPTH_STENCIL_VIEW_DESC& Desc, uint32_t Index = 0);
 };
 
 class D3D12UnorderedAccessView : public D3D12View
@@ -122,6 +122,7 @@ void D3D12Viewport::Present()
 {
 	// swap the back and front buffers
 	ThrowIfFailed(SwapChain->Present(0, 0));
+	D3D12RHI->GetDevice()->GetCommandContext()->NotifyQueueWork();
 	CurrBackBuffer = (CurrBackBuffer + 1) % SwapChainBufferCount;
 }
 
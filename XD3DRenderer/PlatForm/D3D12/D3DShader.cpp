@@ -1,9 +1,11 @@
 #include "D3DShader.h"
 #include "../../Common/FileHelper.h"
+#include "../../Common/HashHelper.h"
+#include <algorithm>
 
 void XShaderDefines::GetD3DShaderMacro(std::vector<D3D_SHADER_MACRO>& OutMacros) const
 {
-	for (const auto& Pair : DefinesMap)
+	for (const auto& Pair : Defines)
 	{
 		D3D_SHADER_MACRO Macro;
 		Macro.Name = Pair.first.c_str();
@@ -17,31 +19,32 @@ void XShaderDefines::GetD3DShaderMacro(std::vector<D3D_SHADER_MACRO>& OutMacros)
 	OutMacros.push_back(Macro);
 }
 
-bool XShaderDefines::operator == (const XShaderDefines& Other) const
+void XShaderDefines::SetDefine(const std::string& Name, const std::string& Definition)
 {
-	if (DefinesMap.size() != Other.DefinesMap.size())
-	{
-		return false;
-	}
+	auto Iter = std::lower_bound(Defines.begin(), Defines.end(), Name,
+		[](const std::pair<std::string, std::string>& Define, const std::string& Key) { return Define.first < Key; });
 
-	for (const auto& Pair : DefinesMap)
+	if (Iter != Defines.end() && Iter->first == Name)
 	{
-		const std::string Key = Pair.first;
-		const std::string Value = Pair.second;
-
-		auto Iter = Other.DefinesMap.find(Key);
-		if (Iter == Other.DefinesMap.end() || Iter->second != Value)
+		if (Iter->second == Definition)
 		{
-			return false;
+			return;
 		}
-	}
 
-	return true;
-}
+		Iter->second = Definition;
+	}
+	else
+	{
+		Defines.insert(Iter, std::make_pair(Name, Definition));
+	}
 
-void XShaderDefines::SetDefine(const std::string& Name, const std::string& Definition)
-{
-	DefinesMap.insert_or_assign(Name, Definition);
+	// Order dependent combine over the sorted pairs: swapping a name and a definition, or two definitions, changes it
+	Hash = HashHelper::Mix(Defines.size());
+	for (const auto& Define : Defines)
+	{
+		Hash = HashHelper::Combine(Hash, HashHelper::HashString(Define.first));
+		Hash = HashHelper::Combine(Hash, HashHelper::HashString(Define.second));
+	}
 }
 
 
@@ -62,35 +65,40 @@ void D3DShader::Initialize()
 	std::vector<D3D_SHADER_MACRO> ShaderMacros;
 	ShaderInfo.ShaderDefines.GetD3DShaderMacro(ShaderMacros);
 
+	// Shared by the passes, they only differ by their entry point and target
+	const uint64_t SourceHash = HashPreprocessedSource(FilePath, ShaderMacros.data());
+
 	if (ShaderInfo.bCreateVS)
 	{
-		auto VSBlob = CompileShader(FilePath, ShaderMacros.data(), ShaderInfo.VSEntryPoint, "vs_5_1");
-		ShaderPass["VS"] = VSBlob;
-
-		GetShaderParameters(VSBlob, EShaderType::VERTEX_SHADER);
+		ShaderPass["VS"] = LoadOrCompileShader(FilePath, ShaderMacros.data(), SourceHash, ShaderInfo.VSEntryPoint, "vs_5_1", EShaderType::VERTEX_SHADER);
 	}
 
 	if (ShaderInfo.bCreatePS)
 	{
-		auto PSBlob = CompileShader(FilePath, ShaderMacros.data(), ShaderInfo.PSEntryPoint, "ps_5_1");
-		ShaderPass["PS"] = PSBlob;
-
-		GetShaderParameters(PSBlob, EShaderType::PIXEL_SHADER);
+		ShaderPass["PS"] = LoadOrCompileShader(FilePath, ShaderMacros.data(), SourceHash, ShaderInfo.PSEntryPoint, "ps_5_1", EShaderType::PIXEL_SHADER);
 	}
 
 	if (ShaderInfo.bCreateCS)
 	{
-		auto CSBlob = CompileShader(FilePath, ShaderMacros.data(), ShaderInfo.CSEntryPoint, "cs_5_1");
-		ShaderPass["CS"] = CSBlob;
+		ShaderPass["CS"] = LoadOrCompileShader(FilePath, ShaderMacros.data(), SourceHash, ShaderInfo.CSEntryPoint, "cs_5_1", EShaderType::COMPUTE_SHADER);
+	}
 
-		GetShaderParameters(CSBlob, EShaderType::COMPUTE_SHADER);
+	// In a fixed order, ShaderPass is unordered
+	for (const char* PassName : { "VS", "PS", "CS" })
+	{
+		auto Iter = ShaderPass.find(PassName);
+		if (Iter != ShaderPass.end())
+		{
+			const uint64_t PassHash = HashHelper::HashBytes(Iter->second->GetBufferPointer(), Iter->second->GetBufferSize());
+			ShaderHash = HashHelper::Combine(HashHelper::Combine(ShaderHash, HashHelper::HashString(PassName)), PassHash);
+		}
 	}
 
 	// Create rootSignature
 	CreateRootSignature();
 }
 
-Microsoft::WRL::ComPtr<ID3DBlob> D3DShader::CompileShader(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines, const std::string& Entrypoint, const std::string& Target)
+UINT D3DShader::GetCompileFlags()
 {
 	UINT CompileFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG) 
@@ -98,6 +106,80 @@ Microsoft::WRL::ComPtr<ID3DBlob> D3DShader::CompileShader(const std::wstring& Fi
 	CompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
+	return CompileFlags;
+}
+
+uint64_t D3DShader::HashPreprocessedSource(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines)
+{
+	ComPtr<ID3DBlob> Source;
+	if (FAILED(D3DReadFileToBlob(Filename.c_str(), &Source)))
+	{
+		return 0;
+	}
+
+	// Includes are resolved relative to the file, like D3DCompileFromFile does
+	const std::string SourceName = Convert::WStrToStr(Filename);
+
+	ComPtr<ID3DBlob> Preprocessed;
+	ComPtr<ID3DBlob> Errors;
+	if (FAILED(D3DPreprocess(Source->GetBufferPointer(), Source->GetBufferSize(), SourceName.c_str(), Defines,
+		D3D_COMPILE_STANDARD_FILE_INCLUDE, &Preprocessed, &Errors)))
+	{
+		// The compilation reports the errors
+		return 0;
+	}
+
+	return HashHelper::HashBytes(Preprocessed->GetBufferPointer(), Preprocessed->GetBufferSize());
+}
+
+ComPtr<ID3DBlob> D3DShader::LoadOrCompileShader(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines, uint64_t SourceHash,
+	const std::string& Entrypoint, const std::string& Target, EShaderType ShaderType)
+{
+	XShaderCache* ShaderCache = XD3D12RHI->GetDevice()->GetShaderCache();
+
+	uint64_t Key = 0;
+	if (SourceHash != 0)
+	{
+		// The defines are expanded in the source already, hashed too so that an unused define still gets its own entry
+		Key = HashHelper::Combine(SourceHash, HashHelper::HashString(Entrypoint));
+		Key = HashHelper::Combine(Key, HashHelper::HashString(Target));
+		Key = HashHelper::Combine(Key, GetCompileFlags());
+		Key = HashHelper::Combine(Key, ShaderInfo.ShaderDefines.GetHash());
+		Key = HashHelper::Combine(Key, D3D_COMPILER_VERSION);
+	}
+
+	XShaderCacheEntry Entry;
+	if (Key != 0 && ShaderCache->Find(Key, Entry))
+	{
+		ComPtr<ID3DBlob> ByteCode;
+		ThrowIfFailed(D3DCreateBlob(Entry.Bytecode.size(), &ByteCode));
+		memcpy(ByteCode->GetBufferPointer(), Entry.Bytecode.data(), Entry.Bytecode.size());
+
+		GetShaderParameters(Entry.Bindings, ShaderType);
+
+		return ByteCode;
+	}
+
+	ComPtr<ID3DBlob> ByteCode = CompileShader(Filename, Defines, Entrypoint, Target);
+	ReflectShader(ByteCode, Entry.Bindings);
+
+	if (Key != 0)
+	{
+		const uint8_t* Bytes = (const uint8_t*)ByteCode->GetBufferPointer();
+		Entry.Bytecode.assign(Bytes, Bytes + ByteCode->GetBufferSize());
+
+		ShaderCache->Store(Key, Entry);
+	}
+
+	GetShaderParameters(Entry.Bindings, ShaderType);
+
+	return ByteCode;
+}
+
+Microsoft::WRL::ComPtr<ID3DBlob> D3DShader::CompileShader(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines, const std::string& Entrypoint, const std::string& Target)
+{
+	UINT CompileFlags = GetCompileFlags();
+
 	HRESULT hr = S_OK;
 
 	ComPtr<ID3DBlob> ByteCode = nullptr;
@@ -113,26 +195,50 @@ Microsoft::WRL::ComPtr<ID3DBlob> D3DShader::CompileShader(const std::wstring& Fi
 	return ByteCode;
 }
 
-void D3DShader::GetShaderParameters(ComPtr<ID3DBlob> PassBlob, EShaderType ShaderType)
+void D3DShader::ReflectShader(ComPtr<ID3DBlob> PassBlob, std::vector<XShaderBindingRecord>& OutBindings)
 {
-	ID3D12ShaderReflection* Reflection = NULL;
-	D3DReflect(PassBlob->GetBufferPointer(), PassBlob->GetBufferSize(), IID_ID3D12ShaderReflection, (void**)&Reflection);
+	ComPtr<ID3D12ShaderReflection> Reflection;
+	ThrowIfFailed(D3DReflect(PassBlob->GetBufferPointer(), PassBlob->GetBufferSize(), IID_PPV_ARGS(&Reflection)));
 
 	D3D12_SHADER_DESC ShaderDesc;
 	Reflection->GetDesc(&ShaderDesc);
 
-	//printf("ShaderName: %s \n", ShaderInfo.ShaderName.c_str());
-
+	OutBindings.clear();
 	for (UINT i = 0; i < ShaderDesc.BoundResources; i++)
 	{
 		D3D12_SHADER_INPUT_BIND_DESC  ResourceDesc;
 		Reflection->GetResourceBindingDesc(i, &ResourceDesc);
 
-		auto ShaderVarName = ResourceDesc.Name;
-		auto ResourceType = ResourceDesc.Type;
-		auto RegisterSpace = ResourceDesc.Space;
-		auto BindPoint = ResourceDesc.BindPoint;
-		auto BindCount = ResourceDesc.BindCount;
+		XShaderBindingRecord Binding;
+		Binding.Name = ResourceDesc.Name;
+		Binding.Type = ResourceDesc.Type;
+		Binding.BindPoint = ResourceDesc.BindPoint;
+		Binding.BindCount = ResourceDesc.BindCount;
+		Binding.RegisterSpace = ResourceDesc.Space;
+
+		if (ResourceDesc.Type == D3D_SIT_CBUFFER)
+		{
+			D3D12_SHADER_BUFFER_DESC BufferDesc;
+			Reflection->GetConstantBufferByName(ResourceDesc.Name)->GetDesc(&BufferDesc);
+
+			Binding.ConstantBufferSize = BufferDesc.Size;
+		}
+
+		OutBindings.push_back(Binding);
+	}
+}
+
+void D3DShader::GetShaderParameters(const std::vector<XShaderBindingRecord>& Bindings, EShaderType ShaderType)
+{
+	//printf("ShaderName: %s \n", ShaderInfo.ShaderName.c_str());
+
+	for (const XShaderBindingRecord& Binding : Bindings)
+	{
+		auto ShaderVarName = Binding.Name.c_str();
+		auto ResourceType = (D3D_SHADER_INPUT_TYPE)Binding.Type;
+		auto RegisterSpace = Binding.RegisterSpace;
+		auto BindPoint = Binding.BindPoint;
+		auto BindCount = Binding.BindCount;
 
 		//printf("ShaderVarName: %s, ", ShaderVarName);
 		//printf("ResourceType: %d, ", ResourceType);
@@ -140,6 +246,32 @@ void D3DShader::GetShaderParameters(ComPtr<ID3DBlob> PassBlob, EShaderType Shade
 		//printf("BindPoint:  %d, ", BindPoint);
 		//printf("BindCount: %d \n", BindCount);
 
+		// Bindless resources are not bound one by one
+		if (RegisterSpace >= BindlessRegisterSpace)
+		{
+			if (ResourceType == D3D_SHADER_INPUT_TYPE::D3D_SIT_CBUFFER)
+			{
+				assert(RegisterSpace == BindlessRegisterSpace);
+
+				BindlessConstantsBindPoint = BindPoint;
+				BindlessConstantCount = (std::max)(BindlessConstantCount, Binding.ConstantBufferSize / 4);
+			}
+			else if (ResourceType == D3D_SHADER_INPUT_TYPE::D3D_SIT_STRUCTURED
+				|| ResourceType == D3D_SHADER_INPUT_TYPE::D3D_SIT_TEXTURE)
+			{
+				if (std::find(BindlessSRVSpaces.begin(), BindlessSRVSpaces.end(), RegisterSpace) == BindlessSRVSpaces.end())
+				{
+					BindlessSRVSpaces.push_back(RegisterSpace);
+				}
+			}
+			else
+			{
+				assert(0);
+			}
+
+			continue;
+		}
+
 		if (ResourceType == D3D_SHADER_INPUT_TYPE::D3D_SIT_CBUFFER)
 		{
 			XShaderCBVParameter Param;
@@ -361,6 +493,36 @@ void D3DShader::CreateRootSignature()
 		}
 	}
 
+	// Bindless
+	std::vector<CD3DX12_DESCRIPTOR_RANGE> BindlessRanges;
+	{
+		if (BindlessConstantCount > 0)
+		{
+			BindlessConstantsBindSlot = (UINT)SlotRootParameter.size();
+
+			CD3DX12_ROOT_PARAMETER RootParam;
+			RootParam.InitAsConstants(BindlessConstantCount, BindlessConstantsBindPoint, BindlessRegisterSpace, D3D12_SHADER_VISIBILITY_ALL);
+			SlotRootParameter.push_back(RootParam);
+		}
+
+		if (BindlessSRVSpaces.size() > 0)
+		{
+			BindlessTableBindSlot = (UINT)SlotRootParameter.size();
+
+			// Every space sees the whole table, one per resource type
+			for (UINT Space : BindlessSRVSpaces)
+			{
+				CD3DX12_DESCRIPTOR_RANGE Range;
+				Range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, Space, 0);
+				BindlessRanges.push_back(Range);
+			}
+
+			CD3DX12_ROOT_PARAMETER RootParam;
+			RootParam.InitAsDescriptorTable((UINT)BindlessRanges.size(), BindlessRanges.data(), D3D12_SHADER_VISIBILITY_ALL);
+			SlotRootParameter.push_back(RootParam);
+		}
+	}
+
 	// Sampler
 	// TODO
 	auto StaticSamplers = CreateStaticSamplers();
@@ -433,6 +595,20 @@ bool D3DShader::SetParameter(std::string ParamName, const std::vector<D3D12Shade
 	return FindParam;
 }
 
+bool D3DShader::SetBindlessConstants(const std::vector<uint32_t>& Constants)
+{
+	if (BindlessConstantCount == 0)
+	{
+		return false;
+	}
+
+	assert(Constants.size() == BindlessConstantCount);
+
+	BindlessConstants = Constants;
+
+	return true;
+}
+
 bool D3DShader::SetParameter(std::string ParamName, D3D12UnorderedAccessView* UAV)
 {
 	std::vector<D3D12UnorderedAccessView*> UAVList;
@@ -462,7 +638,11 @@ bool D3DShader::SetParameter(std::string ParamName, const std::vector<D3D12Unord
 
 void D3DShader::BindParameters()
 {
-	auto CommandList = XD3D12RHI->GetDevice()->GetCommandList();
+	BindParameters(XD3D12RHI->GetDevice()->GetCommandList());
+}
+
+void D3DShader::BindParameters(ID3D12GraphicsCommandList* CommandList)
+{
 	auto DescriptorCache = XD3D12RHI->GetDevice()->GetCommandContext()->GetDescriptorCache();
 
 	CheckBindings();
@@ -542,6 +722,31 @@ void D3DShader::BindParameters()
 		}
 	}
 
+	// Bindless binding, the table does not change between draws
+	if (BindlessConstantsBindSlot != -1)
+	{
+		if (bComputeShader)
+		{
+			CommandList->SetComputeRoot32BitConstants(BindlessConstantsBindSlot, BindlessConstantCount, BindlessConstants.data(), 0);
+		}
+		else
+		{
+			CommandList->SetGraphicsRoot32BitConstants(BindlessConstantsBindSlot, BindlessConstantCount, BindlessConstants.data(), 0);
+		}
+	}
+
+	if (BindlessTableBindSlot != -1)
+	{
+		if (bComputeShader)
+		{
+			CommandList->SetComputeRootDescriptorTable(BindlessTableBindSlot, DescriptorCache->GetBindlessTableStart());
+		}
+		else
+		{
+			CommandList->SetGraphicsRootDescriptorTable(BindlessTableBindSlot, DescriptorCache->GetBindlessTableStart());
+		}
+	}
+
 	ClearBindings();
 }
 
@@ -561,6 +766,8 @@ void D3DShader::CheckBindings()
 	{
 		assert(Param.UAVList.size() > 0);
 	}
+
+	assert(BindlessConstants.size() == BindlessConstantCount);
 }
 
 void D3DShader::ClearBindings()
@@ -579,4 +786,6 @@ void D3DShader::ClearBindings()
 	{
 		Param.UAVList.clear();
 	}
+
+	BindlessConstants.clear();
 }
\ No newline at end of file
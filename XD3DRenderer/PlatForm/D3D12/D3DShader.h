@@ -4,6 +4,8 @@
 #include <wrl/client.h>
 #include "D3D12Resource.h"
 #include "D3D12RHI.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/HashHelper.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -14,20 +16,32 @@ enum class EShaderType
 	COMPUTE_SHADER,
 };
 
+// Defines of a shader permutation in canonical form: sorted by name, one definition per name.
+// Equal sets of defines have the same layout whatever order they were set in, and the same hash in every run.
 struct XShaderDefines
 {
 public:
+	// The macros point to the strings of this object, terminated by a null macro
 	void GetD3DShaderMacro(std::vector<D3D_SHADER_MACRO>& OutMacros) const;
 
-	bool operator == (const XShaderDefines& Other) const;
+	bool operator == (const XShaderDefines& Other) const
+	{
+		return Hash == Other.Hash && Defines == Other.Defines;
+	}
 
 	void SetDefine(const std::string& Name, const std::string& Definition);
 
-public:
-	std::unordered_map<std::string, std::string> DefinesMap;
+	const std::vector<std::pair<std::string, std::string>>& GetDefines() const { return Defines; }
+
+	// 64-bit hash of the sorted pairs, usable as a key on disk
+	uint64_t GetHash() const { return Hash; }
+
+private:
+	std::vector<std::pair<std::string, std::string>> Defines;
+
+	uint64_t Hash = 0;
 };
 
-// declare hash<XShaderDefines>
 namespace std
 {
 	template <>
@@ -35,21 +49,7 @@ namespace std
 	{
 		std::size_t operator()(const XShaderDefines& Defines) const
 		{
-			using std::size_t;
-			using std::hash;
-			using std::string;
-			// Compute individual hash values for each string 
-			// and combine them using XOR
-			// and bit shifting:
-
-			size_t HashValue = 0;
-			for (const auto& Pair : Defines.DefinesMap)
-			{
-				HashValue ^= (hash<string>()(Pair.first) << 1);
-				HashValue ^= (hash<string>()(Pair.second) << 1);
-			}
-
-			return HashValue;
+			return (std::size_t)Defines.GetHash();
 		}
 	};
 }
@@ -109,6 +109,13 @@ struct XShaderInfo
 
 class D3DShader
 {
+public:
+	// A cbuffer in this space becomes root constants, holding the indices of the bindless resources.
+	// SRV arrays in this space and the following ones index the bindless table of the descriptor cache, e.g.
+	//     cbuffer BindlessIndices : register(b0, space1) { uint AlbedoIndex; };
+	//     Texture2D BindlessTextures[] : register(t0, space1);
+	static const UINT BindlessRegisterSpace = 1;
+
 public:
 	D3DShader(const XShaderInfo& InShaderInfo, D3D12RHI* InD3D12RHI);
 
@@ -124,12 +131,33 @@ public:
 
 	bool SetParameter(std::string ParamName, const std::vector<D3D12UnorderedAccessView*>& UAVList);
 
+	// Values of the bindless cbuffer, usually D3D12ShaderResourceView::GetBindlessIndex()
+	bool SetBindlessConstants(const std::vector<uint32_t>& Constants);
+
 	void BindParameters();
 
+	// Bind to a command list recorded by a worker thread, see D3D12CommandContext::RecordParallel.
+	// The parameters are state of the shader, set and bind them from one thread at a time.
+	void BindParameters(ID3D12GraphicsCommandList* CommandList);
+
+	// Hash of the bytecode of every pass, keys the pipeline states using this shader in D3D12PipelineStateCache
+	uint64_t GetShaderHash() const { return ShaderHash; }
+
 private:
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines, const std::string& Entrypoint, const std::string& Target);
 
-	void GetShaderParameters(ComPtr<ID3DBlob> PassBlob, EShaderType ShaderType);
+	static UINT GetCompileFlags();
+
+	// Hash of the source after the includes and defines are expanded, 0 if it does not preprocess
+	static uint64_t HashPreprocessedSource(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines);
+
+	// From the shader cache if the same source was compiled with the same settings before, compiled and stored otherwise
+	ComPtr<ID3DBlob> LoadOrCompileShader(const std::wstring& Filename, const D3D_SHADER_MACRO* Defines, uint64_t SourceHash,
+		const std::string& Entrypoint, const std::string& Target, EShaderType ShaderType);
+
+	static void ReflectShader(ComPtr<ID3DBlob> PassBlob, std::vector<XShaderBindingRecord>& OutBindings);
+
+	void GetShaderParameters(const std::vector<XShaderBindingRecord>& Bindings, EShaderType ShaderType);
 
 	D3D12_SHADER_VISIBILITY GetShaderVisibility(EShaderType ShaderType);
 
@@ -164,10 +192,24 @@ public:
 
 	int SamplerSignatureBindSlot = -1;
 
+	int BindlessConstantsBindSlot = -1;
+
+	UINT BindlessConstantsBindPoint = 0;
+
+	UINT BindlessConstantCount = 0;
+
+	std::vector<uint32_t> BindlessConstants;
+
+	int BindlessTableBindSlot = -1;
+
+	std::vector<UINT> BindlessSRVSpaces;
+
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> ShaderPass;
 
 	ComPtr<ID3D12RootSignature> RootSignature;
 
 private:
+	uint64_t ShaderHash = 0;
+
 	D3D12RHI* XD3D12RHI = nullptr;
 };
\ No newline at end of file